@@ -86,9 +86,9 @@ int InitFBO ( ESContext *esContext )
    {
       glBindTexture ( GL_TEXTURE_2D, userData->colorTexId[i] );
 
-      glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, 
-                     userData->textureWidth, userData->textureHeight, 
-                     0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+      esMemTexImage2D ( "MRT color", GL_TEXTURE_2D, 0, GL_RGBA,
+                        userData->textureWidth, userData->textureHeight,
+                        0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
 
       // Set the filtering mode
       glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
@@ -261,7 +261,7 @@ void ShutDown ( ESContext *esContext )
    UserData *userData = esContext->userData;
 
    // Delete texture objects
-   glDeleteTextures ( 4, userData->colorTexId );
+   esMemDeleteTextures ( 4, userData->colorTexId );
 
    // Delete fbo
    glDeleteFramebuffers ( 1, &userData->fbo );
@@ -284,8 +284,8 @@ void Create3DNoiseTexture ( ESContext *esContext )
 
    glGenTextures ( 1, &userData->textureId );
    glBindTexture ( GL_TEXTURE_3D, userData->textureId );
-   glTexImage3D ( GL_TEXTURE_3D, 0, GL_R8, textureSize, textureSize, textureSize, 0,
-                  GL_RED, GL_UNSIGNED_BYTE, texBufUbyte );
+   esMemTexImage3D ( "noise 3D", GL_TEXTURE_3D, 0, GL_R8, textureSize, textureSize, textureSize, 0,
+                     GL_RED, GL_UNSIGNED_BYTE, texBufUbyte );
 
    glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
@@ -502,7 +502,7 @@ void Shutdown ( ESContext *esContext )
    }
 
    // Delete texture object
-   glDeleteTextures ( 1, &userData->textureId );
+   esMemDeleteTextures ( 1, &userData->textureId );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
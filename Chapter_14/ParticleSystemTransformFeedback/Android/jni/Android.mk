@@ -14,6 +14,22 @@ LOCAL_SRC_FILES := $(COMMON_SRC_PATH)/esShader.c \
 				   $(COMMON_SRC_PATH)/esShapes.c \
 				   $(COMMON_SRC_PATH)/esTransform.c \
 				   $(COMMON_SRC_PATH)/esUtil.c \
+				   $(COMMON_SRC_PATH)/esCull.c \
+				   $(COMMON_SRC_PATH)/esVertexArray.c \
+				   $(COMMON_SRC_PATH)/esGpuMemory.c \
+				   $(COMMON_SRC_PATH)/esGLAccount.c \
+				   $(COMMON_SRC_PATH)/esState.c \
+				   $(COMMON_SRC_PATH)/esUniformRing.c \
+				   $(COMMON_SRC_PATH)/esShaderWarmup.c \
+				   $(COMMON_SRC_PATH)/esShaderVariant.c \
+				   $(COMMON_SRC_PATH)/esProgram.c \
+				   $(COMMON_SRC_PATH)/esCapture.c \
+				   $(COMMON_SRC_PATH)/esRenderThread.c \
+				   $(COMMON_SRC_PATH)/esFramePacing.c \
+				   $(COMMON_SRC_PATH)/esGpuTimer.c \
+				   $(COMMON_SRC_PATH)/esTrace.c \
+				   $(COMMON_SRC_PATH)/esProfile.c \
+				   $(COMMON_SRC_PATH)/esBenchmark.c \
 				   $(COMMON_SRC_PATH)/Android/esUtil_Android.c \
 				   $(SRC_PATH)/Noise3D.c \
 				   $(SRC_PATH)/ParticleSystemTransformFeedback.c
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stddef.h>
+#include <string.h>
 #include "esUtil.h"
 #include "Noise3D.h"
 
@@ -50,6 +51,20 @@
 #define ATTRIBUTE_CURTIME       3
 #define ATTRIBUTE_LIFETIME      4
 
+#define STRINGIFY(x)   #x
+#define TO_STRING(x)   STRINGIFY ( x )
+
+// Injected into the shaders so GLSL and C share one definition of each constant
+static const ESShaderDefine particleDefines[] =
+{
+   { "NUM_PARTICLES",      TO_STRING ( NUM_PARTICLES ) },
+   { "ATTRIBUTE_POSITION", TO_STRING ( ATTRIBUTE_POSITION ) },
+   { "ATTRIBUTE_VELOCITY", TO_STRING ( ATTRIBUTE_VELOCITY ) },
+   { "ATTRIBUTE_SIZE",     TO_STRING ( ATTRIBUTE_SIZE ) },
+   { "ATTRIBUTE_CURTIME",  TO_STRING ( ATTRIBUTE_CURTIME ) },
+   { "ATTRIBUTE_LIFETIME", TO_STRING ( ATTRIBUTE_LIFETIME ) }
+};
+
 typedef struct
 {
    float position[2];
@@ -59,9 +74,21 @@ typedef struct
    float lifetime;
 } Particle;
 
+// Vertex format of a Particle, read by both the emit and the draw programs
+static const ESVertexAttrib particleFormat[] =
+{
+   { ATTRIBUTE_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof ( Particle ), offsetof ( Particle, position[0] ), 0, GL_FALSE },
+   { ATTRIBUTE_VELOCITY, 2, GL_FLOAT, GL_FALSE, sizeof ( Particle ), offsetof ( Particle, velocity[0] ), 0, GL_FALSE },
+   { ATTRIBUTE_SIZE,     1, GL_FLOAT, GL_FALSE, sizeof ( Particle ), offsetof ( Particle, size ),        0, GL_FALSE },
+   { ATTRIBUTE_CURTIME,  1, GL_FLOAT, GL_FALSE, sizeof ( Particle ), offsetof ( Particle, curtime ),     0, GL_FALSE },
+   { ATTRIBUTE_LIFETIME, 1, GL_FLOAT, GL_FALSE, sizeof ( Particle ), offsetof ( Particle, lifetime ),    0, GL_FALSE }
+};
+
 typedef struct
 {
-   // Handle to a program object
+   // Shader variants and the program objects specialized from them
+   ESShaderVariants emitVariants;
+   ESShaderVariants drawVariants;
    GLuint emitProgramObject;
    GLuint drawProgramObject;
 
@@ -117,7 +144,7 @@ GLuint LoadTexture ( void *ioContext, char *fileName )
    glGenTextures ( 1, &texId );
    glBindTexture ( GL_TEXTURE_2D, texId );
 
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
+   esMemTexImage2D ( fileName, GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
@@ -134,12 +161,6 @@ void InitEmitParticles ( ESContext *esContext )
 
    char vShaderStr[] =
       "#version 300 es                                                     \n"
-      "#define NUM_PARTICLES           200                                 \n"
-      "#define ATTRIBUTE_POSITION      0                                   \n"
-      "#define ATTRIBUTE_VELOCITY      1                                   \n"
-      "#define ATTRIBUTE_SIZE          2                                   \n"
-      "#define ATTRIBUTE_CURTIME       3                                   \n"
-      "#define ATTRIBUTE_LIFETIME      4                                   \n"
       "uniform float u_time;                                               \n"
       "uniform float u_emissionRate;                                       \n"
       "uniform mediump sampler3D s_noiseTex;                               \n"
@@ -196,8 +217,6 @@ void InitEmitParticles ( ESContext *esContext )
       "  fragColor = vec4(1.0);                             \n"
       "}                                                    \n";
 
-   userData->emitProgramObject = esLoadProgram ( vShaderStr, fShaderStr );
-
    {
       const char *feedbackVaryings[5] =
       {
@@ -208,14 +227,23 @@ void InitEmitParticles ( ESContext *esContext )
          "v_lifetime"
       };
 
-      // Set the vertex shader outputs as transform feedback varyings
-      glTransformFeedbackVaryings ( userData->emitProgramObject, 5, feedbackVaryings, GL_INTERLEAVED_ATTRIBS );
+      ESProgramDesc base;
 
-      // Link program must occur after calling glTransformFeedbackVaryings
-      glLinkProgram ( userData->emitProgramObject );
+      // Set the vertex shader outputs as transform feedback varyings.  They must be set
+      // before the program is linked, so they are part of the variant's base program.
+      base.vertShaderSrc = vShaderStr;
+      base.fragShaderSrc = fShaderStr;
+      base.varyingCount = 5;
+      base.varyings = feedbackVaryings;
+      base.bufferMode = GL_INTERLEAVED_ATTRIBS;
+      base.programObject = 0;
 
-      // Get the uniform locations - this also needs to happen after glLinkProgram is called again so
-      // that the uniforms that output to varyings are active
+      esShaderVariantsInit ( &userData->emitVariants, &base );
+      userData->emitProgramObject = esGetShaderVariant ( &userData->emitVariants, particleDefines,
+                                                         sizeof ( particleDefines ) / sizeof ( particleDefines[0] ) );
+
+      // Get the uniform locations - this needs to happen after the program is linked with the
+      // varyings so that the uniforms that output to varyings are active
       userData->emitTimeLoc = glGetUniformLocation ( userData->emitProgramObject, "u_time" );
       userData->emitEmissionRateLoc = glGetUniformLocation ( userData->emitProgramObject, "u_emissionRate" );
       userData->emitNoiseSamplerLoc = glGetUniformLocation ( userData->emitProgramObject, "s_noiseTex" );
@@ -233,12 +261,6 @@ int Init ( ESContext *esContext )
 
    char vShaderStr[] =
       "#version 300 es                                                     \n"
-      "#define ATTRIBUTE_POSITION      0                                   \n"
-      "#define ATTRIBUTE_VELOCITY      1                                   \n"
-      "#define ATTRIBUTE_SIZE          2                                   \n"
-      "#define ATTRIBUTE_CURTIME       3                                   \n"
-      "#define ATTRIBUTE_LIFETIME      4                                   \n"
-      "                                                                    \n"
       "layout(location = ATTRIBUTE_POSITION) in vec2 a_position;           \n"
       "layout(location = ATTRIBUTE_VELOCITY) in vec2 a_velocity;           \n"
       "layout(location = ATTRIBUTE_SIZE) in float a_size;                  \n"
@@ -280,8 +302,18 @@ int Init ( ESContext *esContext )
 
    InitEmitParticles ( esContext );
 
-   // Load the shaders and get a linked program object
-   userData->drawProgramObject = esLoadProgram ( vShaderStr, fShaderStr );
+   // Load the shaders and get a linked program object specialized with the attribute locations
+   {
+      ESProgramDesc base;
+
+      memset ( &base, 0, sizeof ( base ) );
+      base.vertShaderSrc = vShaderStr;
+      base.fragShaderSrc = fShaderStr;
+
+      esShaderVariantsInit ( &userData->drawVariants, &base );
+      userData->drawProgramObject = esGetShaderVariant ( &userData->drawVariants, particleDefines,
+                                                         sizeof ( particleDefines ) / sizeof ( particleDefines[0] ) );
+   }
 
    // Get the uniform locations
    userData->drawTimeLoc = glGetUniformLocation ( userData->drawProgramObject, "u_time" );
@@ -302,7 +334,9 @@ int Init ( ESContext *esContext )
    }
 
    // Create a 3D noise texture for random values
+   esTraceBegin ( "Create3DNoiseTexture" );
    userData->noiseTextureId = Create3DNoiseTexture ( 128, 50.0 );
+   esTraceEnd ( );
 
    // Initialize particle data
    for ( i = 0; i < NUM_PARTICLES; i++ )
@@ -324,7 +358,7 @@ int Init ( ESContext *esContext )
    for ( i = 0; i < 2; i++ )
    {
       glBindBuffer ( GL_ARRAY_BUFFER, userData->particleVBOs[i] );
-      glBufferData ( GL_ARRAY_BUFFER, sizeof ( Particle ) * NUM_PARTICLES, particleData, GL_DYNAMIC_COPY );
+      esMemBufferData ( "particles", GL_ARRAY_BUFFER, sizeof ( Particle ) * NUM_PARTICLES, particleData, GL_DYNAMIC_COPY );
    }
 
    return TRUE;
@@ -332,32 +366,7 @@ int Init ( ESContext *esContext )
 
 void SetupVertexAttributes ( ESContext *esContext, GLuint vboID )
 {
-   glBindBuffer ( GL_ARRAY_BUFFER, vboID );
-   glVertexAttribPointer ( ATTRIBUTE_POSITION, 2, GL_FLOAT,
-                           GL_FALSE, sizeof ( Particle ),
-                           ( const void * ) NULL );
-
-   glVertexAttribPointer ( ATTRIBUTE_VELOCITY, 2, GL_FLOAT,
-                           GL_FALSE, sizeof ( Particle ),
-                           ( const void * ) offsetof ( Particle, velocity[0] ) );
-
-   glVertexAttribPointer ( ATTRIBUTE_SIZE, 1, GL_FLOAT,
-                           GL_FALSE, sizeof ( Particle ),
-                           ( const void * ) offsetof ( Particle, size ) );
-
-   glVertexAttribPointer ( ATTRIBUTE_CURTIME, 1, GL_FLOAT,
-                           GL_FALSE, sizeof ( Particle ),
-                           ( const void * ) offsetof ( Particle, curtime ) );
-
-   glVertexAttribPointer ( ATTRIBUTE_LIFETIME, 1, GL_FLOAT,
-                           GL_FALSE, sizeof ( Particle ),
-                           ( const void * ) offsetof ( Particle, lifetime ) );
-
-   glEnableVertexAttribArray ( ATTRIBUTE_POSITION );
-   glEnableVertexAttribArray ( ATTRIBUTE_VELOCITY );
-   glEnableVertexAttribArray ( ATTRIBUTE_SIZE );
-   glEnableVertexAttribArray ( ATTRIBUTE_CURTIME );
-   glEnableVertexAttribArray ( ATTRIBUTE_LIFETIME );
+   esBindVertexFormat ( particleFormat, sizeof ( particleFormat ) / sizeof ( particleFormat[0] ), &vboID, 0 );
 }
 
 void EmitParticles ( ESContext *esContext, float deltaTime )
@@ -387,9 +396,11 @@ void EmitParticles ( ESContext *esContext, float deltaTime )
    glUniform1i ( userData->emitNoiseSamplerLoc, 0 );
 
    // Emit particles using transform feedback
+   esGpuTimerBegin ( "emit" );
    glBeginTransformFeedback ( GL_POINTS );
    glDrawArrays ( GL_POINTS, 0, NUM_PARTICLES );
    glEndTransformFeedback();
+   esGpuTimerEnd ( );
 
    // Create a sync object to ensure transform feedback results are completed before the draw that uses them.
    userData->emitSync = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
@@ -457,7 +468,9 @@ void Draw ( ESContext *esContext )
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
 
+   esGpuTimerBegin ( "draw" );
    glDrawArrays ( GL_POINTS, 0, NUM_PARTICLES );
+   esGpuTimerEnd ( );
 }
 
 ///
@@ -468,13 +481,14 @@ void ShutDown ( ESContext *esContext )
    UserData *userData = esContext->userData;
 
    // Delete texture object
-   glDeleteTextures ( 1, &userData->textureId );
+   esMemDeleteTextures ( 1, &userData->textureId );
 
-   // Delete program object
-   glDeleteProgram ( userData->drawProgramObject );
-   glDeleteProgram ( userData->emitProgramObject );
+   // Delete the program objects of every variant
+   esShaderVariantsFree ( &userData->drawVariants );
+   esShaderVariantsFree ( &userData->emitVariants );
 
-   glDeleteBuffers ( 2, &userData->particleVBOs[0] );
+   esVertexArrayCacheClear ( );
+   esMemDeleteBuffers ( 2, &userData->particleVBOs[0] );
 }
 
 
@@ -33,24 +33,43 @@
 //
 //    Demonstrates shadow rendering with depth texture and 6x6 PCF
 //
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "esUtil.h"
 
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 
+// Uniform buffer binding point of the Transforms block
+#define TRANSFORMS_BINDING    0
+
+// Objects of the scene, in drawing order
+#define OBJECT_GROUND   0
+#define OBJECT_CUBE     1
+#define OBJECT_COUNT    2
+
+// Vertex format of the ground and the cube, the color is a constant attribute
+static const ESVertexAttrib positionFormat[] =
+{
+   { POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof ( GLfloat ), 0, 0, GL_FALSE }
+};
+
 typedef struct
 {
-   // Handle to a program object
+   // Shader variants and the program objects specialized from them
+   ESShaderVariants sceneVariants;
+   ESShaderVariants shadowMapVariants;
    GLuint sceneProgramObject;
    GLuint shadowMapProgramObject;
 
-   // Uniform locations
-   GLint  sceneMvpLoc;
-   GLint  shadowMapMvpLoc;
-   GLint  sceneMvpLightLoc;
-   GLint  shadowMapMvpLightLoc;
+   // Per-frame uniform buffer, and the Transforms blocks of the ground and the cube
+   // in it.  Both passes draw with the same blocks.
+   ESUniformRing uniformRing;
+   GLintptr   groundTransforms;
+   GLintptr   cubeTransforms;
+   GLsizeiptr transformsSize;
 
    // Sampler location
    GLint shadowMapSamplerLoc;
@@ -74,6 +93,13 @@ typedef struct
    // dimension of grid
    int    groundGridSize;
 
+   // Bounds of each object in model and world space, and the world space
+   // frustum planes of the two passes
+   ESBoundingBox modelBounds[OBJECT_COUNT];
+   ESBoundingBox worldBounds[OBJECT_COUNT];
+   GLfloat   scenePlanes[ES_PLANE_COUNT][4];
+   GLfloat   lightPlanes[ES_PLANE_COUNT][4];
+
    // MVP matrices
    ESMatrix  groundMvpMatrix;
    ESMatrix  groundMvpLightMatrix;
@@ -92,8 +118,9 @@ int InitMVP ( ESContext *esContext )
    ESMatrix perspective;
    ESMatrix ortho;
    ESMatrix modelview;
-   ESMatrix model;
+   ESAffine model;
    ESMatrix view;
+   ESMatrix viewProjection;
    float    aspect;
    UserData *userData = esContext->userData;
    
@@ -110,12 +137,13 @@ int InitMVP ( ESContext *esContext )
 
    // GROUND
    // Generate a model view matrix to rotate/translate the ground
-   esMatrixLoadIdentity ( &model );
+   esAffineLoadIdentity ( &model );
 
    // Center the ground
-   esTranslate ( &model, -2.0f, -2.0f, 0.0f );
-   esScale ( &model, 10.0f, 10.0f, 10.0f );
-   esRotate ( &model, 90.0f, 1.0f, 0.0f, 0.0f );
+   esAffineTranslate ( &model, -2.0f, -2.0f, 0.0f );
+   esAffineScale ( &model, 10.0f, 10.0f, 10.0f );
+   esAffineRotate ( &model, 90.0f, 1.0f, 0.0f, 0.0f );
+   esBoundingBoxTransform ( &userData->worldBounds[OBJECT_GROUND], &userData->modelBounds[OBJECT_GROUND], &model );
 
    // create view matrix transformation from the eye position
    esMatrixLookAt ( &view, 
@@ -123,7 +151,7 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
 
    // Compute the final ground MVP for the scene rendering by multiplying the 
    // modelview and perspective matrices together
@@ -135,7 +163,7 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
 
    // Compute the final ground MVP for the shadow map rendering by multiplying the 
    // modelview and ortho matrices together
@@ -143,10 +171,11 @@ int InitMVP ( ESContext *esContext )
 
    // CUBE
    // position the cube
-   esMatrixLoadIdentity ( &model );
-   esTranslate ( &model, 5.0f, -0.4f, -3.0f );
-   esScale ( &model, 1.0f, 2.5f, 1.0f );
-   esRotate ( &model, -15.0f, 0.0f, 1.0f, 0.0f );
+   esAffineLoadIdentity ( &model );
+   esAffineTranslate ( &model, 5.0f, -0.4f, -3.0f );
+   esAffineScale ( &model, 1.0f, 2.5f, 1.0f );
+   esAffineRotate ( &model, -15.0f, 0.0f, 1.0f, 0.0f );
+   esBoundingBoxTransform ( &userData->worldBounds[OBJECT_CUBE], &userData->modelBounds[OBJECT_CUBE], &model );
 
    // create view matrix transformation from the eye position
    esMatrixLookAt ( &view, 
@@ -154,7 +183,7 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
    
    // Compute the final cube MVP for scene rendering by multiplying the 
    // modelview and perspective matrices together
@@ -166,12 +195,27 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
    
    // Compute the final cube MVP for shadow map rendering by multiplying the 
    // modelview and ortho matrices together
    esMatrixMultiply ( &userData->cubeMvpLightMatrix, &modelview, &ortho );
 
+   // World space frustum planes of the scene and the shadow map passes, for culling
+   esMatrixLookAt ( &view, 
+                    userData->eyePosition[0], userData->eyePosition[1], userData->eyePosition[2],
+                    0.0f, 0.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f );
+   esMatrixMultiply ( &viewProjection, &view, &perspective );
+   esFrustumPlanesFromMatrix ( userData->scenePlanes, &viewProjection );
+
+   esMatrixLookAt ( &view, 
+                    userData->lightPosition[0], userData->lightPosition[1], userData->lightPosition[2],
+                    0.0f, 0.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f );
+   esMatrixMultiply ( &viewProjection, &view, &ortho );
+   esFrustumPlanesFromMatrix ( userData->lightPlanes, &viewProjection );
+
    return TRUE;
 }
 
@@ -195,9 +239,9 @@ int InitShadowMap ( ESContext *esContext )
    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE );
    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL );
         
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
-                  userData->shadowMapTextureWidth, userData->shadowMapTextureHeight, 
-                  0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL );
+   esMemTexImage2D ( "shadow map", GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+                     userData->shadowMapTextureWidth, userData->shadowMapTextureHeight,
+                     0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL );
 
    glBindTexture ( GL_TEXTURE_2D, 0 );
 
@@ -235,7 +279,11 @@ int Init ( ESContext *esContext )
    UserData *userData = esContext->userData;
    const char vShadowMapShaderStr[] =  
       "#version 300 es                                  \n"
-      "uniform mat4 u_mvpLightMatrix;                   \n"
+      "layout(std140) uniform Transforms                \n"
+      "{                                                \n"
+      "   mat4 u_mvpMatrix;                             \n"
+      "   mat4 u_mvpLightMatrix;                        \n"
+      "};                                               \n"
       "layout(location = 0) in vec4 a_position;         \n"
       "out vec4 v_color;                                \n"
       "void main()                                      \n"
@@ -252,8 +300,11 @@ int Init ( ESContext *esContext )
 
     const char vSceneShaderStr[] =  
       "#version 300 es                                   \n"
-      "uniform mat4 u_mvpMatrix;                         \n"
-      "uniform mat4 u_mvpLightMatrix;                    \n"
+      "layout(std140) uniform Transforms                 \n"
+      "{                                                 \n"
+      "   mat4 u_mvpMatrix;                              \n"
+      "   mat4 u_mvpLightMatrix;                         \n"
+      "};                                                \n"
       "layout(location = 0) in vec4 a_position;          \n"
       "layout(location = 1) in vec4 a_color;             \n"
       "out vec4 v_color;                                 \n"
@@ -287,64 +338,133 @@ int Init ( ESContext *esContext )
       "                                                               \n"
       "void main()                                                    \n"
       "{                                                              \n"
-      "   // 3x3 kernel with 4 taps per sample, effectively 6x6 PCF   \n"
+      "   // PCF_RADIUS 2.0 is a 3x3 kernel with 4 taps per sample,   \n"
+      "   // effectively 6x6 PCF.  The bounds are compile time         \n"
+      "   // constants so the loop can be unrolled.                   \n"
       "   float sum = 0.0;                                            \n"
       "   float x, y;                                                 \n"
-      "   for ( x = -2.0; x <= 2.0; x += 2.0 )                        \n"
-      "      for ( y = -2.0; y <= 2.0; y += 2.0 )                     \n"
+      "   for ( x = -PCF_RADIUS; x <= PCF_RADIUS; x += 2.0 )          \n"
+      "      for ( y = -PCF_RADIUS; y <= PCF_RADIUS; y += 2.0 )       \n"
       "         sum += lookup ( x, y );                               \n"
       "                                                               \n"
-      "   // divide sum by 9.0                                        \n"
-      "   sum = sum * 0.11;                                           \n"
+      "   // divide sum by the number of samples                      \n"
+      "   sum = sum * PCF_WEIGHT;                                     \n"
       "   outColor = v_color * sum;                                   \n"
       "}                                                              \n";
 
-   // Load the shaders and get a linked program object
-   userData->shadowMapProgramObject = esLoadProgram ( vShadowMapShaderStr, fShadowMapShaderStr );
-   userData->sceneProgramObject = esLoadProgram ( vSceneShaderStr, fSceneShaderStr );
+   // Load the shaders and get linked program objects, compiling both programs together.
+   // The scene program is specialized for the PCF kernel radius, ES_PCF_RADIUS texels.
+   {
+      ESProgramDesc base;
+      ESShaderVariantRequest requests[2];
+      ESShaderDefine pcfDefines[2];
+      char pcfRadius[16];
+      char pcfWeight[16];
+      const char *value = getenv ( "ES_PCF_RADIUS" );
+      int radius = value != NULL ? atoi ( value ) : 2;
+      int samples = 0;
+      int x;
+
+      // A negative radius would leave the kernel without samples
+      if ( radius < 0 )
+      {
+         radius = 0;
+      }
+
+      for ( x = -radius; x <= radius; x += 2 )
+      {
+         samples++;
+      }
+
+      // The default kernel keeps its original weight of 0.11 for 9 samples
+      sprintf ( pcfRadius, "%d.0", radius );
+      sprintf ( pcfWeight, "%.8f", radius == 2 ? 0.11 : 1.0 / ( samples * samples ) );
+      pcfDefines[0].name = "PCF_RADIUS";
+      pcfDefines[0].value = pcfRadius;
+      pcfDefines[1].name = "PCF_WEIGHT";
+      pcfDefines[1].value = pcfWeight;
+
+      memset ( &base, 0, sizeof ( base ) );
+      base.vertShaderSrc = vShadowMapShaderStr;
+      base.fragShaderSrc = fShadowMapShaderStr;
+      esShaderVariantsInit ( &userData->shadowMapVariants, &base );
+      base.vertShaderSrc = vSceneShaderStr;
+      base.fragShaderSrc = fSceneShaderStr;
+      esShaderVariantsInit ( &userData->sceneVariants, &base );
+
+      memset ( requests, 0, sizeof ( requests ) );
+      requests[0].variants = &userData->shadowMapVariants;
+      requests[1].variants = &userData->sceneVariants;
+      requests[1].defines = pcfDefines;
+      requests[1].defineCount = 2;
+
+      if ( !esGetShaderVariantsBatch ( requests, 2 ) )
+      {
+         return FALSE;
+      }
+
+      userData->shadowMapProgramObject = requests[0].programObject;
+      userData->sceneProgramObject = requests[1].programObject;
+   }
+
+   // Attach the Transforms block of both programs to one binding point, and get the
+   // sampler location from the reflected programs
+   {
+      ESProgram shadowMapProgram;
+      ESProgram sceneProgram;
+      GLuint64 transformsHash = esHashName ( "Transforms" );
+
+      esProgramReflect ( &shadowMapProgram, userData->shadowMapProgramObject );
+      esProgramReflect ( &sceneProgram, userData->sceneProgramObject );
 
-   // Get the uniform locations
-   userData->sceneMvpLoc = glGetUniformLocation ( userData->sceneProgramObject, "u_mvpMatrix" );
-   userData->shadowMapMvpLoc = glGetUniformLocation ( userData->shadowMapProgramObject, "u_mvpMatrix" );
-   userData->sceneMvpLightLoc = glGetUniformLocation ( userData->sceneProgramObject, "u_mvpLightMatrix" );
-   userData->shadowMapMvpLightLoc = glGetUniformLocation ( userData->shadowMapProgramObject, "u_mvpLightMatrix" );
+      glUniformBlockBinding ( userData->shadowMapProgramObject,
+                              esProgramUniformBlockIndex ( &shadowMapProgram, transformsHash ), TRANSFORMS_BINDING );
+      glUniformBlockBinding ( userData->sceneProgramObject,
+                              esProgramUniformBlockIndex ( &sceneProgram, transformsHash ), TRANSFORMS_BINDING );
 
-   // Get the sampler location
-   userData->shadowMapSamplerLoc = glGetUniformLocation ( userData->sceneProgramObject, "s_shadowMap" );
+      // Get the sampler location
+      userData->shadowMapSamplerLoc = esProgramUniformLocation ( &sceneProgram, esHashName ( "s_shadowMap" ) );
+
+      esProgramFree ( &shadowMapProgram );
+      esProgramFree ( &sceneProgram );
+   }
 
    // Generate the vertex and index data for the ground
    userData->groundGridSize = 3;
    userData->groundNumIndices = esGenSquareGrid( userData->groundGridSize, &positions, &indices );
+   esBoundingBoxFromPositions ( &userData->modelBounds[OBJECT_GROUND], positions,
+                                userData->groundGridSize * userData->groundGridSize );
 
    // Index buffer object for the ground model
    glGenBuffers ( 1, &userData->groundIndicesIBO );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->groundIndicesIBO );
-   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, userData->groundNumIndices * sizeof( GLuint ), indices, GL_STATIC_DRAW );
+   esMemBufferData ( "ground", GL_ELEMENT_ARRAY_BUFFER, userData->groundNumIndices * sizeof( GLuint ), indices, GL_STATIC_DRAW );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
    free( indices );
 
    // Position VBO for ground model
    glGenBuffers ( 1, &userData->groundPositionVBO );
    glBindBuffer ( GL_ARRAY_BUFFER, userData->groundPositionVBO );
-   glBufferData ( GL_ARRAY_BUFFER, userData->groundGridSize * userData->groundGridSize * sizeof( GLfloat ) * 3, 
-                  positions, GL_STATIC_DRAW );
+   esMemBufferData ( "ground", GL_ARRAY_BUFFER, userData->groundGridSize * userData->groundGridSize * sizeof( GLfloat ) * 3,
+                     positions, GL_STATIC_DRAW );
    free( positions );
 
    // Generate the vertex and index date for the cube model
    userData->cubeNumIndices = esGenCube ( 1.0f, &positions,
                                           NULL, NULL, &indices );
+   esBoundingBoxFromPositions ( &userData->modelBounds[OBJECT_CUBE], positions, 24 );
 
    // Index buffer object for cube model
    glGenBuffers ( 1, &userData->cubeIndicesIBO );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->cubeIndicesIBO );
-   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLuint ) * userData->cubeNumIndices, indices, GL_STATIC_DRAW );
+   esMemBufferData ( "cube", GL_ELEMENT_ARRAY_BUFFER, sizeof( GLuint ) * userData->cubeNumIndices, indices, GL_STATIC_DRAW );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
    free( indices );
 
    // Position VBO for cube model
    glGenBuffers ( 1, &userData->cubePositionVBO );
    glBindBuffer ( GL_ARRAY_BUFFER, userData->cubePositionVBO );
-   glBufferData ( GL_ARRAY_BUFFER, 24 * sizeof( GLfloat ) * 3, positions, GL_STATIC_DRAW );
+   esMemBufferData ( "cube", GL_ARRAY_BUFFER, 24 * sizeof( GLfloat ) * 3, positions, GL_STATIC_DRAW );
    free( positions );
 
    // setup transformation matrices
@@ -369,110 +489,171 @@ int Init ( ESContext *esContext )
    // enable depth test
    glEnable ( GL_DEPTH_TEST );
 
+   // Size of a Transforms block, and a ring of 3 frames with room for both models
+   {
+      ESStd140 layout = { NULL, 0 };
+
+      esStd140Mat4 ( &layout, NULL );
+      esStd140Mat4 ( &layout, NULL );
+      userData->transformsSize = esStd140End ( &layout );
+   }
+
+   if ( !esUniformRingInit ( &userData->uniformRing, 4096, 3 ) )
+   {
+      return FALSE;
+   }
+
+   // Back the blocks for the warm-up draws
+   esUniformRingBind ( &userData->uniformRing, TRANSFORMS_BINDING, 0, userData->transformsSize );
+
+   // Draw both passes once at load time so the first frame does not stall on driver work
+   {
+      ESShaderWarmup warmup;
+
+      warmup.name = "shadow map";
+      warmup.programObject = userData->shadowMapProgramObject;
+      warmup.attribs = positionFormat;
+      warmup.attribCount = 1;
+      warmup.mode = GL_TRIANGLES;
+      warmup.colorFormat = GL_NONE;
+      warmup.depthFormat = GL_DEPTH_COMPONENT24;
+      esShaderWarmupRegister ( &warmup );
+
+      warmup.name = "scene";
+      warmup.programObject = userData->sceneProgramObject;
+      warmup.colorFormat = GL_RGBA8;
+      esShaderWarmupRegister ( &warmup );
+
+      esShaderWarmupRun ( );
+   }
+
    return TRUE;
 }
 
 ///
-// Draw the model
+// Draw the objects inside the frustum planes
 //
-void DrawScene ( ESContext *esContext, 
-                 GLint mvpLoc, 
-                 GLint mvpLightLoc )
+void DrawScene ( ESContext *esContext, const GLfloat planes[ES_PLANE_COUNT][4] )
 {
    UserData *userData = esContext->userData;
- 
-   // Draw the ground
-   // Load the vertex position
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->groundPositionVBO );
-   glVertexAttribPointer ( POSITION_LOC, 3, GL_FLOAT, 
-                           GL_FALSE, 3 * sizeof(GLfloat), (const void*)NULL );
-   glEnableVertexAttribArray ( POSITION_LOC );   
-
-   // Bind the index buffer
-   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->groundIndicesIBO );
-
-   // Load the MVP matrix for the ground model
-   glUniformMatrix4fv ( mvpLoc, 1, GL_FALSE, (GLfloat*) &userData->groundMvpMatrix.m[0][0] );
-   glUniformMatrix4fv ( mvpLightLoc, 1, GL_FALSE, (GLfloat*) &userData->groundMvpLightMatrix.m[0][0] );
-
-   // Set the ground color to light gray
-   glVertexAttrib4f ( COLOR_LOC, 0.9f, 0.9f, 0.9f, 1.0f );
-
-   glDrawElements ( GL_TRIANGLES, userData->groundNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
-
-   // Draw the cube
-   // Load the vertex position
-   glBindBuffer( GL_ARRAY_BUFFER, userData->cubePositionVBO );
-   glVertexAttribPointer ( POSITION_LOC, 3, GL_FLOAT, 
-                           GL_FALSE, 3 * sizeof(GLfloat), (const void*)NULL );
-   glEnableVertexAttribArray ( POSITION_LOC );   
-
-   // Bind the index buffer
-   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->cubeIndicesIBO );
+   GLuint   visible[OBJECT_COUNT];
+   GLsizei  visibleCount;
+   GLsizei  i;
 
-   // Load the MVP matrix for the cube model
-   glUniformMatrix4fv ( mvpLoc, 1, GL_FALSE, (GLfloat*) &userData->cubeMvpMatrix.m[0][0] );
-   glUniformMatrix4fv ( mvpLightLoc, 1, GL_FALSE, (GLfloat*) &userData->cubeMvpLightMatrix.m[0][0] );
+   visibleCount = esCullBoxes ( planes, userData->worldBounds, OBJECT_COUNT, visible );
 
-   // Set the cube color to red
-   glVertexAttrib4f ( COLOR_LOC, 1.0f, 0.0f, 0.0f, 1.0f );
-
-   glDrawElements ( GL_TRIANGLES, userData->cubeNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
+   for ( i = 0; i < visibleCount; i++ )
+   {
+      if ( visible[i] == OBJECT_GROUND )
+      {
+         // Draw the ground
+         // Bind the vertex positions and the index buffer
+         esBindVertexFormat ( positionFormat, 1, &userData->groundPositionVBO, userData->groundIndicesIBO );
+
+         // Bind the MVP matrices for the ground model
+         esUniformRingBind ( &userData->uniformRing, TRANSFORMS_BINDING, userData->groundTransforms,
+                             userData->transformsSize );
+
+         // Set the ground color to light gray
+         glVertexAttrib4f ( COLOR_LOC, 0.9f, 0.9f, 0.9f, 1.0f );
+
+         glDrawElements ( GL_TRIANGLES, userData->groundNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
+      }
+      else
+      {
+         // Draw the cube
+         // Bind the vertex positions and the index buffer
+         esBindVertexFormat ( positionFormat, 1, &userData->cubePositionVBO, userData->cubeIndicesIBO );
+
+         // Bind the MVP matrices for the cube model
+         esUniformRingBind ( &userData->uniformRing, TRANSFORMS_BINDING, userData->cubeTransforms,
+                             userData->transformsSize );
+
+         // Set the cube color to red
+         glVertexAttrib4f ( COLOR_LOC, 1.0f, 0.0f, 0.0f, 1.0f );
+
+         glDrawElements ( GL_TRIANGLES, userData->cubeNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
+      }
+   }
 }
 
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
-   GLint defaultFramebuffer = 0;
+   GLuint defaultFramebuffer;
 
    // Initialize matrices
    InitMVP ( esContext );
 
-   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &defaultFramebuffer );
+   // Upload the matrices once for both passes
+   esUniformRingBegin ( &userData->uniformRing );
+   {
+      ESStd140 block;
+
+      block.data = esUniformRingAlloc ( &userData->uniformRing, userData->transformsSize,
+                                        &userData->groundTransforms );
+      block.offset = 0;
+      esStd140Mat4 ( &block, &userData->groundMvpMatrix );
+      esStd140Mat4 ( &block, &userData->groundMvpLightMatrix );
+
+      block.data = esUniformRingAlloc ( &userData->uniformRing, userData->transformsSize,
+                                        &userData->cubeTransforms );
+      block.offset = 0;
+      esStd140Mat4 ( &block, &userData->cubeMvpMatrix );
+      esStd140Mat4 ( &block, &userData->cubeMvpLightMatrix );
+   }
+   esUniformRingEnd ( &userData->uniformRing );
+
+   // The tracked binding, the driver is only queried on the first frame
+   defaultFramebuffer = esGetFramebufferBinding ( );
 
    // FIRST PASS: Render the scene from light position to generate the shadow map texture
-   glBindFramebuffer ( GL_FRAMEBUFFER, userData->shadowMapBufferId );
+   esBindFramebuffer ( GL_FRAMEBUFFER, userData->shadowMapBufferId );
 
    // Set the viewport
-   glViewport ( 0, 0, userData->shadowMapTextureWidth, userData->shadowMapTextureHeight );
+   esViewport ( 0, 0, userData->shadowMapTextureWidth, userData->shadowMapTextureHeight );
 
    // clear depth buffer
    glClear( GL_DEPTH_BUFFER_BIT );
 
    // disable color rendering, only write to depth buffer
-   glColorMask ( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+   esColorMask ( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
 
    // reduce shadow rendering artifact
-   glEnable ( GL_POLYGON_OFFSET_FILL );
+   esEnable ( GL_POLYGON_OFFSET_FILL );
    glPolygonOffset( 5.0f, 100.0f );
 
-   glUseProgram ( userData->shadowMapProgramObject );
-   DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc );
+   esUseProgram ( userData->shadowMapProgramObject );
+   esGpuTimerBegin ( "shadow map" );
+   DrawScene ( esContext, userData->lightPlanes );
+   esGpuTimerEnd ( );
 
-   glDisable( GL_POLYGON_OFFSET_FILL );
+   esDisable( GL_POLYGON_OFFSET_FILL );
 
    // SECOND PASS: Render the scene from eye location using the shadow map texture created in the first pass
-   glBindFramebuffer ( GL_FRAMEBUFFER, defaultFramebuffer );
-   glColorMask ( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+   esBindFramebuffer ( GL_FRAMEBUFFER, defaultFramebuffer );
+   esColorMask ( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esViewport ( 0, 0, esContext->width, esContext->height );
    
    // Clear the color and depth buffers
    glClear ( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
 
    // Use the scene program object
-   glUseProgram ( userData->sceneProgramObject );
+   esUseProgram ( userData->sceneProgramObject );
 
    // Bind the shadow map texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->shadowMapTextureId );
+   esActiveTexture ( GL_TEXTURE0 );
+   esBindTexture ( GL_TEXTURE_2D, userData->shadowMapTextureId );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->shadowMapSamplerLoc, 0 );
 
-   DrawScene ( esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc );
+   esGpuTimerBegin ( "scene" );
+   DrawScene ( esContext, userData->scenePlanes );
+   esGpuTimerEnd ( );
 }
 
 ///
@@ -482,22 +663,27 @@ void Shutdown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
-   glDeleteBuffers( 1, &userData->groundPositionVBO );
-   glDeleteBuffers( 1, &userData->groundIndicesIBO );
+   esVertexArrayCacheClear ( );
+
+   esMemDeleteBuffers( 1, &userData->groundPositionVBO );
+   esMemDeleteBuffers( 1, &userData->groundIndicesIBO );
 
-   glDeleteBuffers( 1, &userData->cubePositionVBO );
-   glDeleteBuffers( 1, &userData->cubeIndicesIBO );
+   esMemDeleteBuffers( 1, &userData->cubePositionVBO );
+   esMemDeleteBuffers( 1, &userData->cubeIndicesIBO );
    
    // Delete shadow map
    glBindFramebuffer ( GL_FRAMEBUFFER, userData->shadowMapBufferId );
    glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0 );
    glBindFramebuffer ( GL_FRAMEBUFFER, 0 );
+   esStateDeleteFramebuffers ( 1, &userData->shadowMapBufferId );
    glDeleteFramebuffers ( 1, &userData->shadowMapBufferId );
-   glDeleteTextures ( 1, &userData->shadowMapTextureId );
+   esMemDeleteTextures ( 1, &userData->shadowMapTextureId );
+
+   // Delete the program objects of every variant
+   esShaderVariantsFree ( &userData->sceneVariants );
+   esShaderVariantsFree ( &userData->shadowMapVariants );
 
-   // Delete program object
-   glDeleteProgram ( userData->sceneProgramObject );
-   glDeleteProgram ( userData->shadowMapProgramObject );
+   esUniformRingFree ( &userData->uniformRing );
 }
 
 int esMain ( ESContext *esContext )
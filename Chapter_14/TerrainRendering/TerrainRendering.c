@@ -226,6 +226,26 @@ int Init ( ESContext *esContext )
 
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
 
+   // Draw the terrain program once at load time so the first frame does not stall on driver work
+   {
+      static const ESVertexAttrib positionFormat[] =
+      {
+         { POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof ( GLfloat ), 0, 0, GL_FALSE }
+      };
+      ESShaderWarmup warmup;
+
+      warmup.name = "terrain";
+      warmup.programObject = userData->programObject;
+      warmup.attribs = positionFormat;
+      warmup.attribCount = 1;
+      warmup.mode = GL_TRIANGLES;
+      warmup.colorFormat = GL_RGBA8;
+      warmup.depthFormat = GL_DEPTH_COMPONENT24;
+      esShaderWarmupRegister ( &warmup );
+
+      esShaderWarmupRun ( );
+   }
+
    return TRUE;
 }
 
@@ -36,6 +36,7 @@
 //
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "esUtil.h"
 
 #ifdef _WIN32
@@ -45,6 +46,7 @@
 
 
 #define NUM_INSTANCES   100
+#define CUBE_SIZE       0.1f
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 #define MVP_LOC         2
@@ -66,8 +68,22 @@ typedef struct
    // Rotation angle
    GLfloat   angle[NUM_INSTANCES];
 
+   // Color of each instance
+   GLubyte   colors[NUM_INSTANCES][4];
+
 } UserData;
 
+///
+// Frame packet handed from Update() to Draw()
+//
+typedef struct
+{
+   // MVP and color of the instances that survived culling
+   ESMatrix  mvp[NUM_INSTANCES];
+   GLubyte   color[NUM_INSTANCES][4];
+   GLsizei   numInstances;
+} FramePacket;
+
 ///
 // Initialize the shader and program object
 //
@@ -103,7 +119,7 @@ int Init ( ESContext *esContext )
    userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
 
    // Generate the vertex data
-   userData->numIndices = esGenCube ( 0.1f, &positions,
+   userData->numIndices = esGenCube ( CUBE_SIZE, &positions,
                                       NULL, NULL, &indices );
 
    // Index buffer object
@@ -119,24 +135,23 @@ int Init ( ESContext *esContext )
    glBufferData ( GL_ARRAY_BUFFER, 24 * sizeof ( GLfloat ) * 3, positions, GL_STATIC_DRAW );
    free ( positions );
 
-   // Random color for each instance
+   // Random color for each instance, uploaded with the MVPs of the visible instances
    {
-      GLubyte colors[NUM_INSTANCES][4];
       int instance;
 
       srandom ( 0 );
 
       for ( instance = 0; instance < NUM_INSTANCES; instance++ )
       {
-         colors[instance][0] = random() % 255;
-         colors[instance][1] = random() % 255;
-         colors[instance][2] = random() % 255;
-         colors[instance][3] = 0;
+         userData->colors[instance][0] = random() % 255;
+         userData->colors[instance][1] = random() % 255;
+         userData->colors[instance][2] = random() % 255;
+         userData->colors[instance][3] = 0;
       }
 
       glGenBuffers ( 1, &userData->colorVBO );
       glBindBuffer ( GL_ARRAY_BUFFER, userData->colorVBO );
-      glBufferData ( GL_ARRAY_BUFFER, NUM_INSTANCES * 4, colors, GL_STATIC_DRAW );
+      glBufferData ( GL_ARRAY_BUFFER, NUM_INSTANCES * 4, NULL, GL_DYNAMIC_DRAW );
    }
 
    // Allocate storage to store MVP per instance
@@ -166,8 +181,12 @@ int Init ( ESContext *esContext )
 void Update ( ESContext *esContext, float deltaTime )
 {
    UserData *userData = ( UserData * ) esContext->userData;
-   ESMatrix *matrixBuf;
+   FramePacket *packet = ( FramePacket * ) esGetUpdatePacket ( esContext );
    ESMatrix perspective;
+   ESMatrix modelview[NUM_INSTANCES];
+   ESBoundingSphere bounds[NUM_INSTANCES];
+   GLuint   visible[NUM_INSTANCES];
+   GLfloat  planes[ES_PLANE_COUNT][4];
    float    aspect;
    int      instance = 0;
    int      numRows;
@@ -181,24 +200,20 @@ void Update ( ESContext *esContext, float deltaTime )
    esMatrixLoadIdentity ( &perspective );
    esPerspective ( &perspective, 60.0f, aspect, 1.0f, 20.0f );
 
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
-   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES, GL_MAP_WRITE_BIT );
-
    // Compute a per-instance MVP that translates and rotates each instance differnetly
    numRows = ( int ) sqrtf ( NUM_INSTANCES );
    numColumns = numRows;
 
    for ( instance = 0; instance < NUM_INSTANCES; instance++ )
    {
-      ESMatrix modelview;
       float translateX = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
       float translateY = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
 
       // Generate a model view matrix to rotate/translate the cube
-      esMatrixLoadIdentity ( &modelview );
+      esMatrixLoadIdentity ( &modelview[instance] );
 
       // Per-instance translation
-      esTranslate ( &modelview, translateX, translateY, -2.0f );
+      esTranslate ( &modelview[instance], translateX, translateY, -2.0f );
 
       // Compute a rotation angle based on time to rotate the cube
       userData->angle[instance] += ( deltaTime * 40.0f );
@@ -209,14 +224,24 @@ void Update ( ESContext *esContext, float deltaTime )
       }
 
       // Rotate the cube
-      esRotate ( &modelview, userData->angle[instance], 1.0, 0.0, 1.0 );
+      esRotate ( &modelview[instance], userData->angle[instance], 1.0, 0.0, 1.0 );
 
-      // Compute the final MVP by multiplying the
-      // modevleiw and perspective matrices together
-      esMatrixMultiply ( &matrixBuf[instance], &modelview, &perspective );
+      // Bounding sphere of the cube in eye space, around its translation
+      bounds[instance].center[0] = modelview[instance].m[3][0];
+      bounds[instance].center[1] = modelview[instance].m[3][1];
+      bounds[instance].center[2] = modelview[instance].m[3][2];
+      bounds[instance].radius = CUBE_SIZE * 0.5f * 1.7320508f;
    }
 
-   glUnmapBuffer ( GL_ARRAY_BUFFER );
+   // Skip the cubes outside the view frustum
+   esFrustumPlanesFromMatrix ( planes, &perspective );
+   packet->numInstances = esCullSpheres ( planes, bounds, NUM_INSTANCES, visible );
+   esCullGather ( modelview, modelview, sizeof ( ESMatrix ), visible, packet->numInstances );
+   esCullGather ( packet->color, userData->colors, 4, visible, packet->numInstances );
+
+   // Compute the final MVPs by multiplying the
+   // modelview and perspective matrices together
+   esMatrixMultiplyBatch ( packet->mvp, modelview, &perspective, packet->numInstances );
 }
 
 ///
@@ -225,6 +250,21 @@ void Update ( ESContext *esContext, float deltaTime )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   const FramePacket *packet = ( const FramePacket * ) esGetDrawPacket ( esContext );
+   ESMatrix *matrixBuf;
+
+   // Upload the MVPs and colors of the instances Update() found visible
+   if ( packet->numInstances > 0 )
+   {
+      glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
+      matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * packet->numInstances,
+                                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+      memcpy ( matrixBuf, packet->mvp, sizeof ( ESMatrix ) * packet->numInstances );
+      glUnmapBuffer ( GL_ARRAY_BUFFER );
+
+      glBindBuffer ( GL_ARRAY_BUFFER, userData->colorVBO );
+      glBufferSubData ( GL_ARRAY_BUFFER, 0, 4 * packet->numInstances, packet->color );
+   }
 
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
@@ -272,7 +312,7 @@ void Draw ( ESContext *esContext )
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
 
    // Draw the cubes
-   glDrawElementsInstanced ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL, NUM_INSTANCES );
+   glDrawElementsInstanced ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL, packet->numInstances );
 }
 
 ///
@@ -303,6 +343,9 @@ int esMain ( ESContext *esContext )
       return GL_FALSE;
    }
 
+   // Lets Update() run ahead of Draw() when ES_WINDOW_RENDER_THREAD is set
+   esRegisterFramePacket ( esContext, sizeof ( FramePacket ) );
+
    esRegisterShutdownFunc ( esContext, Shutdown );
    esRegisterUpdateFunc ( esContext, Update );
    esRegisterDrawFunc ( esContext, Draw );
@@ -0,0 +1,389 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+//
+/// \file esMath.hpp
+/// \brief Header-only C++ companion to the esTransform functions.  Mat4 is an
+///        ESMatrix, so it can be passed to the C API as is, but its operations
+///        return by value and are inline, and constexpr where they only need
+///        arithmetic, so constant matrices fold at compile time.  The row-vector
+///        convention and the order of operations match esTransform.c.
+///        Requires C++14.
+//
+#ifndef ESMATH_HPP
+#define ESMATH_HPP
+
+#if ( defined ( _MSVC_LANG ) ? _MSVC_LANG : __cplusplus ) < 201402L
+#error "esMath.hpp requires C++14"
+#endif
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <cmath>
+#include <type_traits>
+
+#if !defined ( ES_NO_SIMD ) && ( defined ( __SSE2__ ) || defined ( _M_X64 ) || \
+                                 ( defined ( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define ES_MATH_SSE
+#include <xmmintrin.h>
+#elif !defined ( ES_NO_SIMD ) && ( defined ( __ARM_NEON ) || defined ( __ARM_NEON__ ) )
+#define ES_MATH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace es
+{
+
+///
+//  Types
+//
+
+/// 3 component vector, a point or a direction
+struct Vec3
+{
+   float x, y, z;
+
+   constexpr Vec3 ( ) : x ( 0.0f ), y ( 0.0f ), z ( 0.0f ) {}
+   constexpr Vec3 ( float x_, float y_, float z_ ) : x ( x_ ), y ( y_ ), z ( z_ ) {}
+};
+
+/// Rotation quaternion, ( x, y, z ) is the axis times the sine of half the angle
+struct Quat
+{
+   float x, y, z, w;
+
+   constexpr Quat ( ) : x ( 0.0f ), y ( 0.0f ), z ( 0.0f ), w ( 1.0f ) {}
+   constexpr Quat ( float x_, float y_, float z_, float w_ ) : x ( x_ ), y ( y_ ), z ( z_ ), w ( w_ ) {}
+};
+
+/// 4x4 matrix, an ESMatrix with value semantics.  Default constructed to zero like
+/// an ESMatrix; use identity() for the identity.
+struct Mat4 : ESMatrix
+{
+   constexpr Mat4 ( ) : ESMatrix ( ) {}
+   constexpr Mat4 ( const ESMatrix &src ) : ESMatrix ( src ) {}
+   constexpr Mat4 ( float m00, float m01, float m02, float m03,
+                    float m10, float m11, float m12, float m13,
+                    float m20, float m21, float m22, float m23,
+                    float m30, float m31, float m32, float m33 )
+      : ESMatrix { { { m00, m01, m02, m03 },
+                     { m10, m11, m12, m13 },
+                     { m20, m21, m22, m23 },
+                     { m30, m31, m32, m33 } } }
+   {}
+};
+
+static_assert ( sizeof ( Mat4 ) == sizeof ( ESMatrix ), "Mat4 must stay layout-compatible with ESMatrix" );
+static_assert ( std::is_standard_layout<Mat4>::value, "Mat4 must stay layout-compatible with ESMatrix" );
+
+///
+//  Vector operations
+//
+constexpr Vec3 operator+ ( const Vec3 &a, const Vec3 &b ) { return Vec3 ( a.x + b.x, a.y + b.y, a.z + b.z ); }
+constexpr Vec3 operator- ( const Vec3 &a, const Vec3 &b ) { return Vec3 ( a.x - b.x, a.y - b.y, a.z - b.z ); }
+constexpr Vec3 operator- ( const Vec3 &a ) { return Vec3 ( -a.x, -a.y, -a.z ); }
+constexpr Vec3 operator* ( const Vec3 &a, float s ) { return Vec3 ( a.x * s, a.y * s, a.z * s ); }
+constexpr Vec3 operator* ( float s, const Vec3 &a ) { return Vec3 ( a.x * s, a.y * s, a.z * s ); }
+
+constexpr float dot ( const Vec3 &a, const Vec3 &b )
+{
+   return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+constexpr Vec3 cross ( const Vec3 &a, const Vec3 &b )
+{
+   return Vec3 ( a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x );
+}
+
+inline float length ( const Vec3 &a )
+{
+   return std::sqrt ( dot ( a, a ) );
+}
+
+/// Unit vector along a, a itself when it has zero length
+inline Vec3 normalize ( const Vec3 &a )
+{
+   float len = length ( a );
+
+   return len != 0.0f ? Vec3 ( a.x / len, a.y / len, a.z / len ) : a;
+}
+
+///
+//  Matrix operations
+//
+
+/// Identity matrix, esMatrixLoadIdentity()
+constexpr Mat4 identity ( )
+{
+   return Mat4 ( 1.0f, 0.0f, 0.0f, 0.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+/// a * b, esMatrixMultiply().  Scalar so it can be evaluated at compile time; the
+/// compiler vectorizes it once inlined.  See multiply() for the explicit SIMD form.
+constexpr Mat4 operator* ( const Mat4 &a, const Mat4 &b )
+{
+   Mat4 r;
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      for ( int j = 0; j < 4; j++ )
+      {
+         r.m[i][j] = ( a.m[i][0] * b.m[0][j] ) +
+                     ( a.m[i][1] * b.m[1][j] ) +
+                     ( a.m[i][2] * b.m[2][j] ) +
+                     ( a.m[i][3] * b.m[3][j] );
+      }
+   }
+
+   return r;
+}
+
+/// result = a * b with SSE2 or NEON, the same arithmetic as operator* and
+/// esMatrixMultiply().  result may be a or b.
+inline void multiply ( Mat4 &result, const Mat4 &a, const Mat4 &b )
+{
+#if defined ( ES_MATH_SSE )
+   __m128 b0 = _mm_loadu_ps ( b.m[0] );
+   __m128 b1 = _mm_loadu_ps ( b.m[1] );
+   __m128 b2 = _mm_loadu_ps ( b.m[2] );
+   __m128 b3 = _mm_loadu_ps ( b.m[3] );
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      __m128 row = _mm_mul_ps ( _mm_set1_ps ( a.m[i][0] ), b0 );
+
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_set1_ps ( a.m[i][1] ), b1 ) );
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_set1_ps ( a.m[i][2] ), b2 ) );
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_set1_ps ( a.m[i][3] ), b3 ) );
+      _mm_storeu_ps ( result.m[i], row );
+   }
+#elif defined ( ES_MATH_NEON )
+   float32x4_t b0 = vld1q_f32 ( b.m[0] );
+   float32x4_t b1 = vld1q_f32 ( b.m[1] );
+   float32x4_t b2 = vld1q_f32 ( b.m[2] );
+   float32x4_t b3 = vld1q_f32 ( b.m[3] );
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      float32x4_t row = vmulq_n_f32 ( b0, a.m[i][0] );
+
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b1, a.m[i][1] ) );
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b2, a.m[i][2] ) );
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b3, a.m[i][3] ) );
+      vst1q_f32 ( result.m[i], row );
+   }
+#else
+   result = a * b;
+#endif
+}
+
+inline Mat4 &operator*= ( Mat4 &a, const Mat4 &b )
+{
+   multiply ( a, a, b );
+   return a;
+}
+
+/// m scaled, esScale()
+constexpr Mat4 scale ( const Mat4 &m, float sx, float sy, float sz )
+{
+   Mat4 r = m;
+
+   for ( int j = 0; j < 4; j++ )
+   {
+      r.m[0][j] *= sx;
+      r.m[1][j] *= sy;
+      r.m[2][j] *= sz;
+   }
+
+   return r;
+}
+
+/// m translated, esTranslate()
+constexpr Mat4 translate ( const Mat4 &m, float tx, float ty, float tz )
+{
+   Mat4 r = m;
+
+   for ( int j = 0; j < 4; j++ )
+   {
+      r.m[3][j] += ( m.m[0][j] * tx + m.m[1][j] * ty + m.m[2][j] * tz );
+   }
+
+   return r;
+}
+
+/// Rotation matrix of a unit quaternion, the matrix esRotate() multiplies by
+constexpr Mat4 toMat4 ( const Quat &q )
+{
+   return Mat4 ( 1.0f - 2.0f * ( q.y * q.y + q.z * q.z ), 2.0f * ( q.x * q.y - q.w * q.z ),
+                 2.0f * ( q.x * q.z + q.w * q.y ), 0.0f,
+                 2.0f * ( q.x * q.y + q.w * q.z ), 1.0f - 2.0f * ( q.x * q.x + q.z * q.z ),
+                 2.0f * ( q.y * q.z - q.w * q.x ), 0.0f,
+                 2.0f * ( q.x * q.z - q.w * q.y ), 2.0f * ( q.y * q.z + q.w * q.x ),
+                 1.0f - 2.0f * ( q.x * q.x + q.y * q.y ), 0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+/// m rotated by a unit quaternion
+constexpr Mat4 rotate ( const Mat4 &m, const Quat &q )
+{
+   return toMat4 ( q ) * m;
+}
+
+/// m rotated about an axis by a precomputed sine and cosine, esRotateSinCos()
+inline Mat4 rotateSinCos ( const Mat4 &m, float sinAngle, float cosAngle, const Vec3 &axis )
+{
+   Mat4 r = m;
+
+   esRotateSinCos ( &r, sinAngle, cosAngle, axis.x, axis.y, axis.z );
+   return r;
+}
+
+/// m rotated by angle degrees about an axis, esRotate()
+inline Mat4 rotate ( const Mat4 &m, float angle, const Vec3 &axis )
+{
+   Mat4 r = m;
+
+   esRotate ( &r, angle, axis.x, axis.y, axis.z );
+   return r;
+}
+
+/// Perspective projection, esFrustum() applied to the identity
+constexpr Mat4 frustum ( float left, float right, float bottom, float top, float nearZ, float farZ )
+{
+   float deltaX = right - left;
+   float deltaY = top - bottom;
+   float deltaZ = farZ - nearZ;
+
+   if ( ( nearZ <= 0.0f ) || ( farZ <= 0.0f ) ||
+        ( deltaX <= 0.0f ) || ( deltaY <= 0.0f ) || ( deltaZ <= 0.0f ) )
+   {
+      return identity ( );
+   }
+
+   return Mat4 ( 2.0f * nearZ / deltaX, 0.0f, 0.0f, 0.0f,
+                 0.0f, 2.0f * nearZ / deltaY, 0.0f, 0.0f,
+                 ( right + left ) / deltaX, ( top + bottom ) / deltaY, - ( nearZ + farZ ) / deltaZ, -1.0f,
+                 0.0f, 0.0f, -2.0f * nearZ * farZ / deltaZ, 0.0f );
+}
+
+/// Perspective projection, esPerspective() applied to the identity.  Not constexpr
+/// because std::tan is not, but folded by the compiler for constant arguments.
+inline Mat4 perspective ( float fovy, float aspect, float nearZ, float farZ )
+{
+   float frustumH = std::tan ( fovy / 360.0f * 3.1415926535897932384626433832795f ) * nearZ;
+   float frustumW = frustumH * aspect;
+
+   return frustum ( -frustumW, frustumW, -frustumH, frustumH, nearZ, farZ );
+}
+
+/// Orthographic projection, esOrtho() applied to the identity
+constexpr Mat4 ortho ( float left, float right, float bottom, float top, float nearZ, float farZ )
+{
+   float deltaX = right - left;
+   float deltaY = top - bottom;
+   float deltaZ = farZ - nearZ;
+
+   if ( ( deltaX == 0.0f ) || ( deltaY == 0.0f ) || ( deltaZ == 0.0f ) )
+   {
+      return identity ( );
+   }
+
+   return Mat4 ( 2.0f / deltaX, 0.0f, 0.0f, 0.0f,
+                 0.0f, 2.0f / deltaY, 0.0f, 0.0f,
+                 0.0f, 0.0f, -2.0f / deltaZ, 0.0f,
+                 - ( right + left ) / deltaX, - ( top + bottom ) / deltaY, - ( nearZ + farZ ) / deltaZ, 1.0f );
+}
+
+/// View matrix, esMatrixLookAt()
+inline Mat4 lookAt ( const Vec3 &pos, const Vec3 &lookAt, const Vec3 &up )
+{
+   Vec3 axisZ = normalize ( lookAt - pos );
+   Vec3 axisX = normalize ( cross ( up, axisZ ) );
+   Vec3 axisY = normalize ( cross ( axisZ, axisX ) );
+
+   return Mat4 ( -axisX.x, axisY.x, -axisZ.x, 0.0f,
+                 -axisX.y, axisY.y, -axisZ.y, 0.0f,
+                 -axisX.z, axisY.z, -axisZ.z, 0.0f,
+                 dot ( axisX, pos ), -dot ( axisY, pos ), dot ( axisZ, pos ), 1.0f );
+}
+
+/// Point p transformed by m as a row vector with w = 1, without the divide by w
+constexpr Vec3 transformPoint ( const Vec3 &p, const Mat4 &m )
+{
+   return Vec3 ( p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+                 p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+                 p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2] );
+}
+
+/// Direction v transformed by m, ignoring the translation
+constexpr Vec3 transformVector ( const Vec3 &v, const Mat4 &m )
+{
+   return Vec3 ( v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+                 v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+                 v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] );
+}
+
+///
+//  Quaternion operations
+//
+
+/// Hamilton product, so that toMat4 ( a * b ) equals toMat4 ( a ) * toMat4 ( b )
+constexpr Quat operator* ( const Quat &a, const Quat &b )
+{
+   return Quat ( a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                 a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                 a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                 a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z );
+}
+
+/// Inverse rotation of a unit quaternion
+constexpr Quat conjugate ( const Quat &q )
+{
+   return Quat ( -q.x, -q.y, -q.z, q.w );
+}
+
+/// Rotation by angle degrees about an axis, the rotation of esRotate()
+inline Quat fromAxisAngle ( float angle, const Vec3 &axis )
+{
+   float halfAngle = angle * 3.1415926535897932384626433832795f / 360.0f;
+   Vec3  unit = normalize ( axis ) * std::sin ( halfAngle );
+
+   return Quat ( unit.x, unit.y, unit.z, std::cos ( halfAngle ) );
+}
+
+} // namespace es
+
+#endif // ESMATH_HPP
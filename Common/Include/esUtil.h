@@ -78,6 +78,12 @@ extern "C" {
 #define ES_WINDOW_STENCIL       4
 /// esCreateWindow flat - multi-sample buffer
 #define ES_WINDOW_MULTISAMPLE   8
+/// esCreateWindow flag - render to an offscreen pbuffer instead of a native window
+#define ES_WINDOW_OFFSCREEN     16
+/// esCreateWindow flag - only redraw on request, on expose and on input
+#define ES_WINDOW_ON_DEMAND     32
+/// esCreateWindow flag - draw and swap on a render thread, see esRegisterFramePacket()
+#define ES_WINDOW_RENDER_THREAD 64
 
 
 ///
@@ -95,6 +101,314 @@ typedef struct
    GLfloat   m[4][4];
 } ESMatrix;
 
+/// An ESMatrix whose last column is ( 0, 0, 0, 1 ) and is not stored.  Rows 0-2 are the
+/// rotation and scale, row 3 is the translation.
+typedef struct
+{
+   GLfloat   m[4][3];
+} ESAffine;
+
+/// Planes of esFrustumPlanesFromMatrix()
+#define ES_PLANE_LEFT           0
+#define ES_PLANE_RIGHT          1
+#define ES_PLANE_BOTTOM         2
+#define ES_PLANE_TOP            3
+#define ES_PLANE_NEAR           4
+#define ES_PLANE_FAR            5
+#define ES_PLANE_COUNT          6
+
+/// Bounds tested by esCullSpheres() and esCullBoxes()
+typedef struct
+{
+   GLfloat   center[3];
+   GLfloat   radius;
+} ESBoundingSphere;
+
+typedef struct
+{
+   GLfloat   min[3];
+   GLfloat   max[3];
+} ESBoundingBox;
+
+typedef struct
+{
+   /// Number of measured frames to run, 0 disables benchmark mode
+   GLint     frames;
+
+   /// Number of frames to run before measurement starts
+   GLint     warmupFrames;
+
+   /// deltaTime passed to the update callback on every frame
+   GLfloat   fixedDeltaTime;
+
+   /// Number of frames run so far, including warm-up frames
+   GLint     frameCount;
+
+   /// Time of the previous frame boundary in seconds
+   double    lastTime;
+
+   /// Durations in seconds of the measured frames
+   double   *frameTimes;
+} ESBenchmark;
+
+typedef struct
+{
+   /// Vertex and fragment shader source code
+   const char  *vertShaderSrc;
+   const char  *fragShaderSrc;
+
+   /// Transform feedback varyings captured from the vertex shader, varyingCount 0 for none
+   GLsizei      varyingCount;
+   const char *const *varyings;
+   GLenum       bufferMode;
+
+   /// Set by esLoadProgramsBatch() to the linked program, 0 on failure
+   GLuint       programObject;
+} ESProgramDesc;
+
+typedef struct
+{
+   /// esHashName() of the variable name, without the [0] of arrays
+   GLuint64     nameHash;
+
+   /// Uniform or attribute location, or uniform block index
+   GLint        location;
+
+   /// Variable type, GL_NONE for uniform blocks
+   GLenum       type;
+
+   /// Array size, or data size in bytes for uniform blocks.  0 marks an empty slot.
+   GLint        size;
+} ESProgramVariable;
+
+typedef struct
+{
+   /// Open-addressed table of mask + 1 slots, probed linearly from the low 32 bits of nameHash & mask
+   ESProgramVariable *entries;
+   GLuint       mask;
+   GLint        count;
+} ESProgramTable;
+
+typedef struct
+{
+   GLuint       programObject;
+
+   /// Active default-block uniforms, attributes and uniform blocks
+   ESProgramTable uniforms;
+   ESProgramTable attributes;
+   ESProgramTable uniformBlocks;
+} ESProgram;
+
+typedef struct
+{
+   /// Preprocessor macro injected after the #version line as "#define name value"
+   const char  *name;
+   const char  *value;
+} ESShaderDefine;
+
+typedef struct
+{
+   /// Hash of the define names and values the variant was compiled with
+   GLuint64     key;
+
+   /// Linked program, 0 if the variant failed to build
+   GLuint       programObject;
+} ESShaderVariant;
+
+typedef struct
+{
+   /// Private copy of the base sources and varyings shared by every variant
+   ESProgramDesc base;
+
+   /// Variants compiled so far
+   ESShaderVariant *variants;
+   GLsizei      count;
+   GLsizei      capacity;
+} ESShaderVariants;
+
+typedef struct
+{
+   /// Variant set and the defines selecting the variant
+   ESShaderVariants     *variants;
+   const ESShaderDefine *defines;
+   GLsizei              defineCount;
+
+   /// Set by esGetShaderVariantsBatch() to the variant's program, 0 on failure
+   GLuint               programObject;
+} ESShaderVariantRequest;
+
+typedef struct
+{
+   /// Attribute location and glVertexAttribPointer() layout in its buffer
+   GLuint       index;
+   GLint        size;
+   GLenum       type;
+   GLboolean    normalized;
+   GLsizei      stride;
+   GLuint       offset;
+
+   /// Buffer slot the attribute is read from, an index into the buffers of esBindVertexFormat()
+   GLuint       buffer;
+
+   /// GL_TRUE to read an integer type as integers with glVertexAttribIPointer()
+   GLboolean    integer;
+} ESVertexAttrib;
+
+typedef struct
+{
+   /// Name reported with the warm-up time
+   const char  *name;
+
+   /// Program drawn with, and the vertex attributes it reads.  attribs must stay valid until
+   /// esShaderWarmupRun().
+   GLuint       programObject;
+   const ESVertexAttrib *attribs;
+   GLsizei      attribCount;
+   GLenum       mode;
+
+   /// Render target formats, GL_NONE for no color or no depth attachment
+   GLenum       colorFormat;
+   GLenum       depthFormat;
+} ESShaderWarmup;
+
+/// GPU memory categories of esGetGpuMemory(), ES_MEMORY_CATEGORIES for the sum of all
+#define ES_MEMORY_BUFFER        0
+#define ES_MEMORY_TEXTURE       1
+#define ES_MEMORY_RENDERBUFFER  2
+#define ES_MEMORY_CATEGORIES    3
+
+/// Largest number of frames in flight esSetMaxFramesInFlight() accepts
+#define ES_MAX_FRAMES_IN_FLIGHT 8
+
+typedef struct
+{
+   /// Swap interval applied to the window surface, valid if swapIntervalSet is GL_TRUE
+   GLint     swapInterval;
+   GLboolean swapIntervalSet;
+
+   /// Number of frames the CPU may queue ahead of the GPU, 0 for no limit
+   GLint     maxFramesInFlight;
+
+   /// Frame rate the loop is limited to, 0 for no limit
+   GLfloat   targetFps;
+
+   /// Fences of the frames in flight, indexed by frame number modulo maxFramesInFlight
+   GLsync    fences[ES_MAX_FRAMES_IN_FLIGHT];
+   GLuint    frameIndex;
+
+   /// Time the next frame may start at when targetFps is set
+   double    nextFrameTime;
+
+   /// Interval in seconds the update callback is called at, 0 calls it once per frame
+   GLfloat   fixedTimestep;
+
+   /// Most fixed timesteps run per frame before simulation time is dropped
+   GLint     maxUpdatesPerFrame;
+
+   /// Elapsed time not yet consumed by a fixed timestep
+   double    updateAccumulator;
+
+   /// Fraction of a fixed timestep elapsed since the last update, see esGetInterpolationAlpha()
+   GLfloat   interpolationAlpha;
+} ESFramePacing;
+
+typedef struct
+{
+   GLuint       bufferId;
+
+   /// Bytes per frame region, a multiple of alignment, and the number of regions
+   GLsizeiptr   frameSize;
+   GLuint       frameCount;
+
+   /// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+   GLint        alignment;
+
+   /// Region being written, its mapping while between esUniformRingBegin() and
+   /// esUniformRingEnd(), and the offset of the next allocation in it
+   GLuint       frame;
+   GLubyte     *mapped;
+   GLsizeiptr   used;
+
+   /// Fence of the last frame that drew from each region
+   GLsync       fences[ES_MAX_FRAMES_IN_FLIGHT];
+   GLboolean    started;
+} ESUniformRing;
+
+typedef struct
+{
+   /// Destination of the block, NULL to only compute the layout
+   GLubyte     *data;
+
+   /// Offset of the next member.  Once every member is written, the block size.
+   GLsizeiptr   offset;
+} ESStd140;
+
+typedef struct
+{
+   /// Frames counted, 1 for the counters of the last frame
+   GLuint       frames;
+
+   /// State calls passed on to GL, and redundant ones skipped by the state tracker
+   GLuint       issued;
+   GLuint       skipped;
+} ESStateCounters;
+
+typedef struct
+{
+   /// Frames counted, 1 for the counters of the last frame
+   GLuint       frames;
+
+   /// Draw calls, and primitives they submitted counting every instance
+   GLuint       drawCalls;
+   GLuint       primitives;
+
+   /// glUseProgram() and glBindTexture() calls
+   GLuint       programBinds;
+   GLuint       textureBinds;
+
+   /// Bytes passed to glBufferData()/glBufferSubData(), and mapped for writing with glMapBufferRange()
+   GLuint       bufferUploads;
+   double       bufferUploadBytes;
+   GLuint       bufferMaps;
+   double       bufferMapBytes;
+
+   /// Bytes passed to glTexImage*()/glTexSubImage*()/glCompressedTex*()
+   GLuint       textureUploads;
+   double       textureUploadBytes;
+
+   /// glClientWaitSync(), glWaitSync() and glFinish() calls and the seconds spent in them
+   GLuint       syncWaits;
+   double       syncWaitTime;
+} ESGLCounters;
+
+/// Number of buckets in an ESHistogram.  Bucket i counts samples between
+/// 2^(i/4) and 2^((i+1)/4) microseconds; the last bucket also counts longer samples.
+#define ES_HISTOGRAM_BUCKETS    80
+
+typedef struct
+{
+   /// Number of samples
+   GLuint    count;
+
+   /// Sum, minimum and maximum of the samples in seconds
+   double    total;
+   double    min;
+   double    max;
+
+   /// Sample counts per bucket
+   GLuint    buckets[ES_HISTOGRAM_BUCKETS];
+} ESHistogram;
+
+/// Main loop phases timed into ESContext::phaseHistograms
+enum
+{
+   ES_PHASE_UPDATE = 0,   ///< updateFunc
+   ES_PHASE_DRAW,         ///< drawFunc
+   ES_PHASE_SWAP,         ///< eglSwapBuffers
+   ES_PHASE_FRAME,        ///< whole main loop iteration
+   ES_PHASE_COUNT
+};
+
 typedef struct ESContext ESContext;
 
 struct ESContext
@@ -111,6 +425,9 @@ struct ESContext
    /// Window height
    GLint       height;
 
+   /// Window creation flags the window was created with
+   GLuint      flags;
+
 #ifndef __APPLE__
    /// Display handle
    EGLNativeDisplayType eglNativeDisplay;
@@ -128,6 +445,40 @@ struct ESContext
    EGLSurface  eglSurface;
 #endif
 
+   /// Benchmark mode state, see esBenchmarkInit()
+   ESBenchmark benchmark;
+
+   /// Swap interval and frame rate limits, see esFramePacingInit()
+   ESFramePacing framePacing;
+
+   /// CPU time histograms of the main loop phases, indexed by ES_PHASE_*
+   ESHistogram phaseHistograms[ES_PHASE_COUNT];
+
+   /// File the phase histograms are written to at shutdown, NULL for none
+   const char *phaseHistogramFile;
+
+   /// Two frame packets of framePacketSize bytes, see esRegisterFramePacket()
+   void       *framePackets[2];
+   GLsizei     framePacketSize;
+
+   /// ES_WINDOW_RENDER_THREAD: interpolation alpha each packet was submitted with
+   GLfloat     framePacketAlpha[2];
+
+   /// Packet the update callback writes and packet the draw callback reads
+   void       *updatePacket;
+   const void *drawPacket;
+
+   /// ES_WINDOW_RENDER_THREAD: render thread state, NULL when drawing on the main thread
+   void       *renderThread;
+
+   /// ES_WINDOW_ON_DEMAND: a redraw has been requested since the last frame.  Only the
+   /// main thread touches it, see esRenderThreadTakeRedraw()
+   GLboolean   redrawPending;
+
+   /// ES_WINDOW_ON_DEMAND: longest time in seconds the loop sleeps before calling
+   /// the update callback without a redraw, 0 sleeps until an event arrives
+   GLfloat     idleTimeout;
+
    /// Callbacks
    void ( ESCALLBACK *drawFunc ) ( ESContext * );
    void ( ESCALLBACK *shutdownFunc ) ( ESContext * );
@@ -152,6 +503,14 @@ struct ESContext
 ///         ES_WINDOW_DEPTH   - specifies that a depth buffer should be created
 ///         ES_WINDOW_STENCIL - specifies that a stencil buffer should be created
 ///         ES_WINDOW_MULTISAMPLE - specifies that a multi-sample buffer should be created
+///         ES_WINDOW_OFFSCREEN - specifies that rendering goes to a pbuffer with no native window.
+///                               Setting the ES_WINDOW_OFFSCREEN environment variable to 1 forces this flag.
+///         ES_WINDOW_ON_DEMAND - specifies that the main loop sleeps until esRequestRedraw() is called or
+///                               an expose or key event arrives, instead of redrawing continuously.
+///                               Setting the ES_WINDOW_ON_DEMAND environment variable to 1 forces this flag.
+///         ES_WINDOW_RENDER_THREAD - specifies that the draw callback and the buffer swap run on a separate
+///                               thread that owns the context.  Requires a frame packet, see esRegisterFramePacket().
+///                               Setting the ES_WINDOW_RENDER_THREAD environment variable to 1 forces this flag.
 /// \return GL_TRUE if window creation is succesful, GL_FALSE otherwise
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, GLint width, GLint height, GLuint flags );
 
@@ -183,14 +542,325 @@ void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void ( ESCALLBACK *
 //
 void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
                                     void ( ESCALLBACK *drawFunc ) ( ESContext *, unsigned char, int, int ) );
+
+//
+/// \brief Allocate the frame packets that carry state from the update callback to the draw
+///        callback.  With ES_WINDOW_RENDER_THREAD the two packets alternate between the threads;
+///        the update packet starts as a copy of the previous one.  Otherwise both share one packet.
+/// \param esContext Application context
+/// \param size Packet size in bytes
+/// \return GL_TRUE on success, GL_FALSE if size is invalid, a packet exists or allocation fails
+//
+GLboolean ESUTIL_API esRegisterFramePacket ( ESContext *esContext, GLsizei size );
+
+//
+/// \brief Return the frame packet the update callback writes
+/// \param esContext Application context
+//
+void *ESUTIL_API esGetUpdatePacket ( ESContext *esContext );
+
+//
+/// \brief Return the frame packet the draw callback reads.  With ES_WINDOW_RENDER_THREAD the draw
+///        callback must only read this packet and GL objects, never state the update callback writes.
+/// \param esContext Application context
+//
+const void *ESUTIL_API esGetDrawPacket ( ESContext *esContext );
+
+//
+/// \brief Start the render thread if requested and a frame packet is registered.  Called by the main loop.
+/// \param esContext Application context
+/// \return GL_TRUE if drawing moved to the render thread
+//
+GLboolean ESUTIL_API esRenderThreadStart ( ESContext *esContext );
+
+//
+/// \brief Return whether the calling thread is the render thread
+/// \param esContext Application context
+/// \return GL_TRUE on the render thread, GL_FALSE on any other thread or without a render thread
+//
+GLboolean ESUTIL_API esOnRenderThread ( ESContext *esContext );
+
+//
+/// \brief Wait until the update packet is free.  Called by the main loop before the update callback.
+/// \param esContext Application context
+//
+void ESUTIL_API esRenderThreadBeginUpdate ( ESContext *esContext );
+
+//
+/// \brief Queue the update packet for drawing.  Called by the main loop instead of drawing.
+/// \param esContext Application context
+//
+void ESUTIL_API esRenderThreadSubmit ( ESContext *esContext );
+
+//
+/// \brief Present the queued frames, join the render thread and make the context current again
+/// \param esContext Application context
+//
+void ESUTIL_API esRenderThreadStop ( ESContext *esContext );
+
+//
+/// \brief Record a redraw requested by the draw callback on the render thread and wake the main loop.
+///        Called by esRequestRedraw().
+/// \param esContext Application context
+//
+void ESUTIL_API esRenderThreadRequestRedraw ( ESContext *esContext );
+
+//
+/// \brief Return and clear a redraw requested on the render thread.  Called by the main loop.
+/// \param esContext Application context
+/// \return GL_TRUE if the render thread requested a redraw since the last call
+//
+GLboolean ESUTIL_API esRenderThreadTakeRedraw ( ESContext *esContext );
+
+//
+/// \brief Request that the next iteration of the main loop draws a frame.  Only needed for
+///        windows created with ES_WINDOW_ON_DEMAND; may be called from the update or draw callbacks,
+///        including a draw callback on the render thread, which wakes the sleeping main loop.
+/// \param esContext Application context
+//
+void ESUTIL_API esRequestRedraw ( ESContext *esContext );
 //
 /// \brief Log a message to the debug output for the platform
 /// \param formatStr Format string for error log.
 //
 void ESUTIL_API esLogMessage ( const char *formatStr, ... );
 
+//
+/// \brief Return a monotonic time in seconds.  Only differences between two values are meaningful.
+//
+double ESUTIL_API esGetTime ( void );
+
+//
+/// \brief Look up a command line option value, falling back to an environment variable
+/// \param argc, argv Command line arguments passed to main
+/// \param option Option name, for example "--frames".  The value is the following argument.
+/// \param envName Environment variable to read if the option is not given, may be NULL
+/// \return The option value, or NULL if neither is set
+//
+const char *ESUTIL_API esGetOption ( int argc, char *argv[], const char *option, const char *envName );
+
+//
+/// \brief Configure benchmark mode from the command line and environment.  Recognized options are
+///        --frames N (ES_BENCHMARK_FRAMES), the number of measured frames to run before exiting,
+///        --warmup M (ES_BENCHMARK_WARMUP), the number of unmeasured frames to run first, and
+///        --fixed-dt S (ES_BENCHMARK_FIXED_DT), the deltaTime in seconds passed to the update callback,
+///        which defaults to 1/60 when --frames is given.
+/// \param esContext Application context
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esBenchmarkInit ( ESContext *esContext, int argc, char *argv[] );
+
+//
+/// \brief Record the end of a frame in benchmark mode
+/// \param esContext Application context
+/// \return GL_TRUE once all measured frames have been run, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esBenchmarkFrame ( ESContext *esContext );
+
+//
+/// \brief Print the min, median, p95, p99 and max frame time and the frame rate of a benchmark run,
+///        then release the recorded frame times
+/// \param esContext Application context
+//
+void ESUTIL_API esBenchmarkReport ( ESContext *esContext );
+
+//
+/// \brief Configure frame pacing from the command line and environment.  Recognized options are
+///        --swap-interval N (ES_SWAP_INTERVAL), --max-frames-in-flight N (ES_MAX_FRAMES_IN_FLIGHT),
+///        --target-fps F (ES_TARGET_FPS) and --fixed-timestep S (ES_FIXED_TIMESTEP).
+/// \param esContext Application context
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esFramePacingInit ( ESContext *esContext, int argc, char *argv[] );
+
+//
+/// \brief Set the minimum number of display refreshes between buffer swaps.  Takes effect
+///        immediately if the window exists, otherwise when esCreateWindow() creates it.
+/// \param esContext Application context
+/// \param interval Swap interval, 0 disables vertical sync
+/// \return GL_TRUE on success, GL_FALSE if EGL rejected the interval
+//
+GLboolean ESUTIL_API esSetSwapInterval ( ESContext *esContext, GLint interval );
+
+//
+/// \brief Limit how many frames the CPU may submit before the GPU finishes them.  The main loop
+///        places a fence after each swap and waits on the fence of the oldest frame in flight.
+/// \param esContext Application context
+/// \param maxFrames Frames in flight, 1 to ES_MAX_FRAMES_IN_FLIGHT, 0 for no limit
+//
+void ESUTIL_API esSetMaxFramesInFlight ( ESContext *esContext, GLint maxFrames );
+
+//
+/// \brief Limit the frame rate of the main loop by sleeping after each swap
+/// \param esContext Application context
+/// \param fps Target frames per second, 0 for no limit
+//
+void ESUTIL_API esSetTargetFps ( ESContext *esContext, GLfloat fps );
+
+//
+/// \brief Call the update callback at a fixed rate instead of once per drawn frame.  The draw
+///        callback reads esGetInterpolationAlpha() to blend between the last two simulation states.
+/// \param esContext Application context
+/// \param timestep Update interval in seconds, 0 restores one variable update per frame
+//
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, GLfloat timestep );
+
+//
+/// \brief Return how far the current frame lies between the last two fixed updates.  On the render
+///        thread this is the value the draw packet was submitted with, so the main thread may
+///        already be updating the next frame.
+/// \param esContext Application context
+/// \return A value in [0, 1), or 1 when no fixed timestep is set
+//
+GLfloat ESUTIL_API esGetInterpolationAlpha ( ESContext *esContext );
+
+//
+/// \brief Advance the simulation by the time elapsed since the previous frame.  Calls the update
+///        callback once, or as many fixed timesteps as have elapsed.  Called by the main loop.
+/// \param esContext Application context
+/// \param elapsed Seconds since the previous call
+//
+void ESUTIL_API esFramePacingUpdate ( ESContext *esContext, double elapsed );
+
+//
+/// \brief Enforce the frames-in-flight and frame rate limits.  Called by the main loop after each swap.
+/// \param esContext Application context
+//
+void ESUTIL_API esFramePacingFrame ( ESContext *esContext );
+
+//
+/// \brief Add a sample to a histogram
+/// \param histogram Histogram to update
+/// \param seconds Sample duration in seconds
+//
+void ESUTIL_API esHistogramAdd ( ESHistogram *histogram, double seconds );
+
+//
+/// \brief Estimate a percentile of a histogram from its buckets
+/// \param histogram Histogram to query
+/// \param percent Percentile in the range [0, 100]
+/// \return The upper bound of the bucket holding the percentile, in seconds
+//
+double ESUTIL_API esHistogramPercentile ( const ESHistogram *histogram, double percent );
+
+//
+/// \brief Return the CPU time histogram of a main loop phase
+/// \param esContext Application context
+/// \param phase One of ES_PHASE_UPDATE, ES_PHASE_DRAW, ES_PHASE_SWAP or ES_PHASE_FRAME
+/// \return The histogram, NULL if phase is out of range
+//
+const ESHistogram *ESUTIL_API esGetPhaseHistogram ( ESContext *esContext, int phase );
+
+//
+/// \brief Configure phase histogram output from --phase-histograms FILE (ES_PHASE_HISTOGRAMS)
+/// \param esContext Application context
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esProfileInit ( ESContext *esContext, int argc, char *argv[] );
+
+//
+/// \brief Write the phase histograms to a file, as CSV if the name ends in .csv and JSON otherwise
+/// \param esContext Application context
+/// \param fileName Name of the file to write
+/// \return GL_TRUE on success, GL_FALSE if the file could not be written
+//
+GLboolean ESUTIL_API esDumpPhaseHistograms ( ESContext *esContext, const char *fileName );
+
+//
+/// \brief Configure tracing from --trace FILE (ES_TRACE), the chrome://tracing JSON file written at
+///        shutdown, and --trace-hitch-ms T (ES_TRACE_HITCH_MS), which also dumps the trace whenever a
+///        frame takes longer than T milliseconds
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esTraceInit ( int argc, char *argv[] );
+
+//
+/// \brief Open a trace scope on the calling thread.  Scopes nest and are closed by esTraceEnd().
+///        Events before the first frame are kept for the whole run; later events go to a per-thread
+///        ring buffer that holds the most recent 16384 events, however many frames those span.
+///        Does nothing, and allocates nothing, unless --trace was given.
+/// \param name Scope name.  Only the pointer is stored, so it must stay valid, e.g. a string literal.
+//
+void ESUTIL_API esTraceBegin ( const char *name );
+
+//
+/// \brief Close the innermost trace scope of the calling thread
+//
+void ESUTIL_API esTraceEnd ( void );
+
+//
+/// \brief Mark the end of a frame for tracing
+/// \param frameSeconds Duration of the frame, compared against the hitch threshold
+//
+void ESUTIL_API esTraceFrame ( double frameSeconds );
+
+//
+/// \brief Write the recorded trace events as chrome://tracing / Perfetto JSON.  Events are only
+///        recorded when --trace was given.
+/// \param fileName Name of the file to write, NULL for the --trace file
+/// \return GL_TRUE on success, GL_FALSE if the file could not be written
+//
+GLboolean ESUTIL_API esTraceDump ( const char *fileName );
+
+//
+/// \brief Write the --trace file, if one was requested
+//
+void ESUTIL_API esTraceShutdown ( void );
+
+//
+/// \brief Start timing a GPU pass.  Passes do not nest; a Begin while a pass is open is ignored.
+///        Uses GL_EXT_disjoint_timer_query when available, CPU-observed fences otherwise.  Fence
+///        times are only estimates, bounded by how often the CPU polls the fences.
+/// \param name Pass name, must remain valid until esGpuTimerShutdown()
+//
+void ESUTIL_API esGpuTimerBegin ( const char *name );
+
+//
+/// \brief Stop timing the GPU pass opened by esGpuTimerBegin()
+//
+void ESUTIL_API esGpuTimerEnd ( void );
+
+//
+/// \brief Collect finished results without stalling and advance to the next frame.
+///        Called by the main loop after each swap.
+//
+void ESUTIL_API esGpuTimerFrame ( void );
+
+//
+/// \brief Return the collected GPU times of a pass, in seconds.  Without
+///        GL_EXT_disjoint_timer_query these are CPU-side estimates, see esGpuTimerBegin().
+/// \param name Pass name given to esGpuTimerBegin()
+/// \return The histogram of the pass, NULL if it has not completed yet
+//
+const ESHistogram *ESUTIL_API esGpuTimerHistogram ( const char *name );
+
+//
+/// \brief Print the GPU pass times and release the query objects.  The context must be current.
+//
+void ESUTIL_API esGpuTimerShutdown ( void );
+
 //
 ///
+/// \brief Configure frame capture from --capture FILE (ES_CAPTURE) and --capture-fps N (ES_CAPTURE_FPS).
+///        Every drawn frame is written to FILE, as 4:2:0 video if it ends in .y4m and as raw top-down
+///        RGBA otherwise.  N is the frame rate stored in the .y4m header, 60 by default.
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esCaptureInit ( int argc, char *argv[] );
+
+//
+/// \brief Read back the frame just drawn, before it is swapped.  Called by the main loop.
+///        Readbacks go through a ring of pixel pack buffers and are mapped two frames later.
+/// \param esContext Application context
+//
+void ESUTIL_API esCaptureFrame ( ESContext *esContext );
+
+//
+/// \brief Write the frames still in flight and close the capture file.  The context must be current.
+//
+void ESUTIL_API esCaptureShutdown ( void );
+
+//
 /// \brief Load a shader, check for compile errors, print error messages to output log
 /// \param type Type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
 /// \param shaderSrc Shader source string
@@ -208,6 +878,364 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc );
 //
 GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc );
 
+//
+///
+/// \brief Load a vertex and fragment shader and link them into a program whose vertex shader
+///        outputs are captured with transform feedback.  Errors output to log.
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \param varyingCount Number of transform feedback varyings, 0 for none
+/// \param varyings Names of the varyings to capture
+/// \param bufferMode GL_INTERLEAVED_ATTRIBS or GL_SEPARATE_ATTRIBS
+/// \return A new program object on success, 0 on failure
+//
+GLuint ESUTIL_API esLoadProgramWithVaryings ( const char *vertShaderSrc, const char *fragShaderSrc,
+                                              GLsizei varyingCount, const char *const *varyings, GLenum bufferMode );
+
+//
+///
+/// \brief Build several programs at once.  All compiles and links are issued before any status is
+///        queried, so drivers can overlap them; GL_KHR_parallel_shader_compile is enabled when
+///        available.  Uses the program cache when enabled.  Errors output to log.
+/// \param programs Programs to build.  programObject is set to the new program, or 0 on failure
+/// \param count Number of programs
+/// \return GL_TRUE if every program was built, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esLoadProgramsBatch ( ESProgramDesc *programs, GLsizei count );
+
+//
+/// \brief Hash a variable name for the ESProgram lookups.  Compute it once, not per frame.
+/// \param name Uniform, attribute or uniform block name
+/// \return The 32-bit FNV-1a hash of name in the low 32 bits, and an independent 32-bit hash in the
+///         high 32 bits that lookups check so a name colliding in the first hash is not found
+//
+GLuint64 ESUTIL_API esHashName ( const char *name );
+
+//
+/// \brief Enumerate the active uniforms, attributes and uniform blocks of a linked program
+/// \param program Returns the reflection tables; release them with esProgramFree() or esDeleteProgram()
+/// \param programObject Linked program object
+/// \return GL_TRUE on success, GL_FALSE if programObject is 0 or allocation fails
+//
+GLboolean ESUTIL_API esProgramReflect ( ESProgram *program, GLuint programObject );
+
+//
+/// \brief Load and link a program like esLoadProgram(), then reflect it with esProgramReflect()
+/// \param program Returns the program object and its reflection tables
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \return GL_TRUE on success, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esLoadProgramReflected ( ESProgram *program, const char *vertShaderSrc, const char *fragShaderSrc );
+
+//
+/// \brief Release the reflection tables of a program, keeping the program object
+/// \param program Program to release
+//
+void ESUTIL_API esProgramFree ( ESProgram *program );
+
+//
+/// \brief Delete the program object and release the reflection tables
+/// \param program Program to delete
+//
+void ESUTIL_API esDeleteProgram ( ESProgram *program );
+
+//
+/// \brief Look up a variable in one of the tables of an ESProgram
+/// \param table program->uniforms, program->attributes or program->uniformBlocks
+/// \param nameHash esHashName() of the variable name
+/// \return The variable, NULL if it is not active
+//
+const ESProgramVariable *ESUTIL_API esProgramFindVariable ( const ESProgramTable *table, GLuint64 nameHash );
+
+//
+/// \brief Return the location of an active uniform, -1 if it is not active
+//
+GLint ESUTIL_API esProgramUniformLocation ( const ESProgram *program, GLuint64 nameHash );
+
+//
+/// \brief Return the location of an active attribute, -1 if it is not active
+//
+GLint ESUTIL_API esProgramAttribLocation ( const ESProgram *program, GLuint64 nameHash );
+
+//
+/// \brief Return the index of an active uniform block, -1 if it is not active
+//
+GLint ESUTIL_API esProgramUniformBlockIndex ( const ESProgram *program, GLuint64 nameHash );
+
+//
+/// \brief Start a set of shader variants sharing base sources.  Variants are compiled on first use.
+/// \param variants Variant set to initialize
+/// \param base Vertex and fragment sources and transform feedback varyings, copied into the set
+//
+GLboolean ESUTIL_API esShaderVariantsInit ( ESShaderVariants *variants, const ESProgramDesc *base );
+
+//
+/// \brief Get the program for a combination of defines, compiling and caching it on first use
+/// \param variants Variant set
+/// \param defines Defines injected after the #version line.  The same defines in the same order
+///        return the same program.
+/// \param defineCount Number of defines
+/// \return The program object, 0 if the variant failed to build
+//
+GLuint ESUTIL_API esGetShaderVariant ( ESShaderVariants *variants, const ESShaderDefine *defines, GLsizei defineCount );
+
+//
+/// \brief Get several variants, compiling the ones not yet cached together with esLoadProgramsBatch()
+/// \param requests Variants to get.  programObject is set to the variant's program, or 0 on failure
+/// \param count Number of requests
+/// \return GL_TRUE if every variant built
+//
+GLboolean ESUTIL_API esGetShaderVariantsBatch ( ESShaderVariantRequest *requests, GLsizei count );
+
+//
+/// \brief Delete every compiled variant and free the set
+/// \param variants Variant set
+//
+void ESUTIL_API esShaderVariantsFree ( ESShaderVariants *variants );
+
+//
+/// \brief Bind the vertex array object for a vertex format and buffer set.  The VAO is built
+///        the first time the combination is used and cached, so later calls only bind it.
+/// \param attribs Vertex format, one entry per enabled attribute
+/// \param attribCount Number of attributes
+/// \param buffers Vertex buffers indexed by the buffer slot of the attributes
+/// \param indexBuffer Element array buffer, 0 for none
+/// \return The vertex array object
+//
+GLuint ESUTIL_API esBindVertexFormat ( const ESVertexAttrib *attribs, GLsizei attribCount,
+                                       const GLuint *buffers, GLuint indexBuffer );
+
+//
+/// \brief Delete the cached vertex arrays reading from a buffer.  Call before deleting the buffer.
+/// \param buffer Vertex or index buffer
+//
+void ESUTIL_API esVertexArrayCacheRemoveBuffer ( GLuint buffer );
+
+//
+/// \brief Delete every cached vertex array
+//
+void ESUTIL_API esVertexArrayCacheClear ( void );
+
+//
+/// \brief Register a program, vertex format and render target combination for esShaderWarmupRun()
+/// \param warmup Combination to warm up, copied
+//
+void ESUTIL_API esShaderWarmupRegister ( const ESShaderWarmup *warmup );
+
+//
+/// \brief Draw each registered combination once into a 1x1 offscreen target and wait for it,
+///        so deferred compiles and allocations happen at load time instead of on the first frame.
+///        Draws use the current GL state and log the time each combination took.  The
+///        registrations are cleared.
+/// \return Total warm-up time in seconds
+//
+double ESUTIL_API esShaderWarmupRun ( void );
+
+//
+/// \brief Create a uniform buffer sub-allocated as a ring of per-frame regions
+/// \param ring Ring to initialize
+/// \param frameSize Bytes available to each frame
+/// \param frameCount Number of regions, at most ES_MAX_FRAMES_IN_FLIGHT.  A region is reused
+///        once the GPU is done with the frame that last drew from it.
+/// \return GL_TRUE if the buffer was created
+//
+GLboolean ESUTIL_API esUniformRingInit ( ESUniformRing *ring, GLsizeiptr frameSize, GLuint frameCount );
+
+//
+/// \brief Move to the next region, waiting for the GPU to finish with it, and map it
+/// \param ring Uniform ring
+//
+void ESUTIL_API esUniformRingBegin ( ESUniformRing *ring );
+
+//
+/// \brief Allocate uniform data in the current region
+/// \param ring Uniform ring, between esUniformRingBegin() and esUniformRingEnd()
+/// \param size Size of the data
+/// \param offset Returns the buffer offset of the data, aligned for glBindBufferRange()
+/// \return Pointer to write the data to, NULL if the region is full
+//
+void *ESUTIL_API esUniformRingAlloc ( ESUniformRing *ring, GLsizeiptr size, GLintptr *offset );
+
+//
+/// \brief Flush and unmap the current region.  Call before drawing with the data.
+/// \param ring Uniform ring
+//
+void ESUTIL_API esUniformRingEnd ( ESUniformRing *ring );
+
+//
+/// \brief Bind data allocated from the ring to a uniform buffer binding point
+/// \param ring Uniform ring
+/// \param bindingPoint Binding point set with glUniformBlockBinding()
+/// \param offset Offset returned by esUniformRingAlloc()
+/// \param size Size of the data
+//
+void ESUTIL_API esUniformRingBind ( const ESUniformRing *ring, GLuint bindingPoint, GLintptr offset, GLsizeiptr size );
+
+//
+/// \brief Delete the ring's buffer and fences
+/// \param ring Uniform ring
+//
+void ESUTIL_API esUniformRingFree ( ESUniformRing *ring );
+
+//
+/// \brief Write a member of a std140 uniform block at its aligned offset.  Arrays have a
+///        stride of 16 bytes per element, matrices are stored as vec4 columns.
+/// \param block Block being written, started with data and offset 0
+/// \param value Member value, NULL for the vector and matrix types to only compute the layout
+/// \return Offset of the member in the block
+//
+GLsizeiptr ESUTIL_API esStd140Float ( ESStd140 *block, GLfloat value );
+GLsizeiptr ESUTIL_API esStd140Int ( ESStd140 *block, GLint value );
+GLsizeiptr ESUTIL_API esStd140Vec2 ( ESStd140 *block, const GLfloat *value );
+GLsizeiptr ESUTIL_API esStd140Vec3 ( ESStd140 *block, const GLfloat *value );
+GLsizeiptr ESUTIL_API esStd140Vec4 ( ESStd140 *block, const GLfloat *value );
+GLsizeiptr ESUTIL_API esStd140FloatArray ( ESStd140 *block, const GLfloat *values, GLsizei count );
+GLsizeiptr ESUTIL_API esStd140Vec4Array ( ESStd140 *block, const GLfloat *values, GLsizei count );
+GLsizeiptr ESUTIL_API esStd140Mat3 ( ESStd140 *block, const GLfloat *value );
+GLsizeiptr ESUTIL_API esStd140Mat4 ( ESStd140 *block, const ESMatrix *value );
+
+//
+/// \brief Pad a std140 block to a multiple of 16 bytes, the alignment of a nested structure
+/// \param block Block being written
+/// \return The padded block size
+//
+GLsizeiptr ESUTIL_API esStd140End ( ESStd140 *block );
+
+//
+/// \brief State tracked GL calls.  They skip the GL call when the state already has the
+///        requested value and never query the driver.  Calls made directly to GL leave the
+///        tracked state stale; call esStateInvalidate() after them.  Objects deleted while
+///        tracked must be reported with the esStateDelete* hooks.
+//
+void ESUTIL_API esBindBuffer ( GLenum target, GLuint buffer );
+void ESUTIL_API esBindVertexArray ( GLuint array );
+void ESUTIL_API esUseProgram ( GLuint program );
+void ESUTIL_API esActiveTexture ( GLenum texture );
+void ESUTIL_API esBindTexture ( GLenum target, GLuint texture );
+void ESUTIL_API esBindFramebuffer ( GLenum target, GLuint framebuffer );
+void ESUTIL_API esEnable ( GLenum cap );
+void ESUTIL_API esDisable ( GLenum cap );
+void ESUTIL_API esViewport ( GLint x, GLint y, GLsizei width, GLsizei height );
+void ESUTIL_API esColorMask ( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha );
+void ESUTIL_API esDepthMask ( GLboolean flag );
+
+//
+/// \brief Return the bound draw framebuffer, querying GL only the first time
+//
+GLuint ESUTIL_API esGetFramebufferBinding ( void );
+
+//
+/// \brief Forget the tracked state, so the next call of each kind goes to GL.  Needed after
+///        changing tracked state with direct GL calls, or when another context or library
+///        may have changed it.
+//
+void ESUTIL_API esStateInvalidate ( void );
+
+//
+/// \brief Forget the tracked bindings of deleted objects, whose names GL may hand out again.
+///        Call with the names passed to the matching glDelete* call.  esMemDeleteBuffers(),
+///        esMemDeleteTextures(), esShaderVariantsFree() and the vertex array cache call them.
+//
+void ESUTIL_API esStateDeleteBuffers ( GLsizei n, const GLuint *buffers );
+void ESUTIL_API esStateDeleteTextures ( GLsizei n, const GLuint *textures );
+void ESUTIL_API esStateDeleteProgram ( GLuint program );
+void ESUTIL_API esStateDeleteFramebuffers ( GLsizei n, const GLuint *framebuffers );
+void ESUTIL_API esStateDeleteVertexArrays ( GLsizei n, const GLuint *arrays );
+
+//
+/// \brief Close the state counters of a frame.  Called by the main loop after each swap.
+//
+void ESUTIL_API esStateFrame ( void );
+
+//
+/// \brief Return the state tracker counters
+/// \param lastFrame Returns the counters of the last frame, can be NULL
+/// \param total Returns the counters summed over every frame, can be NULL
+//
+void ESUTIL_API esGetStateCounters ( ESStateCounters *lastFrame, ESStateCounters *total );
+
+//
+/// \brief Return the GL call counters.  They are only collected when built with
+///        ES_GL_ACCOUNTING defined, and are zero otherwise.
+/// \param lastFrame Returns the counters of the last frame, can be NULL
+/// \param total Returns the counters summed over every frame, can be NULL
+//
+void ESUTIL_API esGetGLCounters ( ESGLCounters *lastFrame, ESGLCounters *total );
+
+//
+/// \brief Close the GL call counters of a frame.  Called by the main loop after each swap.
+//
+void ESUTIL_API esGLCountersFrame ( void );
+
+//
+/// \brief Allocation wrappers recording the estimated GPU memory of the object bound to target
+///        under a label.  They take the arguments of the GL call they wrap after the label.
+///        Sizes are estimated from the format, dimensions and mip levels; RGB formats are
+///        assumed to be padded to 4 bytes per texel.  The label is kept by pointer, not copied.
+//
+void ESUTIL_API esMemBufferData ( const char *label, GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+void ESUTIL_API esMemTexImage2D ( const char *label, GLenum target, GLint level, GLint internalformat,
+                                  GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type,
+                                  const void *pixels );
+void ESUTIL_API esMemTexImage3D ( const char *label, GLenum target, GLint level, GLint internalformat,
+                                  GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format,
+                                  GLenum type, const void *pixels );
+void ESUTIL_API esMemTexStorage2D ( const char *label, GLenum target, GLsizei levels, GLenum internalformat,
+                                    GLsizei width, GLsizei height );
+void ESUTIL_API esMemTexStorage3D ( const char *label, GLenum target, GLsizei levels, GLenum internalformat,
+                                    GLsizei width, GLsizei height, GLsizei depth );
+void ESUTIL_API esMemRenderbufferStorage ( const char *label, GLenum target, GLenum internalformat,
+                                           GLsizei width, GLsizei height );
+void ESUTIL_API esMemRenderbufferStorageMultisample ( const char *label, GLenum target, GLsizei samples,
+                                                      GLenum internalformat, GLsizei width, GLsizei height );
+
+//
+/// \brief Record the mip levels glGenerateMipmap() allocates from the base level, and generate them
+/// \param target Texture target, the bound texture's base level must have been recorded
+//
+void ESUTIL_API esMemGenerateMipmap ( GLenum target );
+
+//
+/// \brief Delete objects and release the memory recorded for them
+//
+void ESUTIL_API esMemDeleteBuffers ( GLsizei n, const GLuint *buffers );
+void ESUTIL_API esMemDeleteTextures ( GLsizei n, const GLuint *textures );
+void ESUTIL_API esMemDeleteRenderbuffers ( GLsizei n, const GLuint *renderbuffers );
+
+//
+/// \brief Return the recorded GPU memory of a category
+/// \param category ES_MEMORY_BUFFER, ES_MEMORY_TEXTURE, ES_MEMORY_RENDERBUFFER or ES_MEMORY_CATEGORIES for all
+/// \param current Returns the bytes allocated now, can be NULL
+/// \param peak Returns the most bytes allocated at once, can be NULL
+//
+void ESUTIL_API esGetGpuMemory ( int category, GLuint64 *current, GLuint64 *peak );
+
+//
+/// \brief Log current and peak GPU memory per category and per label
+//
+void ESUTIL_API esGpuMemoryReport ( void );
+
+//
+/// \brief Return the size of a pixel of client data, ignoring row alignment
+/// \param format, type Pixel format and type as passed to glTexImage2D()
+//
+GLuint ESUTIL_API esPixelSize ( GLenum format, GLenum type );
+
+//
+/// \brief Enable the program binary cache from --program-cache DIR (ES_PROGRAM_CACHE)
+/// \param argc, argv Command line arguments passed to main
+//
+void ESUTIL_API esProgramCacheInit ( int argc, char *argv[] );
+
+//
+/// \brief Cache linked programs as binaries in a directory.  esLoadProgram() and
+///        esLoadProgramWithVaryings() then load a program from its binary when the sources and the
+///        GL_RENDERER and GL_VERSION strings match, and compile from source if the driver rejects it.
+/// \param dir Cache directory, created on first write.  NULL disables the cache.  The string is not copied.
+//
+void ESUTIL_API esSetProgramCacheDir ( const char *dir );
+
 
 //
 /// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores
@@ -281,6 +1309,15 @@ void ESUTIL_API esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat
 //
 void ESUTIL_API esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
 
+//
+/// \brief Multiply matrix specified by result with a rotation matrix built from a precomputed sine
+///        and cosine, so callers rotating by the same angle often can compute them once
+/// \param result Specifies the input matrix.  Rotated matrix is returned in result.
+/// \param sinAngle, cosAngle Sine and cosine of the angle of rotation
+/// \param x, y, z Specify the x, y and z coordinates of a vector, respectively
+//
+void ESUTIL_API esRotateSinCos ( ESMatrix *result, GLfloat sinAngle, GLfloat cosAngle, GLfloat x, GLfloat y, GLfloat z );
+
 //
 /// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
 /// \param result Specifies the input matrix.  New matrix is returned in result.
@@ -316,6 +1353,17 @@ void ESUTIL_API esOrtho ( ESMatrix *result, float left, float right, float botto
 //
 void ESUTIL_API esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB );
 
+//
+/// \brief Multiply an array of matrices by one matrix - result[i] = srcA[i] * srcB.  Typically
+///        model matrices by a view-projection matrix, written straight into a mapped buffer.
+/// \param result Returns count multiplied matrices.  May be srcA itself but must not partially
+///               overlap it.  Only written to, so a write-only mapping is fine.
+/// \param srcA Array of count matrices
+/// \param srcB Matrix every element of srcA is multiplied by
+/// \param count Number of matrices
+//
+void ESUTIL_API esMatrixMultiplyBatch ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, GLsizei count );
+
 //
 //// \brief Return an identity matrix
 //// \param result Returns identity matrix
@@ -335,6 +1383,194 @@ esMatrixLookAt ( ESMatrix *result,
                  float lookAtX, float lookAtY, float lookAtZ,
                  float upX,     float upY,     float upZ );
 
+//
+//// \brief Return an identity affine transform
+//// \param result Returns identity transform
+//
+void ESUTIL_API esAffineLoadIdentity ( ESAffine *result );
+
+//
+/// \brief Affine counterparts of esScale(), esTranslate(), esRotate() and esRotateSinCos().
+///        They compose the same way but skip the known-zero last column.
+//
+void ESUTIL_API esAffineScale ( ESAffine *result, GLfloat sx, GLfloat sy, GLfloat sz );
+void ESUTIL_API esAffineTranslate ( ESAffine *result, GLfloat tx, GLfloat ty, GLfloat tz );
+void ESUTIL_API esAffineRotate ( ESAffine *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+void ESUTIL_API esAffineRotateSinCos ( ESAffine *result, GLfloat sinAngle, GLfloat cosAngle,
+                                       GLfloat x, GLfloat y, GLfloat z );
+
+//
+/// \brief Compose two affine transforms - result = srcA * srcB, 36 multiplies instead of 64
+/// \param result Returns the composed transform, may be either input
+/// \param srcA, srcB Input transforms
+//
+void ESUTIL_API esAffineMultiply ( ESAffine *result, const ESAffine *srcA, const ESAffine *srcB );
+
+//
+/// \brief Invert an affine transform
+/// \param result Returns the inverse, may be src
+/// \param src Transform to invert
+/// \return GL_FALSE, leaving result unchanged, if src is singular
+//
+GLboolean ESUTIL_API esAffineInverse ( ESAffine *result, const ESAffine *src );
+
+//
+/// \brief Expand an affine transform to a 4x4 matrix
+/// \param result Returns the matrix
+/// \param src Affine transform
+//
+void ESUTIL_API esAffineToMatrix ( ESMatrix *result, const ESAffine *src );
+
+//
+/// \brief result matrix = srcA affine transform * srcB matrix, 48 multiplies instead of 64.
+///        Typically a model transform times a view or view-projection matrix.
+/// \param result Returns multiplied matrix, may be srcB
+/// \param srcA Affine transform
+/// \param srcB Matrix
+//
+void ESUTIL_API esMatrixMultiplyAffine ( ESMatrix *result, const ESAffine *srcA, const ESMatrix *srcB );
+
+//
+/// \brief Invert a matrix
+/// \param result Returns the inverse, may be src
+/// \param src Matrix to invert
+/// \return GL_FALSE, leaving result unchanged, if src is singular
+//
+GLboolean ESUTIL_API esMatrixInverse ( ESMatrix *result, const ESMatrix *src );
+
+//
+/// \brief Invert a matrix whose last column is ( 0, 0, 0, 1 ), such as a model or view matrix.
+///        Cheaper than esMatrixInverse(); the last column of src is not read.
+/// \param result Returns the inverse, may be src
+/// \param src Matrix to invert
+/// \return GL_FALSE, leaving result unchanged, if src is singular
+//
+GLboolean ESUTIL_API esMatrixInverseAffine ( ESMatrix *result, const ESMatrix *src );
+
+//
+/// \brief Normal matrix of a model or modelview matrix - the inverse transpose of its upper 3x3,
+///        laid out for glUniformMatrix3fv() with transpose GL_FALSE
+/// \param result Returns the normal matrix
+/// \param src Model or modelview matrix
+/// \return GL_FALSE, leaving result unchanged, if the upper 3x3 of src is singular
+//
+GLboolean ESUTIL_API esMatrixNormal3x3 ( GLfloat result[3][3], const ESMatrix *src );
+
+//
+/// \brief Extract the clip planes of a view-projection or model-view-projection matrix.  A point p
+///        is inside plane i when planes[i][0] * p.x + planes[i][1] * p.y + planes[i][2] * p.z +
+///        planes[i][3] >= 0.  Planes are normalized, so that sum is a distance.
+/// \param planes Returns the planes, indexed by ES_PLANE_LEFT to ES_PLANE_FAR
+/// \param src Matrix, in the space of the points to test - world space for a view-projection
+//
+void ESUTIL_API esFrustumPlanesFromMatrix ( GLfloat planes[ES_PLANE_COUNT][4], const ESMatrix *src );
+
+//
+/// \brief Frustum cull an array of bounding spheres, four at a time with SSE2 or NEON
+/// \param planes Frustum planes from esFrustumPlanesFromMatrix(), in the space of the spheres
+/// \param spheres Bounding spheres
+/// \param count Number of spheres
+/// \param visible Returns the indices of the spheres inside or crossing the frustum, in order.
+///                Must have room for count indices.
+/// \return Number of visible spheres
+//
+GLsizei ESUTIL_API esCullSpheres ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingSphere *spheres,
+                                   GLsizei count, GLuint *visible );
+
+//
+/// \brief Frustum cull an array of axis-aligned bounding boxes, four at a time with SSE2 or NEON
+/// \param planes Frustum planes from esFrustumPlanesFromMatrix(), in the space of the boxes
+/// \param boxes Bounding boxes
+/// \param count Number of boxes
+/// \param visible Returns the indices of the boxes inside or crossing the frustum, in order.
+///                Must have room for count indices.
+/// \return Number of visible boxes
+//
+GLsizei ESUTIL_API esCullBoxes ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingBox *boxes,
+                                 GLsizei count, GLuint *visible );
+
+//
+/// \brief Copy the per-object data of the visible objects next to each other, for example
+///        straight into a mapped instance buffer
+/// \param result Returns visibleCount elements, only written to.  May be src to compact in place.
+/// \param src Per-object data, one element per tested object
+/// \param elementSize Size of an element in bytes
+/// \param visible, visibleCount Result of esCullSpheres() or esCullBoxes()
+//
+void ESUTIL_API esCullGather ( void *result, const void *src, GLsizei elementSize,
+                               const GLuint *visible, GLsizei visibleCount );
+
+//
+/// \brief Bounding box of tightly packed x, y, z positions
+/// \param result Returns the box, empty at the origin for no vertices
+/// \param positions Vertex positions
+/// \param vertexCount Number of vertices
+//
+void ESUTIL_API esBoundingBoxFromPositions ( ESBoundingBox *result, const GLfloat *positions, GLsizei vertexCount );
+
+//
+/// \brief Axis-aligned box enclosing a transformed box, for example model to world space
+/// \param result Returns the box, may be box
+/// \param box Box to transform
+/// \param transform Affine transform
+//
+void ESUTIL_API esBoundingBoxTransform ( ESBoundingBox *result, const ESBoundingBox *box, const ESAffine *transform );
+
+///
+//  GL call accounting.  Building with ES_GL_ACCOUNTING defined routes the GL
+//  calls below through counting wrappers; otherwise they are called directly.
+//
+#if defined ( ES_GL_ACCOUNTING ) && !defined ( ES_GL_ACCOUNTING_IMPL )
+
+void ESUTIL_API esCountDrawArrays ( GLenum mode, GLint first, GLsizei count );
+void ESUTIL_API esCountDrawElements ( GLenum mode, GLsizei count, GLenum type, const void *indices );
+void ESUTIL_API esCountDrawRangeElements ( GLenum mode, GLuint start, GLuint end, GLsizei count,
+                                           GLenum type, const void *indices );
+void ESUTIL_API esCountDrawArraysInstanced ( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount );
+void ESUTIL_API esCountDrawElementsInstanced ( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                               GLsizei instanceCount );
+void ESUTIL_API esCountUseProgram ( GLuint program );
+void ESUTIL_API esCountBindTexture ( GLenum target, GLuint texture );
+void ESUTIL_API esCountBufferData ( GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+void ESUTIL_API esCountBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const void *data );
+void *ESUTIL_API esCountMapBufferRange ( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+void ESUTIL_API esCountTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                    GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels );
+void ESUTIL_API esCountTexImage3D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                    GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type,
+                                    const void *pixels );
+void ESUTIL_API esCountTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                       GLsizei height, GLenum format, GLenum type, const void *pixels );
+void ESUTIL_API esCountTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                       GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                       const void *pixels );
+void ESUTIL_API esCountCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat, GLsizei width,
+                                              GLsizei height, GLint border, GLsizei imageSize, const void *data );
+GLenum ESUTIL_API esCountClientWaitSync ( GLsync sync, GLbitfield flags, GLuint64 timeout );
+void ESUTIL_API esCountWaitSync ( GLsync sync, GLbitfield flags, GLuint64 timeout );
+void ESUTIL_API esCountFinish ( void );
+
+#define glDrawArrays                esCountDrawArrays
+#define glDrawElements              esCountDrawElements
+#define glDrawRangeElements         esCountDrawRangeElements
+#define glDrawArraysInstanced       esCountDrawArraysInstanced
+#define glDrawElementsInstanced     esCountDrawElementsInstanced
+#define glUseProgram                esCountUseProgram
+#define glBindTexture               esCountBindTexture
+#define glBufferData                esCountBufferData
+#define glBufferSubData             esCountBufferSubData
+#define glMapBufferRange            esCountMapBufferRange
+#define glTexImage2D                esCountTexImage2D
+#define glTexImage3D                esCountTexImage3D
+#define glTexSubImage2D             esCountTexSubImage2D
+#define glTexSubImage3D             esCountTexSubImage3D
+#define glCompressedTexImage2D      esCountCompressedTexImage2D
+#define glClientWaitSync            esCountClientWaitSync
+#define glWaitSync                  esCountWaitSync
+#define glFinish                    esCountFinish
+
+#endif // ES_GL_ACCOUNTING
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,14 @@ extern "C" {
 //
 GLboolean WinCreate ( ESContext *esContext, const char *title );
 
+///
+//  WinWake()
+//
+//      Wake the main loop from an ES_WINDOW_ON_DEMAND sleep.  May be called
+//      from any thread.
+//
+void WinWake ( ESContext *esContext );
+
 #ifdef __cplusplus
 }
 #endif
@@ -206,3 +206,12 @@ GLboolean WinCreate ( ESContext *esContext, const char *title )
    // android_main()
    return GL_TRUE;
 }
+
+///
+//  WinWake()
+//
+//      android_main() never sleeps waiting for a redraw
+//
+void WinWake ( ESContext *esContext )
+{
+}
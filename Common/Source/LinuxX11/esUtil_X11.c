@@ -20,7 +20,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-#include <sys/time.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "esUtil.h"
 
 #include  <X11/Xlib.h>
@@ -31,12 +34,75 @@
 static Display *x_display = NULL;
 static Atom s_wmDeleteMessage;
 
+// Set from a signal handler to stop an offscreen run, which has no window to close
+static volatile sig_atomic_t s_signalInterrupt = 0;
+
+// Self-pipe WinWake() writes to, polled next to the X connection by waitForEvents()
+static int s_wakePipe[2] = { -1, -1 };
+
 //////////////////////////////////////////////////////////////////
 //
 //  Private Functions
 //
 //
 
+///
+//  signalInterrupt()
+//
+//      SIGINT/SIGTERM handler, lets WinLoop exit and the shutdown callback run
+//
+static void signalInterrupt ( int signum )
+{
+    (void)signum;
+    s_signalInterrupt = 1;
+}
+
+///
+//  waitForEvents()
+//
+//      Sleep until the X connection has events to read, WinWake() is called
+//      or timeout seconds pass (0 waits indefinitely).  Returns GL_FALSE if
+//      the timeout expired.
+//
+static GLboolean waitForEvents ( ESContext *esContext, float timeout )
+{
+    struct pollfd pfd[2];
+    int timeoutMs = timeout > 0.0f ? (int)(timeout * 1000.0f + 0.5f) : -1;
+    int count = 0;
+    int ready;
+    char drain[16];
+
+    // Offscreen runs have no connection and only wake up for the timeout, a signal or WinWake()
+    if ( !( esContext->flags & ES_WINDOW_OFFSCREEN ) )
+    {
+        // XPending flushes requests and reports events Xlib has already read off the socket
+        if ( XPending ( x_display ) )
+            return GL_TRUE;
+
+        pfd[count].fd = ConnectionNumber ( x_display );
+        pfd[count].events = POLLIN;
+        pfd[count].revents = 0;
+        count++;
+    }
+
+    if ( s_wakePipe[0] >= 0 )
+    {
+        pfd[count].fd = s_wakePipe[0];
+        pfd[count].events = POLLIN;
+        pfd[count].revents = 0;
+        count++;
+    }
+
+    ready = poll ( count > 0 ? pfd : NULL, count, timeoutMs );
+
+    // Empty the pipe so the next wait sleeps again
+    if ( s_wakePipe[0] >= 0 )
+        while ( read ( s_wakePipe[0], drain, sizeof(drain) ) > 0 )
+            ;
+
+    return ready != 0 ? GL_TRUE : GL_FALSE;
+}
+
 
 //////////////////////////////////////////////////////////////////
 //
@@ -65,6 +131,9 @@ EGLBoolean WinCreate(ESContext *esContext, const char *title)
      * X11 native display initialization
      */
 
+    // The render thread swaps while the main thread reads events
+    XInitThreads();
+
     x_display = XOpenDisplay(NULL);
     if ( x_display == NULL )
     {
@@ -116,6 +185,24 @@ EGLBoolean WinCreate(ESContext *esContext, const char *title)
     return EGL_TRUE;
 }
 
+///
+//  WinWake()
+//
+//      Wake the main loop from waitForEvents(), called from the render thread
+//
+void WinWake ( ESContext *esContext )
+{
+    char wake = 0;
+    ssize_t written = 0;
+
+    (void)esContext;
+
+    // A full pipe already holds a wake up, so a failed write is harmless
+    if ( s_wakePipe[1] >= 0 )
+        written = write ( s_wakePipe[1], &wake, 1 );
+    (void)written;
+}
+
 ///
 //  userInterrupt()
 //
@@ -129,6 +216,10 @@ GLboolean userInterrupt(ESContext *esContext)
     GLboolean userinterrupt = GL_FALSE;
     char text;
 
+    // There is no X connection to pump when rendering offscreen
+    if ( esContext->flags & ES_WINDOW_OFFSCREEN )
+        return s_signalInterrupt ? GL_TRUE : GL_FALSE;
+
     // Pump all messages from X server. Keypresses are directed to keyfunc (if defined)
     while ( XPending ( x_display ) )
     {
@@ -140,7 +231,10 @@ GLboolean userInterrupt(ESContext *esContext)
                 if (esContext->keyFunc != NULL)
                     esContext->keyFunc(esContext, text, 0, 0);
             }
+            esContext->redrawPending = GL_TRUE;
         }
+        if ( xev.type == Expose && xev.xexpose.count == 0 )
+            esContext->redrawPending = GL_TRUE;
         if (xev.type == ClientMessage) {
             if (xev.xclient.data.l[0] == s_wmDeleteMessage) {
                 userinterrupt = GL_TRUE;
@@ -159,24 +253,124 @@ GLboolean userInterrupt(ESContext *esContext)
 //
 void WinLoop ( ESContext *esContext )
 {
-    struct timeval t1, t2;
-    struct timezone tz;
-    float deltatime;
+    double lastTime, now, deltatime;
+    double frameStart, phaseStart, phaseEnd;
+    GLboolean onDemand = ( esContext->flags & ES_WINDOW_ON_DEMAND ) && esContext->benchmark.frames == 0;
+
+    if ( esContext->flags & ES_WINDOW_OFFSCREEN )
+    {
+        signal ( SIGINT, signalInterrupt );
+        signal ( SIGTERM, signalInterrupt );
+    }
+
+    // Lets a redraw requested on the render thread interrupt the sleep
+    if ( onDemand && pipe ( s_wakePipe ) == 0 )
+    {
+        fcntl ( s_wakePipe[0], F_SETFL, O_NONBLOCK );
+        fcntl ( s_wakePipe[1], F_SETFL, O_NONBLOCK );
+    }
 
-    gettimeofday ( &t1 , &tz );
+    lastTime = frameStart = esContext->benchmark.lastTime = esGetTime();
+    esContext->redrawPending = GL_TRUE;
+
+    esRenderThreadStart(esContext);
 
     while(userInterrupt(esContext) == GL_FALSE)
     {
-        gettimeofday(&t2, &tz);
-        deltatime = (float)(t2.tv_sec - t1.tv_sec + (t2.tv_usec - t1.tv_usec) * 1e-6);
-        t1 = t2;
+        if (esRenderThreadTakeRedraw(esContext))
+            esContext->redrawPending = GL_TRUE;
 
-        if (esContext->updateFunc != NULL)
-            esContext->updateFunc(esContext, deltatime);
-        if (esContext->drawFunc != NULL)
-            esContext->drawFunc(esContext);
+        if (onDemand && !esContext->redrawPending)
+        {
+            // Sleep until an event arrives; on timeout fall through to tick the update callback
+            GLboolean woken = waitForEvents(esContext, esContext->idleTimeout);
+            frameStart = esGetTime();
+            if (woken)
+            {
+                // The sleep is not simulated, the next update only advances by the time since waking.
+                // A timeout tick still advances by the idle timeout.
+                lastTime = frameStart;
+                continue;
+            }
+        }
+
+        now = esGetTime();
+        deltatime = now - lastTime;
+        lastTime = now;
+
+        // Benchmark mode feeds a synthetic timestep so every run does the same work
+        if (esContext->benchmark.frames > 0)
+            deltatime = esContext->benchmark.fixedDeltaTime;
+
+        esTraceBegin("Frame");
 
-        eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);        
+        esRenderThreadBeginUpdate(esContext);
+
+        phaseStart = esGetTime();
+        esTraceBegin("Update");
+        esFramePacingUpdate(esContext, deltatime);
+        esTraceEnd();
+        phaseEnd = esGetTime();
+        esHistogramAdd(&esContext->phaseHistograms[ES_PHASE_UPDATE], phaseEnd - phaseStart);
+
+        if (onDemand && !esContext->redrawPending)
+        {
+            // Idle tick that did not request a redraw
+            esTraceEnd();
+            continue;
+        }
+        esContext->redrawPending = GL_FALSE;
+
+        if (esContext->renderThread != NULL)
+        {
+            // Draw, swap and frame pacing happen on the render thread
+            esRenderThreadSubmit(esContext);
+        }
+        else
+        {
+            phaseStart = phaseEnd;
+            esTraceBegin("Draw");
+            if (esContext->drawFunc != NULL)
+                esContext->drawFunc(esContext);
+            esTraceEnd();
+            phaseEnd = esGetTime();
+            esHistogramAdd(&esContext->phaseHistograms[ES_PHASE_DRAW], phaseEnd - phaseStart);
+
+            // The readback is traced on its own and kept out of the draw and swap phases
+            esCaptureFrame(esContext);
+
+            phaseStart = esGetTime();
+            esTraceBegin("eglSwapBuffers");
+            eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);        
+            esTraceEnd();
+            phaseEnd = esGetTime();
+            esHistogramAdd(&esContext->phaseHistograms[ES_PHASE_SWAP], phaseEnd - phaseStart);
+
+            // Per frame bookkeeping, kept out of the swap phase
+            esGpuTimerFrame();
+            esStateFrame();
+            esGLCountersFrame();
+            esFramePacingFrame(esContext);
+        }
+        phaseEnd = esGetTime();
+
+        esTraceEnd();
+
+        esHistogramAdd(&esContext->phaseHistograms[ES_PHASE_FRAME], phaseEnd - frameStart);
+        esTraceFrame(phaseEnd - frameStart);
+        frameStart = phaseEnd;
+
+        if (esBenchmarkFrame(esContext) == GL_TRUE)
+            break;
+    }
+
+    esRenderThreadStop(esContext);
+
+    if ( s_wakePipe[0] >= 0 )
+    {
+        close ( s_wakePipe[0] );
+        close ( s_wakePipe[1] );
+        s_wakePipe[0] = s_wakePipe[1] = -1;
     }
 }
 
@@ -197,17 +391,40 @@ int main ( int argc, char *argv[] )
    
    memset ( &esContext, 0, sizeof( esContext ) );
 
+   esBenchmarkInit ( &esContext, argc, argv );
+   esProfileInit ( &esContext, argc, argv );
+   esFramePacingInit ( &esContext, argc, argv );
+   esTraceInit ( argc, argv );
+   esCaptureInit ( argc, argv );
+   esProgramCacheInit ( argc, argv );
 
+   esTraceBegin ( "esMain" );
    if ( esMain ( &esContext ) != GL_TRUE )
       return 1;   
+   esTraceEnd ( );
  
    WinLoop ( &esContext );
 
+   esBenchmarkReport ( &esContext );
+   esGpuTimerShutdown ( );
+   esCaptureShutdown ( );
+
+   if ( esContext.phaseHistogramFile != NULL )
+      esDumpPhaseHistograms ( &esContext, esContext.phaseHistogramFile );
+
    if ( esContext.shutdownFunc != NULL )
-	   esContext.shutdownFunc ( &esContext );
+   {
+      esTraceBegin ( "Shutdown" );
+      esContext.shutdownFunc ( &esContext );
+      esTraceEnd ( );
+   }
+
+   esTraceShutdown ( );
 
    if ( esContext.userData != NULL )
 	   free ( esContext.userData );
 
+   free ( esContext.framePackets[0] );
+
    return 0;
 }
@@ -41,17 +41,59 @@
 #include <windows.h>
 #include <stdlib.h>
 #include "esUtil.h"
+#include "esUtil_win.h"
 
 #ifdef _WIN64
 #define GWL_USERDATA GWLP_USERDATA
 #endif
 
+// Thread running WinLoop(), WinWake() posts to its message queue
+static DWORD s_mainThreadId;
+
 //////////////////////////////////////////////////////////////////
 //
 //  Private Functions
 //
 //
 
+///
+//  DrawFrame()
+//
+//      Call the draw callback and swap, timing and tracing both phases
+//
+static void DrawFrame ( ESContext *esContext )
+{
+   double drawStart = esGetTime();
+   double drawEnd;
+   double swapStart;
+   double swapEnd;
+
+   esContext->redrawPending = GL_FALSE;
+
+   esTraceBegin ( "Draw" );
+   esContext->drawFunc ( esContext );
+   esTraceEnd ( );
+   drawEnd = esGetTime();
+
+   // The readback is traced on its own and kept out of the draw and swap phases
+   esCaptureFrame ( esContext );
+   swapStart = esGetTime();
+
+   esTraceBegin ( "eglSwapBuffers" );
+   eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+   esTraceEnd ( );
+   swapEnd = esGetTime();
+
+   esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_DRAW], drawEnd - drawStart );
+   esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_SWAP], swapEnd - swapStart );
+
+   // Per frame bookkeeping, kept out of the swap phase
+   esGpuTimerFrame ( );
+   esStateFrame ( );
+   esGLCountersFrame ( );
+   esFramePacingFrame ( esContext );
+}
+
 ///
 //  ESWindowProc()
 //
@@ -70,10 +112,14 @@ LRESULT WINAPI ESWindowProc ( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
       {
          ESContext *esContext = ( ESContext * ) ( LONG_PTR ) GetWindowLongPtr ( hWnd, GWL_USERDATA );
 
-         if ( esContext && esContext->drawFunc )
+         if ( esContext && esContext->renderThread )
          {
-            esContext->drawFunc ( esContext );
-            eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+            // The context is current on the render thread
+            esRequestRedraw ( esContext );
+         }
+         else if ( esContext && esContext->drawFunc )
+         {
+            DrawFrame ( esContext );
          }
 
          if ( esContext )
@@ -97,6 +143,9 @@ LRESULT WINAPI ESWindowProc ( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
          if ( esContext && esContext->keyFunc )
             esContext->keyFunc ( esContext, ( unsigned char ) wParam,
                                  ( int ) point.x, ( int ) point.y );
+
+         if ( esContext )
+            esRequestRedraw ( esContext );
       }
       break;
 
@@ -184,6 +233,17 @@ GLboolean WinCreate ( ESContext *esContext, const char *title )
    return GL_TRUE;
 }
 
+///
+//  WinWake()
+//
+//      Wake WinLoop() from MsgWaitForMultipleObjects, called from the render thread
+//
+void WinWake ( ESContext *esContext )
+{
+   ( void ) esContext;
+   PostThreadMessage ( s_mainThreadId, WM_NULL, 0, 0 );
+}
+
 ///
 //  WinLoop()
 //
@@ -193,15 +253,34 @@ void WinLoop ( ESContext *esContext )
 {
    MSG msg = { 0 };
    int done = 0;
-   DWORD lastTime = GetTickCount();
+   double frameStart = esGetTime();
+   double lastTime = frameStart;
+   int onDemand = ( esContext->flags & ES_WINDOW_ON_DEMAND ) && esContext->benchmark.frames == 0;
+
+   esContext->benchmark.lastTime = frameStart;
+   esContext->redrawPending = GL_TRUE;
+   s_mainThreadId = GetCurrentThreadId ( );
+
+   esRenderThreadStart ( esContext );
 
    while ( !done )
    {
+      if ( esRenderThreadTakeRedraw ( esContext ) )
+      {
+         esContext->redrawPending = GL_TRUE;
+      }
+
       int gotMsg = ( PeekMessage ( &msg, NULL, 0, 0, PM_REMOVE ) != 0 );
-      DWORD curTime = GetTickCount();
-      float deltaTime = ( float ) ( curTime - lastTime ) / 1000.0f;
+      double curTime = esGetTime();
+      double deltaTime = curTime - lastTime;
       lastTime = curTime;
 
+      // Benchmark mode feeds a synthetic timestep so every run does the same work
+      if ( esContext->benchmark.frames > 0 )
+      {
+         deltaTime = esContext->benchmark.fixedDeltaTime;
+      }
+
       if ( gotMsg )
       {
          if ( msg.message == WM_QUIT )
@@ -214,17 +293,72 @@ void WinLoop ( ESContext *esContext )
             DispatchMessage ( &msg );
          }
       }
+      else if ( onDemand && !esContext->redrawPending )
+      {
+         // Sleep until a message arrives or the idle timeout expires.  WM_PAINT
+         // still draws when the window is invalidated.
+         DWORD timeout = esContext->idleTimeout > 0.0f ? ( DWORD ) ( esContext->idleTimeout * 1000.0f ) : INFINITE;
+
+         DWORD result = MsgWaitForMultipleObjects ( 0, NULL, FALSE, timeout, QS_ALLINPUT );
+
+         // The sleep is not simulated, the next update only advances by the time since
+         // waking.  The update below ticks on a timeout and advances by the idle timeout.
+         frameStart = esGetTime();
+
+         if ( result == WAIT_TIMEOUT )
+         {
+            deltaTime += frameStart - curTime;
+         }
+
+         lastTime = frameStart;
+      }
       else
       {
-         SendMessage ( esContext->eglNativeWindow, WM_PAINT, 0, 0 );
+         if ( esContext->renderThread != NULL )
+         {
+            // Draw, swap and frame pacing happen on the render thread
+            esContext->redrawPending = GL_FALSE;
+            esRenderThreadSubmit ( esContext );
+         }
+         else if ( esContext->flags & ES_WINDOW_OFFSCREEN )
+         {
+            // No window to paint, render straight into the pbuffer
+            if ( esContext->drawFunc != NULL )
+            {
+               DrawFrame ( esContext );
+            }
+         }
+         else
+         {
+            SendMessage ( esContext->eglNativeWindow, WM_PAINT, 0, 0 );
+         }
+
+         esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_FRAME], esGetTime() - frameStart );
+         esTraceFrame ( esGetTime() - frameStart );
+         frameStart = esGetTime();
+
+         if ( esBenchmarkFrame ( esContext ) == GL_TRUE )
+         {
+            done = 1;
+         }
       }
 
       // Call update function if registered
       if ( esContext->updateFunc != NULL )
       {
-         esContext->updateFunc ( esContext, deltaTime );
+         double updateStart;
+
+         esRenderThreadBeginUpdate ( esContext );
+         updateStart = esGetTime();
+
+         esTraceBegin ( "Update" );
+         esFramePacingUpdate ( esContext, deltaTime );
+         esTraceEnd ( );
+         esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_UPDATE], esGetTime() - updateStart );
       }
    }
+
+   esRenderThreadStop ( esContext );
 }
 
 ///
@@ -244,22 +378,48 @@ int main ( int argc, char *argv[] )
 
    memset ( &esContext, 0, sizeof ( ESContext ) );
 
+   esBenchmarkInit ( &esContext, argc, argv );
+   esProfileInit ( &esContext, argc, argv );
+   esFramePacingInit ( &esContext, argc, argv );
+   esTraceInit ( argc, argv );
+   esCaptureInit ( argc, argv );
+   esProgramCacheInit ( argc, argv );
+
+   esTraceBegin ( "esMain" );
+
    if ( esMain ( &esContext ) != GL_TRUE )
    {
       return 1;
    }
 
+   esTraceEnd ( );
+
    WinLoop ( &esContext );
 
+   esBenchmarkReport ( &esContext );
+   esGpuTimerShutdown ( );
+   esCaptureShutdown ( );
+
+   if ( esContext.phaseHistogramFile != NULL )
+   {
+      esDumpPhaseHistograms ( &esContext, esContext.phaseHistogramFile );
+   }
+
    if ( esContext.shutdownFunc != NULL )
    {
+      esTraceBegin ( "Shutdown" );
       esContext.shutdownFunc ( &esContext );
+      esTraceEnd ( );
    }
 
+   esTraceShutdown ( );
+
    if ( esContext.userData != NULL )
    {
       free ( esContext.userData );
    }
 
+   free ( esContext.framePackets[0] );
+
    return 0;
 }
@@ -0,0 +1,252 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESBenchmark.c
+//
+//    Deterministic benchmark mode: run a fixed number of frames with a
+//    fixed update timestep and report frame time statistics.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+///
+//  Macros
+//
+#define DEFAULT_FIXED_DELTA_TIME   ( 1.0f / 60.0f )
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// CompareDouble()
+//
+//    qsort comparison for frame times
+//
+static int CompareDouble ( const void *a, const void *b )
+{
+   double da = *( const double * ) a;
+   double db = *( const double * ) b;
+
+   return ( da > db ) - ( da < db );
+}
+
+///
+// Percentile()
+//
+//    Nearest-rank percentile of a sorted array
+//
+static double Percentile ( const double *sorted, int count, double percent )
+{
+   int rank = ( int ) ceil ( percent / 100.0 * count );
+
+   if ( rank < 1 )
+   {
+      rank = 1;
+   }
+
+   return sorted[rank - 1];
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esBenchmarkInit()
+//
+//      Configure benchmark mode from --frames, --warmup and --fixed-dt or
+//      from the ES_BENCHMARK_* environment variables
+//
+void ESUTIL_API esBenchmarkInit ( ESContext *esContext, int argc, char *argv[] )
+{
+   ESBenchmark *benchmark = &esContext->benchmark;
+   const char *value;
+
+   memset ( benchmark, 0, sizeof ( ESBenchmark ) );
+
+   if ( ( value = esGetOption ( argc, argv, "--frames", "ES_BENCHMARK_FRAMES" ) ) != NULL )
+   {
+      benchmark->frames = atoi ( value );
+   }
+
+   if ( benchmark->frames <= 0 )
+   {
+      benchmark->frames = 0;
+      return;
+   }
+
+   if ( ( value = esGetOption ( argc, argv, "--warmup", "ES_BENCHMARK_WARMUP" ) ) != NULL )
+   {
+      benchmark->warmupFrames = atoi ( value ) > 0 ? atoi ( value ) : 0;
+   }
+
+   benchmark->fixedDeltaTime = DEFAULT_FIXED_DELTA_TIME;
+
+   if ( ( value = esGetOption ( argc, argv, "--fixed-dt", "ES_BENCHMARK_FIXED_DT" ) ) != NULL )
+   {
+      benchmark->fixedDeltaTime = ( float ) atof ( value );
+   }
+
+   benchmark->frameTimes = malloc ( sizeof ( double ) * benchmark->frames );
+
+   if ( benchmark->frameTimes == NULL )
+   {
+      esLogMessage ( "esBenchmarkInit: out of memory for %d frames\n", benchmark->frames );
+      benchmark->frames = 0;
+   }
+}
+
+///
+//  esBenchmarkFrame()
+//
+//      Record the duration of the frame that just ended
+//
+GLboolean ESUTIL_API esBenchmarkFrame ( ESContext *esContext )
+{
+   ESBenchmark *benchmark = &esContext->benchmark;
+   double now = esGetTime();
+   int measured = benchmark->frameCount - benchmark->warmupFrames;
+
+   if ( benchmark->frames == 0 )
+   {
+      return GL_FALSE;
+   }
+
+   if ( measured >= 0 && measured < benchmark->frames )
+   {
+      benchmark->frameTimes[measured] = now - benchmark->lastTime;
+   }
+
+   benchmark->lastTime = now;
+   benchmark->frameCount++;
+
+   return benchmark->frameCount >= benchmark->warmupFrames + benchmark->frames ? GL_TRUE : GL_FALSE;
+}
+
+///
+//  esBenchmarkReport()
+//
+//      Print frame time statistics of the measured frames
+//
+void ESUTIL_API esBenchmarkReport ( ESContext *esContext )
+{
+   ESBenchmark *benchmark = &esContext->benchmark;
+   ESStateCounters state;
+   ESGLCounters gl;
+   GLuint64 memoryPeak;
+   int count = benchmark->frameCount - benchmark->warmupFrames;
+   double total = 0.0;
+   int i;
+
+   if ( benchmark->frames == 0 )
+   {
+      return;
+   }
+
+   if ( count > benchmark->frames )
+   {
+      count = benchmark->frames;
+   }
+
+   if ( count > 0 )
+   {
+      for ( i = 0; i < count; i++ )
+      {
+         total += benchmark->frameTimes[i];
+      }
+
+      qsort ( benchmark->frameTimes, count, sizeof ( double ), CompareDouble );
+
+      esLogMessage ( "Benchmark: %d frames (%d warm-up), fixed deltaTime %.6f s\n",
+                     count, benchmark->warmupFrames, benchmark->fixedDeltaTime );
+      esLogMessage ( "  frame time ms: min %.3f  median %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+                     benchmark->frameTimes[0] * 1000.0,
+                     Percentile ( benchmark->frameTimes, count, 50.0 ) * 1000.0,
+                     Percentile ( benchmark->frameTimes, count, 95.0 ) * 1000.0,
+                     Percentile ( benchmark->frameTimes, count, 99.0 ) * 1000.0,
+                     benchmark->frameTimes[count - 1] * 1000.0 );
+      esLogMessage ( "  fps: %.2f\n", total > 0.0 ? count / total : 0.0 );
+
+      // Counters of the state tracked calls, if the sample uses them
+      esGetStateCounters ( NULL, &state );
+
+      if ( state.frames > 0 && state.issued + state.skipped > 0 )
+      {
+         esLogMessage ( "  state calls per frame: %.1f issued, %.1f skipped\n",
+                        ( double ) state.issued / state.frames, ( double ) state.skipped / state.frames );
+      }
+
+      // GL call counters, collected when built with ES_GL_ACCOUNTING
+      esGetGLCounters ( NULL, &gl );
+
+      if ( gl.frames > 0 && gl.drawCalls > 0 )
+      {
+         double frames = gl.frames;
+
+         esLogMessage ( "  GL calls per frame: %.1f draws (%.0f primitives), %.1f program binds, %.1f texture binds\n",
+                        gl.drawCalls / frames, gl.primitives / frames, gl.programBinds / frames,
+                        gl.textureBinds / frames );
+         esLogMessage ( "  uploads per frame: buffer %.1f (%.1f KB), mapped %.1f (%.1f KB), texture %.1f (%.1f KB)\n",
+                        gl.bufferUploads / frames, gl.bufferUploadBytes / frames / 1024.0,
+                        gl.bufferMaps / frames, gl.bufferMapBytes / frames / 1024.0,
+                        gl.textureUploads / frames, gl.textureUploadBytes / frames / 1024.0 );
+         esLogMessage ( "  sync waits per frame: %.1f (%.3f ms)\n",
+                        gl.syncWaits / frames, gl.syncWaitTime / frames * 1000.0 );
+      }
+
+      // GPU memory recorded by the esMem* allocation wrappers
+      esGetGpuMemory ( ES_MEMORY_CATEGORIES, NULL, &memoryPeak );
+
+      if ( memoryPeak > 0 )
+      {
+         esGpuMemoryReport ( );
+      }
+   }
+   else
+   {
+      esLogMessage ( "Benchmark: no frames measured\n" );
+   }
+
+   free ( benchmark->frameTimes );
+   benchmark->frameTimes = NULL;
+}
@@ -0,0 +1,501 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESCapture.c
+//
+//    Frame capture without stalling the main loop.  Each frame is read
+//    into one of a ring of pixel pack buffers and mapped two frames later,
+//    once its fence has signalled.  A writer thread converts the frames
+//    and streams them to a .y4m video or a raw RGBA file.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+///
+//  Macros
+//
+#define CAPTURE_PBOS           3
+#define CAPTURE_QUEUE          4
+#define DEFAULT_CAPTURE_FPS    60
+
+#ifdef _WIN32
+#define LOCK()        EnterCriticalSection ( &s_capture.lock )
+#define UNLOCK()      LeaveCriticalSection ( &s_capture.lock )
+#define WAIT()        SleepConditionVariableCS ( &s_capture.cond, &s_capture.lock, INFINITE )
+#define BROADCAST()   WakeAllConditionVariable ( &s_capture.cond )
+#else
+#define LOCK()        pthread_mutex_lock ( &s_capture.lock )
+#define UNLOCK()      pthread_mutex_unlock ( &s_capture.lock )
+#define WAIT()        pthread_cond_wait ( &s_capture.cond, &s_capture.lock )
+#define BROADCAST()   pthread_cond_broadcast ( &s_capture.cond )
+#endif
+
+///
+//  Types
+//
+typedef struct
+{
+   // Options
+   const char     *fileName;
+   int             fps;
+
+   // Output
+   FILE           *fp;
+   GLboolean       y4m;
+   int             width;
+   int             height;
+
+   // Readback ring, frame n is read into pbos[n % CAPTURE_PBOS]
+   GLuint          pbos[CAPTURE_PBOS];
+   GLsync          fences[CAPTURE_PBOS];
+   unsigned int    framesRead;
+   unsigned int    framesMapped;
+
+   // Frames waiting for the writer thread, queue[n % CAPTURE_QUEUE] for tail <= n < head
+   unsigned char  *queue[CAPTURE_QUEUE];
+   unsigned int    head;
+   unsigned int    tail;
+   GLboolean       quit;
+
+   // Writer thread
+#ifdef _WIN32
+   HANDLE             thread;
+   CRITICAL_SECTION   lock;
+   CONDITION_VARIABLE cond;
+#else
+   pthread_t          thread;
+   pthread_mutex_t    lock;
+   pthread_cond_t     cond;
+#endif
+   unsigned char  *planes;
+   GLboolean       writeFailed;
+} Capture;
+
+static Capture s_capture;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// WriteFrame()
+//
+//    Write one RGBA frame, flipped to top-down order.  For .y4m output the
+//    frame is converted to full range BT.601 4:2:0.
+//
+static int WriteFrame ( const unsigned char *rgba )
+{
+   int width = s_capture.width;
+   int height = s_capture.height;
+   int stride = width * 4;
+   int y, x;
+
+   if ( !s_capture.y4m )
+   {
+      for ( y = height - 1; y >= 0; y-- )
+      {
+         if ( fwrite ( rgba + y * stride, stride, 1, s_capture.fp ) != 1 )
+         {
+            return 0;
+         }
+      }
+
+      return 1;
+   }
+   else
+   {
+      int chromaWidth = ( width + 1 ) / 2;
+      int chromaHeight = ( height + 1 ) / 2;
+      unsigned char *planeY = s_capture.planes;
+      unsigned char *planeU = planeY + width * height;
+      unsigned char *planeV = planeU + chromaWidth * chromaHeight;
+
+      for ( y = 0; y < height; y++ )
+      {
+         const unsigned char *row = rgba + ( height - 1 - y ) * stride;
+
+         for ( x = 0; x < width; x++ )
+         {
+            const unsigned char *p = row + x * 4;
+            planeY[y * width + x] = ( unsigned char ) ( ( 19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768 ) >> 16 );
+         }
+      }
+
+      for ( y = 0; y < chromaHeight; y++ )
+      {
+         for ( x = 0; x < chromaWidth; x++ )
+         {
+            int r = 0, g = 0, b = 0, n = 0;
+            int dy, dx;
+
+            // Average the 2x2 block, clamped at odd edges
+            for ( dy = 0; dy < 2 && y * 2 + dy < height; dy++ )
+            {
+               for ( dx = 0; dx < 2 && x * 2 + dx < width; dx++ )
+               {
+                  const unsigned char *p = rgba + ( height - 1 - ( y * 2 + dy ) ) * stride + ( x * 2 + dx ) * 4;
+                  r += p[0];
+                  g += p[1];
+                  b += p[2];
+                  n++;
+               }
+            }
+
+            r /= n;
+            g /= n;
+            b /= n;
+            planeU[y * chromaWidth + x] = ( unsigned char ) ( ( -11059 * r - 21709 * g + 32768 * b + ( 128 << 16 ) + 32768 ) >> 16 );
+            planeV[y * chromaWidth + x] = ( unsigned char ) ( ( 32768 * r - 27439 * g - 5329 * b + ( 128 << 16 ) + 32768 ) >> 16 );
+         }
+      }
+
+      return fputs ( "FRAME\n", s_capture.fp ) >= 0 &&
+             fwrite ( s_capture.planes, width * height + 2 * chromaWidth * chromaHeight, 1, s_capture.fp ) == 1;
+   }
+}
+
+///
+// WriterThreadMain()
+//
+#ifdef _WIN32
+static DWORD WINAPI WriterThreadMain ( LPVOID arg )
+#else
+static void *WriterThreadMain ( void *arg )
+#endif
+{
+   ( void ) arg;
+
+   for ( ;; )
+   {
+      unsigned char *frame;
+
+      LOCK();
+
+      while ( s_capture.tail == s_capture.head && !s_capture.quit )
+      {
+         WAIT();
+      }
+
+      if ( s_capture.tail == s_capture.head )
+      {
+         UNLOCK();
+         break;
+      }
+
+      frame = s_capture.queue[s_capture.tail % CAPTURE_QUEUE];
+      UNLOCK();
+
+      esTraceBegin ( "Capture write" );
+
+      if ( !s_capture.writeFailed && !WriteFrame ( frame ) )
+      {
+         esLogMessage ( "esCapture: write to %s failed\n", s_capture.fileName );
+         s_capture.writeFailed = GL_TRUE;
+      }
+
+      esTraceEnd ( );
+
+      LOCK();
+      s_capture.tail++;
+      BROADCAST();
+      UNLOCK();
+   }
+
+   return 0;
+}
+
+///
+// MapFrame()
+//
+//    Copy the oldest outstanding readback to the writer queue
+//
+static void MapFrame ( void )
+{
+   int pbo = s_capture.framesMapped % CAPTURE_PBOS;
+   GLsizeiptr size = ( GLsizeiptr ) s_capture.width * s_capture.height * 4;
+   unsigned char *slot;
+   void *pixels;
+
+   esTraceBegin ( "Capture map" );
+
+   // Normally signalled already, two frames have passed since the readback
+   glClientWaitSync ( s_capture.fences[pbo], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+   glDeleteSync ( s_capture.fences[pbo] );
+   s_capture.fences[pbo] = 0;
+
+   // Offline jobs need every frame, so wait for the writer rather than drop one
+   LOCK();
+
+   while ( s_capture.head - s_capture.tail == CAPTURE_QUEUE )
+   {
+      WAIT();
+   }
+
+   slot = s_capture.queue[s_capture.head % CAPTURE_QUEUE];
+   UNLOCK();
+
+   glBindBuffer ( GL_PIXEL_PACK_BUFFER, s_capture.pbos[pbo] );
+   pixels = glMapBufferRange ( GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT );
+
+   if ( pixels != NULL )
+   {
+      memcpy ( slot, pixels, size );
+      glUnmapBuffer ( GL_PIXEL_PACK_BUFFER );
+
+      LOCK();
+      s_capture.head++;
+      BROADCAST();
+      UNLOCK();
+   }
+   else
+   {
+      esLogMessage ( "esCapture: mapping readback %u failed, frame dropped\n", s_capture.framesMapped );
+   }
+
+   glBindBuffer ( GL_PIXEL_PACK_BUFFER, 0 );
+   s_capture.framesMapped++;
+
+   esTraceEnd ( );
+}
+
+///
+// StartCapture()
+//
+//    Open the output and create the buffers on the first captured frame
+//
+static GLboolean StartCapture ( ESContext *esContext )
+{
+   const char *ext = strrchr ( s_capture.fileName, '.' );
+   GLsizeiptr size = ( GLsizeiptr ) esContext->width * esContext->height * 4;
+   int failed;
+   int i;
+
+   s_capture.width = esContext->width;
+   s_capture.height = esContext->height;
+   s_capture.y4m = ext != NULL && strcmp ( ext, ".y4m" ) == 0;
+   s_capture.fp = fopen ( s_capture.fileName, "wb" );
+
+   if ( s_capture.fp == NULL )
+   {
+      esLogMessage ( "esCapture: could not open %s\n", s_capture.fileName );
+      s_capture.fileName = NULL;
+      return GL_FALSE;
+   }
+
+   if ( s_capture.y4m )
+   {
+      fprintf ( s_capture.fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                s_capture.width, s_capture.height, s_capture.fps );
+   }
+
+   s_capture.planes = malloc ( size );
+   failed = s_capture.planes == NULL;
+
+   for ( i = 0; i < CAPTURE_QUEUE; i++ )
+   {
+      s_capture.queue[i] = malloc ( size );
+      failed |= s_capture.queue[i] == NULL;
+   }
+
+   if ( failed )
+   {
+      for ( i = 0; i < CAPTURE_QUEUE; i++ )
+      {
+         free ( s_capture.queue[i] );
+      }
+
+      free ( s_capture.planes );
+      esLogMessage ( "esCapture: out of memory for %dx%d frames\n", s_capture.width, s_capture.height );
+      fclose ( s_capture.fp );
+      s_capture.fp = NULL;
+      s_capture.fileName = NULL;
+      return GL_FALSE;
+   }
+
+   glGenBuffers ( CAPTURE_PBOS, s_capture.pbos );
+
+   for ( i = 0; i < CAPTURE_PBOS; i++ )
+   {
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER, s_capture.pbos[i] );
+      esMemBufferData ( "capture", GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ );
+   }
+
+   glBindBuffer ( GL_PIXEL_PACK_BUFFER, 0 );
+
+#ifdef _WIN32
+   InitializeCriticalSection ( &s_capture.lock );
+   InitializeConditionVariable ( &s_capture.cond );
+   s_capture.thread = CreateThread ( NULL, 0, WriterThreadMain, NULL, 0, NULL );
+#else
+   pthread_mutex_init ( &s_capture.lock, NULL );
+   pthread_cond_init ( &s_capture.cond, NULL );
+   pthread_create ( &s_capture.thread, NULL, WriterThreadMain, NULL );
+#endif
+
+   return GL_TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esCaptureInit()
+//
+//      Configure capture from --capture FILE and --capture-fps N or from
+//      ES_CAPTURE and ES_CAPTURE_FPS
+//
+void ESUTIL_API esCaptureInit ( int argc, char *argv[] )
+{
+   const char *value;
+
+   s_capture.fileName = esGetOption ( argc, argv, "--capture", "ES_CAPTURE" );
+   s_capture.fps = DEFAULT_CAPTURE_FPS;
+
+   if ( ( value = esGetOption ( argc, argv, "--capture-fps", "ES_CAPTURE_FPS" ) ) != NULL && atoi ( value ) > 0 )
+   {
+      s_capture.fps = atoi ( value );
+   }
+}
+
+///
+//  esCaptureFrame()
+//
+//      Queue a readback of the back buffer and hand the frame read two
+//      frames ago to the writer thread
+//
+void ESUTIL_API esCaptureFrame ( ESContext *esContext )
+{
+   int pbo;
+   GLint readFramebuffer;
+   GLint packAlignment;
+
+   if ( s_capture.fileName == NULL )
+   {
+      return;
+   }
+
+   if ( s_capture.fp == NULL && !StartCapture ( esContext ) )
+   {
+      return;
+   }
+
+   esTraceBegin ( "Capture readback" );
+
+   // Read the presented image, not whatever framebuffer and attachment the
+   // sample left bound for reading
+   glGetIntegerv ( GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer );
+   glGetIntegerv ( GL_PACK_ALIGNMENT, &packAlignment );
+   glBindFramebuffer ( GL_READ_FRAMEBUFFER, 0 );
+   glPixelStorei ( GL_PACK_ALIGNMENT, 4 );
+
+   pbo = s_capture.framesRead % CAPTURE_PBOS;
+   glBindBuffer ( GL_PIXEL_PACK_BUFFER, s_capture.pbos[pbo] );
+   glReadPixels ( 0, 0, s_capture.width, s_capture.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glBindBuffer ( GL_PIXEL_PACK_BUFFER, 0 );
+
+   glPixelStorei ( GL_PACK_ALIGNMENT, packAlignment );
+   glBindFramebuffer ( GL_READ_FRAMEBUFFER, readFramebuffer );
+   s_capture.fences[pbo] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   s_capture.framesRead++;
+
+   esTraceEnd ( );
+
+   if ( s_capture.framesRead - s_capture.framesMapped == CAPTURE_PBOS )
+   {
+      MapFrame();
+   }
+}
+
+///
+//  esCaptureShutdown()
+//
+//      Write the outstanding frames and close the output.  The context
+//      must be current.
+//
+void ESUTIL_API esCaptureShutdown ( void )
+{
+   int i;
+
+   if ( s_capture.fp == NULL )
+   {
+      return;
+   }
+
+   while ( s_capture.framesMapped != s_capture.framesRead )
+   {
+      MapFrame();
+   }
+
+   LOCK();
+   s_capture.quit = GL_TRUE;
+   BROADCAST();
+   UNLOCK();
+
+#ifdef _WIN32
+   WaitForSingleObject ( s_capture.thread, INFINITE );
+   CloseHandle ( s_capture.thread );
+   DeleteCriticalSection ( &s_capture.lock );
+#else
+   pthread_join ( s_capture.thread, NULL );
+   pthread_cond_destroy ( &s_capture.cond );
+   pthread_mutex_destroy ( &s_capture.lock );
+#endif
+
+   esMemDeleteBuffers ( CAPTURE_PBOS, s_capture.pbos );
+   fclose ( s_capture.fp );
+
+   esLogMessage ( "Captured %u frames to %s\n", s_capture.framesMapped, s_capture.fileName );
+
+   for ( i = 0; i < CAPTURE_QUEUE; i++ )
+   {
+      free ( s_capture.queue[i] );
+   }
+
+   free ( s_capture.planes );
+   memset ( &s_capture, 0, sizeof ( s_capture ) );
+}
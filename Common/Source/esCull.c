@@ -0,0 +1,504 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESCull.c
+//
+//    Frustum culling of bounding spheres and boxes.  Four objects are
+//    tested at a time: their bounds are transposed into one register per
+//    component, so each plane costs a few multiplies for all four, and the
+//    survivors are compacted into an index list without branches.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <math.h>
+#include <string.h>
+
+///
+//  Macros
+//
+
+// SSE2 is part of every x86-64 target and NEON is enabled per ABI, so the
+// choice is made at build time.  Define ES_NO_SIMD to use the scalar path.
+#if !defined ( ES_NO_SIMD ) && ( defined ( __SSE2__ ) || defined ( _M_X64 ) || \
+                                 ( defined ( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define ES_CULL_SSE
+#include <xmmintrin.h>
+#elif !defined ( ES_NO_SIMD ) && ( defined ( __ARM_NEON ) || defined ( __ARM_NEON__ ) )
+#define ES_CULL_NEON
+#include <arm_neon.h>
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// SphereVisible()
+//
+//    Scalar test, used for the objects left over after the groups of four.
+//    Same arithmetic in the same order as the SIMD paths.
+//
+static GLboolean SphereVisible ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingSphere *sphere )
+{
+   int i;
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      GLfloat d = planes[i][0] * sphere->center[0] + planes[i][1] * sphere->center[1] +
+                  planes[i][2] * sphere->center[2] + planes[i][3];
+
+      if ( d < -sphere->radius )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// BoxVisible()
+//
+//    A box is outside a plane when its corner furthest along the plane
+//    normal is, that is when the center distance plus the projected
+//    half extent is negative
+//
+static GLboolean BoxVisible ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingBox *box )
+{
+   GLfloat cx = ( box->min[0] + box->max[0] ) * 0.5f;
+   GLfloat cy = ( box->min[1] + box->max[1] ) * 0.5f;
+   GLfloat cz = ( box->min[2] + box->max[2] ) * 0.5f;
+   GLfloat ex = ( box->max[0] - box->min[0] ) * 0.5f;
+   GLfloat ey = ( box->max[1] - box->min[1] ) * 0.5f;
+   GLfloat ez = ( box->max[2] - box->min[2] ) * 0.5f;
+   int i;
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      GLfloat d = planes[i][0] * cx + planes[i][1] * cy + planes[i][2] * cz + planes[i][3];
+      GLfloat r = fabsf ( planes[i][0] ) * ex + fabsf ( planes[i][1] ) * ey + fabsf ( planes[i][2] ) * ez;
+
+      if ( d < -r )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+#if defined ( ES_CULL_SSE ) || defined ( ES_CULL_NEON )
+
+///
+// Compact()
+//
+//    Append the indices first to first + 3 whose bit is set in mask.  Each
+//    index is written unconditionally and only counted when visible, so
+//    visible needs room for every tested object.
+//
+static GLsizei Compact ( GLuint *visible, GLsizei count, GLuint first, int mask )
+{
+   visible[count] = first;
+   count += mask & 1;
+   visible[count] = first + 1;
+   count += ( mask >> 1 ) & 1;
+   visible[count] = first + 2;
+   count += ( mask >> 2 ) & 1;
+   visible[count] = first + 3;
+   count += ( mask >> 3 ) & 1;
+
+   return count;
+}
+
+#endif
+
+#if defined ( ES_CULL_SSE )
+
+///
+// CullSpheres4()
+//
+//    Visibility mask of four spheres
+//
+static int CullSpheres4 ( const __m128 planes[ES_PLANE_COUNT][4], const ESBoundingSphere *spheres )
+{
+   __m128 x = _mm_loadu_ps ( spheres[0].center );
+   __m128 y = _mm_loadu_ps ( spheres[1].center );
+   __m128 z = _mm_loadu_ps ( spheres[2].center );
+   __m128 r = _mm_loadu_ps ( spheres[3].center );
+   __m128 inside;
+   int i;
+
+   // One sphere per register to one component per register
+   _MM_TRANSPOSE4_PS ( x, y, z, r );
+   r = _mm_sub_ps ( _mm_setzero_ps ( ), r );
+   inside = _mm_cmpeq_ps ( _mm_setzero_ps ( ), _mm_setzero_ps ( ) );
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      __m128 d = _mm_mul_ps ( planes[i][0], x );
+
+      d = _mm_add_ps ( d, _mm_mul_ps ( planes[i][1], y ) );
+      d = _mm_add_ps ( d, _mm_mul_ps ( planes[i][2], z ) );
+      d = _mm_add_ps ( d, planes[i][3] );
+      inside = _mm_and_ps ( inside, _mm_cmpge_ps ( d, r ) );
+   }
+
+   return _mm_movemask_ps ( inside );
+}
+
+///
+// CullBoxes4()
+//
+//    Visibility mask of four boxes.  absPlanes holds the absolute values of
+//    the plane normals.
+//
+static int CullBoxes4 ( const __m128 planes[ES_PLANE_COUNT][4], const __m128 absPlanes[ES_PLANE_COUNT][3],
+                        const ESBoundingBox *boxes )
+{
+   const __m128 half = _mm_set1_ps ( 0.5f );
+
+   // ( min x, min y, min z, max x ) and ( min z, max x, max y, max z ) of each box
+   __m128 minX = _mm_loadu_ps ( &boxes[0].min[0] );
+   __m128 minY = _mm_loadu_ps ( &boxes[1].min[0] );
+   __m128 minZ = _mm_loadu_ps ( &boxes[2].min[0] );
+   __m128 maxX = _mm_loadu_ps ( &boxes[3].min[0] );
+   __m128 minZ2 = _mm_loadu_ps ( &boxes[0].min[2] );
+   __m128 maxX2 = _mm_loadu_ps ( &boxes[1].min[2] );
+   __m128 maxY = _mm_loadu_ps ( &boxes[2].min[2] );
+   __m128 maxZ = _mm_loadu_ps ( &boxes[3].min[2] );
+   __m128 cx, cy, cz, ex, ey, ez;
+   __m128 inside;
+   int i;
+
+   _MM_TRANSPOSE4_PS ( minX, minY, minZ, maxX );
+   _MM_TRANSPOSE4_PS ( minZ2, maxX2, maxY, maxZ );
+
+   cx = _mm_mul_ps ( _mm_add_ps ( minX, maxX ), half );
+   cy = _mm_mul_ps ( _mm_add_ps ( minY, maxY ), half );
+   cz = _mm_mul_ps ( _mm_add_ps ( minZ, maxZ ), half );
+   ex = _mm_mul_ps ( _mm_sub_ps ( maxX, minX ), half );
+   ey = _mm_mul_ps ( _mm_sub_ps ( maxY, minY ), half );
+   ez = _mm_mul_ps ( _mm_sub_ps ( maxZ, minZ ), half );
+   inside = _mm_cmpeq_ps ( _mm_setzero_ps ( ), _mm_setzero_ps ( ) );
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      __m128 d = _mm_mul_ps ( planes[i][0], cx );
+      __m128 r = _mm_mul_ps ( absPlanes[i][0], ex );
+
+      d = _mm_add_ps ( d, _mm_mul_ps ( planes[i][1], cy ) );
+      d = _mm_add_ps ( d, _mm_mul_ps ( planes[i][2], cz ) );
+      d = _mm_add_ps ( d, planes[i][3] );
+      r = _mm_add_ps ( r, _mm_mul_ps ( absPlanes[i][1], ey ) );
+      r = _mm_add_ps ( r, _mm_mul_ps ( absPlanes[i][2], ez ) );
+      inside = _mm_and_ps ( inside, _mm_cmpge_ps ( d, _mm_sub_ps ( _mm_setzero_ps ( ), r ) ) );
+   }
+
+   return _mm_movemask_ps ( inside );
+}
+
+#elif defined ( ES_CULL_NEON )
+
+///
+// Mask()
+//
+//    Bit per lane of a comparison result, like _mm_movemask_ps()
+//
+static int Mask ( uint32x4_t inside )
+{
+   return ( int ) ( ( vgetq_lane_u32 ( inside, 0 ) & 1 ) | ( vgetq_lane_u32 ( inside, 1 ) & 2 ) |
+                    ( vgetq_lane_u32 ( inside, 2 ) & 4 ) | ( vgetq_lane_u32 ( inside, 3 ) & 8 ) );
+}
+
+///
+// CullSpheres4()
+//
+//    Visibility mask of four spheres.  Separate multiplies and adds, a fused
+//    multiply-add would round differently from the scalar test.
+//
+static int CullSpheres4 ( const float32x4_t planes[ES_PLANE_COUNT][4], const ESBoundingSphere *spheres )
+{
+   // De-interleaves straight into one component per register
+   float32x4x4_t s = vld4q_f32 ( spheres[0].center );
+   float32x4_t r = vnegq_f32 ( s.val[3] );
+   uint32x4_t inside = vdupq_n_u32 ( 0xffffffff );
+   int i;
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      float32x4_t d = vmulq_f32 ( planes[i][0], s.val[0] );
+
+      d = vaddq_f32 ( d, vmulq_f32 ( planes[i][1], s.val[1] ) );
+      d = vaddq_f32 ( d, vmulq_f32 ( planes[i][2], s.val[2] ) );
+      d = vaddq_f32 ( d, planes[i][3] );
+      inside = vandq_u32 ( inside, vcgeq_f32 ( d, r ) );
+   }
+
+   return Mask ( inside );
+}
+
+///
+// CullBoxes4()
+//
+//    Visibility mask of four boxes.  absPlanes holds the absolute values of
+//    the plane normals.
+//
+static int CullBoxes4 ( const float32x4_t planes[ES_PLANE_COUNT][4], const float32x4_t absPlanes[ES_PLANE_COUNT][3],
+                        const ESBoundingBox *boxes )
+{
+   const float32x4_t half = vdupq_n_f32 ( 0.5f );
+
+   // Six floats per box, so each de-interleaving load gives ( min, max, min, max ) of
+   // one component of two boxes, and unzipping two of them separates mins from maxes
+   float32x4x3_t lo = vld3q_f32 ( &boxes[0].min[0] );
+   float32x4x3_t hi = vld3q_f32 ( &boxes[2].min[0] );
+   float32x4x2_t x = vuzpq_f32 ( lo.val[0], hi.val[0] );
+   float32x4x2_t y = vuzpq_f32 ( lo.val[1], hi.val[1] );
+   float32x4x2_t z = vuzpq_f32 ( lo.val[2], hi.val[2] );
+   float32x4_t minX = x.val[0], maxX = x.val[1];
+   float32x4_t minY = y.val[0], maxY = y.val[1];
+   float32x4_t minZ = z.val[0], maxZ = z.val[1];
+   float32x4_t cx, cy, cz, ex, ey, ez;
+   uint32x4_t inside = vdupq_n_u32 ( 0xffffffff );
+   int i;
+
+   cx = vmulq_f32 ( vaddq_f32 ( minX, maxX ), half );
+   cy = vmulq_f32 ( vaddq_f32 ( minY, maxY ), half );
+   cz = vmulq_f32 ( vaddq_f32 ( minZ, maxZ ), half );
+   ex = vmulq_f32 ( vsubq_f32 ( maxX, minX ), half );
+   ey = vmulq_f32 ( vsubq_f32 ( maxY, minY ), half );
+   ez = vmulq_f32 ( vsubq_f32 ( maxZ, minZ ), half );
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      float32x4_t d = vmulq_f32 ( planes[i][0], cx );
+      float32x4_t r = vmulq_f32 ( absPlanes[i][0], ex );
+
+      d = vaddq_f32 ( d, vmulq_f32 ( planes[i][1], cy ) );
+      d = vaddq_f32 ( d, vmulq_f32 ( planes[i][2], cz ) );
+      d = vaddq_f32 ( d, planes[i][3] );
+      r = vaddq_f32 ( r, vmulq_f32 ( absPlanes[i][1], ey ) );
+      r = vaddq_f32 ( r, vmulq_f32 ( absPlanes[i][2], ez ) );
+      inside = vandq_u32 ( inside, vcgeq_f32 ( d, vnegq_f32 ( r ) ) );
+   }
+
+   return Mask ( inside );
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esCullSpheres()
+//
+GLsizei ESUTIL_API esCullSpheres ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingSphere *spheres,
+                                   GLsizei count, GLuint *visible )
+{
+   GLsizei visibleCount = 0;
+   GLsizei i = 0;
+
+#if defined ( ES_CULL_SSE ) || defined ( ES_CULL_NEON )
+   {
+#if defined ( ES_CULL_SSE )
+      __m128 simdPlanes[ES_PLANE_COUNT][4];
+#else
+      float32x4_t simdPlanes[ES_PLANE_COUNT][4];
+#endif
+      int p, c;
+
+      // Each plane coefficient broadcast to all four lanes
+      for ( p = 0; p < ES_PLANE_COUNT; p++ )
+      {
+         for ( c = 0; c < 4; c++ )
+         {
+#if defined ( ES_CULL_SSE )
+            simdPlanes[p][c] = _mm_set1_ps ( planes[p][c] );
+#else
+            simdPlanes[p][c] = vdupq_n_f32 ( planes[p][c] );
+#endif
+         }
+      }
+
+      for ( ; i + 4 <= count; i += 4 )
+      {
+         visibleCount = Compact ( visible, visibleCount, i, CullSpheres4 ( simdPlanes, &spheres[i] ) );
+      }
+   }
+#endif
+
+   for ( ; i < count; i++ )
+   {
+      visible[visibleCount] = i;
+      visibleCount += SphereVisible ( planes, &spheres[i] );
+   }
+
+   return visibleCount;
+}
+
+///
+// esCullBoxes()
+//
+GLsizei ESUTIL_API esCullBoxes ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingBox *boxes,
+                                 GLsizei count, GLuint *visible )
+{
+   GLsizei visibleCount = 0;
+   GLsizei i = 0;
+
+#if defined ( ES_CULL_SSE ) || defined ( ES_CULL_NEON )
+   {
+#if defined ( ES_CULL_SSE )
+      __m128 simdPlanes[ES_PLANE_COUNT][4];
+      __m128 absPlanes[ES_PLANE_COUNT][3];
+#else
+      float32x4_t simdPlanes[ES_PLANE_COUNT][4];
+      float32x4_t absPlanes[ES_PLANE_COUNT][3];
+#endif
+      int p, c;
+
+      for ( p = 0; p < ES_PLANE_COUNT; p++ )
+      {
+         for ( c = 0; c < 4; c++ )
+         {
+#if defined ( ES_CULL_SSE )
+            simdPlanes[p][c] = _mm_set1_ps ( planes[p][c] );
+
+            if ( c < 3 )
+            {
+               absPlanes[p][c] = _mm_set1_ps ( fabsf ( planes[p][c] ) );
+            }
+#else
+            simdPlanes[p][c] = vdupq_n_f32 ( planes[p][c] );
+
+            if ( c < 3 )
+            {
+               absPlanes[p][c] = vdupq_n_f32 ( fabsf ( planes[p][c] ) );
+            }
+#endif
+         }
+      }
+
+      for ( ; i + 4 <= count; i += 4 )
+      {
+         visibleCount = Compact ( visible, visibleCount, i, CullBoxes4 ( simdPlanes, absPlanes, &boxes[i] ) );
+      }
+   }
+#endif
+
+   for ( ; i < count; i++ )
+   {
+      visible[visibleCount] = i;
+      visibleCount += BoxVisible ( planes, &boxes[i] );
+   }
+
+   return visibleCount;
+}
+
+///
+// esCullGather()
+//
+void ESUTIL_API esCullGather ( void *result, const void *src, GLsizei elementSize,
+                               const GLuint *visible, GLsizei visibleCount )
+{
+   GLubyte *dst = ( GLubyte * ) result;
+   const GLubyte *from = ( const GLubyte * ) src;
+   GLsizei i;
+
+   // visible is ascending, so compacting in place only ever copies downwards
+   for ( i = 0; i < visibleCount; i++, dst += elementSize )
+   {
+      memmove ( dst, from + ( size_t ) visible[i] * elementSize, elementSize );
+   }
+}
+
+///
+// esBoundingBoxFromPositions()
+//
+void ESUTIL_API esBoundingBoxFromPositions ( ESBoundingBox *result, const GLfloat *positions, GLsizei vertexCount )
+{
+   GLsizei i;
+   int c;
+
+   memset ( result, 0, sizeof ( ESBoundingBox ) );
+
+   for ( i = 0; i < vertexCount; i++, positions += 3 )
+   {
+      for ( c = 0; c < 3; c++ )
+      {
+         if ( i == 0 || positions[c] < result->min[c] )
+         {
+            result->min[c] = positions[c];
+         }
+
+         if ( i == 0 || positions[c] > result->max[c] )
+         {
+            result->max[c] = positions[c];
+         }
+      }
+   }
+}
+
+///
+// esBoundingBoxTransform()
+//
+void ESUTIL_API esBoundingBoxTransform ( ESBoundingBox *result, const ESBoundingBox *box, const ESAffine *transform )
+{
+   GLfloat center[3], extent[3];
+   int c;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      center[c] = ( box->min[c] + box->max[c] ) * 0.5f;
+      extent[c] = ( box->max[c] - box->min[c] ) * 0.5f;
+   }
+
+   // The center is transformed as a point, the extent by the absolute
+   // values of the linear part so the result encloses the rotated box
+   for ( c = 0; c < 3; c++ )
+   {
+      GLfloat newCenter = center[0] * transform->m[0][c] + center[1] * transform->m[1][c] +
+                          center[2] * transform->m[2][c] + transform->m[3][c];
+      GLfloat newExtent = extent[0] * fabsf ( transform->m[0][c] ) + extent[1] * fabsf ( transform->m[1][c] ) +
+                          extent[2] * fabsf ( transform->m[2][c] );
+
+      result->min[c] = newCenter - newExtent;
+      result->max[c] = newCenter + newExtent;
+   }
+}
@@ -0,0 +1,337 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESFramePacing.c
+//
+//    Frame pacing: swap interval control, a bound on the number of frames
+//    the CPU may queue ahead of the GPU, an optional frame rate limiter and
+//    an optional fixed-timestep update scheduler.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+///
+//  Macros
+//
+#define DEFAULT_MAX_UPDATES_PER_FRAME   8
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// SleepUntil()
+//
+//    Sleep until esGetTime() reaches the given time
+//
+static void SleepUntil ( double wakeTime )
+{
+#if defined(_WIN32)
+   double remaining = wakeTime - esGetTime();
+
+   // Sleep() has millisecond granularity, spin for the remainder
+   if ( remaining > 0.002 )
+   {
+      Sleep ( ( DWORD ) ( ( remaining - 0.001 ) * 1000.0 ) );
+   }
+
+   while ( esGetTime() < wakeTime )
+   {
+   }
+#elif defined(__APPLE__)
+   double remaining = wakeTime - esGetTime();
+   struct timespec duration;
+
+   if ( remaining > 0.0 )
+   {
+      duration.tv_sec = ( time_t ) remaining;
+      duration.tv_nsec = ( long ) ( ( remaining - ( double ) duration.tv_sec ) * 1e9 );
+      nanosleep ( &duration, NULL );
+   }
+#else
+   // esGetTime() reads CLOCK_MONOTONIC, so an absolute deadline avoids drift
+   struct timespec deadline;
+
+   deadline.tv_sec = ( time_t ) wakeTime;
+   deadline.tv_nsec = ( long ) ( ( wakeTime - ( double ) deadline.tv_sec ) * 1e9 );
+
+   while ( clock_nanosleep ( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) != 0 && esGetTime() < wakeTime )
+   {
+   }
+#endif
+}
+
+///
+// ReleaseFences()
+//
+static void ReleaseFences ( ESFramePacing *framePacing )
+{
+   int i;
+
+   for ( i = 0; i < ES_MAX_FRAMES_IN_FLIGHT; i++ )
+   {
+      if ( framePacing->fences[i] != 0 )
+      {
+         glDeleteSync ( framePacing->fences[i] );
+         framePacing->fences[i] = 0;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esFramePacingInit()
+//
+//      Configure frame pacing from --swap-interval, --max-frames-in-flight and
+//      --target-fps or from the matching environment variables
+//
+void ESUTIL_API esFramePacingInit ( ESContext *esContext, int argc, char *argv[] )
+{
+   const char *value;
+
+   if ( ( value = esGetOption ( argc, argv, "--swap-interval", "ES_SWAP_INTERVAL" ) ) != NULL )
+   {
+      esSetSwapInterval ( esContext, atoi ( value ) );
+   }
+
+   if ( ( value = esGetOption ( argc, argv, "--max-frames-in-flight", "ES_MAX_FRAMES_IN_FLIGHT" ) ) != NULL )
+   {
+      esSetMaxFramesInFlight ( esContext, atoi ( value ) );
+   }
+
+   if ( ( value = esGetOption ( argc, argv, "--target-fps", "ES_TARGET_FPS" ) ) != NULL )
+   {
+      esSetTargetFps ( esContext, ( GLfloat ) atof ( value ) );
+   }
+
+   if ( ( value = esGetOption ( argc, argv, "--fixed-timestep", "ES_FIXED_TIMESTEP" ) ) != NULL )
+   {
+      esSetFixedTimestep ( esContext, ( GLfloat ) atof ( value ) );
+   }
+}
+
+///
+//  esSetSwapInterval()
+//
+GLboolean ESUTIL_API esSetSwapInterval ( ESContext *esContext, GLint interval )
+{
+   esContext->framePacing.swapInterval = interval;
+   esContext->framePacing.swapIntervalSet = GL_TRUE;
+
+#ifndef __APPLE__
+
+   if ( esContext->eglDisplay != EGL_NO_DISPLAY && esContext->eglDisplay != NULL )
+   {
+      if ( !eglSwapInterval ( esContext->eglDisplay, interval ) )
+      {
+         esLogMessage ( "esSetSwapInterval: eglSwapInterval ( %d ) failed\n", interval );
+         return GL_FALSE;
+      }
+   }
+
+#endif
+   return GL_TRUE;
+}
+
+///
+//  esSetMaxFramesInFlight()
+//
+void ESUTIL_API esSetMaxFramesInFlight ( ESContext *esContext, GLint maxFrames )
+{
+   ESFramePacing *framePacing = &esContext->framePacing;
+
+   if ( maxFrames < 0 )
+   {
+      maxFrames = 0;
+   }
+   else if ( maxFrames > ES_MAX_FRAMES_IN_FLIGHT )
+   {
+      maxFrames = ES_MAX_FRAMES_IN_FLIGHT;
+   }
+
+   // The ring is indexed modulo the limit, so start over when it changes
+   if ( maxFrames != framePacing->maxFramesInFlight )
+   {
+      ReleaseFences ( framePacing );
+      framePacing->frameIndex = 0;
+   }
+
+   framePacing->maxFramesInFlight = maxFrames;
+}
+
+///
+//  esSetTargetFps()
+//
+void ESUTIL_API esSetTargetFps ( ESContext *esContext, GLfloat fps )
+{
+   esContext->framePacing.targetFps = fps > 0.0f ? fps : 0.0f;
+   esContext->framePacing.nextFrameTime = 0.0;
+}
+
+///
+//  esSetFixedTimestep()
+//
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, GLfloat timestep )
+{
+   ESFramePacing *framePacing = &esContext->framePacing;
+
+   framePacing->fixedTimestep = timestep > 0.0f ? timestep : 0.0f;
+   framePacing->updateAccumulator = 0.0;
+
+   if ( framePacing->maxUpdatesPerFrame == 0 )
+   {
+      framePacing->maxUpdatesPerFrame = DEFAULT_MAX_UPDATES_PER_FRAME;
+   }
+}
+
+///
+//  esGetInterpolationAlpha()
+//
+GLfloat ESUTIL_API esGetInterpolationAlpha ( ESContext *esContext )
+{
+   // The main thread keeps updating framePacing while the render thread draws
+   if ( esOnRenderThread ( esContext ) )
+   {
+      return esContext->framePacketAlpha[esContext->drawPacket == esContext->framePackets[1]];
+   }
+
+   return esContext->framePacing.fixedTimestep > 0.0f ? esContext->framePacing.interpolationAlpha : 1.0f;
+}
+
+///
+//  esFramePacingUpdate()
+//
+//      Run the update callback for the time elapsed since the previous frame
+//
+void ESUTIL_API esFramePacingUpdate ( ESContext *esContext, double elapsed )
+{
+   ESFramePacing *framePacing = &esContext->framePacing;
+   double timestep = framePacing->fixedTimestep;
+   int updates = 0;
+
+   if ( esContext->updateFunc == NULL )
+   {
+      return;
+   }
+
+   if ( timestep <= 0.0 )
+   {
+      esContext->updateFunc ( esContext, ( float ) elapsed );
+      return;
+   }
+
+   framePacing->updateAccumulator += elapsed;
+
+   while ( framePacing->updateAccumulator >= timestep )
+   {
+      // Past the limit the simulation slows down rather than falling further behind
+      if ( updates == framePacing->maxUpdatesPerFrame )
+      {
+         framePacing->updateAccumulator = 0.0;
+         break;
+      }
+
+      esContext->updateFunc ( esContext, ( float ) timestep );
+      framePacing->updateAccumulator -= timestep;
+      updates++;
+   }
+
+   framePacing->interpolationAlpha = ( GLfloat ) ( framePacing->updateAccumulator / timestep );
+}
+
+///
+//  esFramePacingFrame()
+//
+//      Called after each swap.  Waits until at most maxFramesInFlight - 1 earlier
+//      frames are still queued on the GPU, then sleeps until the target frame time.
+//
+void ESUTIL_API esFramePacingFrame ( ESContext *esContext )
+{
+   ESFramePacing *framePacing = &esContext->framePacing;
+
+   if ( framePacing->maxFramesInFlight > 0 )
+   {
+      GLuint maxFrames = ( GLuint ) framePacing->maxFramesInFlight;
+      GLuint slot = framePacing->frameIndex % maxFrames;
+      GLuint oldest = ( framePacing->frameIndex + 1 ) % maxFrames;
+
+      // The slot was emptied when its fence was waited on as the oldest
+      framePacing->fences[slot] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      framePacing->frameIndex++;
+
+      if ( framePacing->fences[oldest] != 0 )
+      {
+         esTraceBegin ( "Wait for GPU" );
+         glClientWaitSync ( framePacing->fences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+         esTraceEnd ( );
+
+         glDeleteSync ( framePacing->fences[oldest] );
+         framePacing->fences[oldest] = 0;
+      }
+   }
+
+   if ( framePacing->targetFps > 0.0f )
+   {
+      double period = 1.0 / framePacing->targetFps;
+      double now = esGetTime();
+
+      // Start over rather than rushing to catch up after a slow frame
+      if ( framePacing->nextFrameTime == 0.0 || now > framePacing->nextFrameTime + period )
+      {
+         framePacing->nextFrameTime = now;
+      }
+
+      framePacing->nextFrameTime += period;
+
+      if ( now < framePacing->nextFrameTime )
+      {
+         esTraceBegin ( "Frame limiter" );
+         SleepUntil ( framePacing->nextFrameTime );
+         esTraceEnd ( );
+      }
+   }
+}
@@ -0,0 +1,363 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESGLAccount.c
+//
+//    GL call accounting.  With ES_GL_ACCOUNTING defined, esUtil.h maps
+//    the draw, bind, upload and sync calls onto the wrappers here, which
+//    count them per frame before calling GL.  Without it nothing is
+//    wrapped and only the (zero) counters remain.
+//
+
+///
+//  Includes
+//
+#define ES_GL_ACCOUNTING_IMPL
+#include "esUtil.h"
+#include <string.h>
+
+///
+//  Module state
+//
+static ESGLCounters s_frame;
+static ESGLCounters s_lastFrame;
+static ESGLCounters s_total;
+
+#ifdef ES_GL_ACCOUNTING
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Primitives()
+//
+//    Primitives assembled from count vertices
+//
+static GLuint Primitives ( GLenum mode, GLsizei count )
+{
+   switch ( mode )
+   {
+      case GL_POINTS:         return count;
+      case GL_LINES:          return count / 2;
+      case GL_LINE_LOOP:      return count > 1 ? count : 0;
+      case GL_LINE_STRIP:     return count > 1 ? count - 1 : 0;
+      case GL_TRIANGLES:      return count / 3;
+      case GL_TRIANGLE_STRIP:
+      case GL_TRIANGLE_FAN:   return count > 2 ? count - 2 : 0;
+      default:                return 0;
+   }
+}
+
+///
+// CountDraw()
+//
+static void CountDraw ( GLenum mode, GLsizei count, GLsizei instanceCount )
+{
+   s_frame.drawCalls++;
+   s_frame.primitives += Primitives ( mode, count ) * instanceCount;
+}
+
+///
+// CountTextureUpload()
+//
+//    Without client pixels nothing is uploaded, unless a pixel unpack
+//    buffer is bound, which is not tracked
+//
+static void CountTextureUpload ( GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                 const void *pixels )
+{
+   if ( pixels != NULL )
+   {
+      s_frame.textureUploads++;
+      s_frame.textureUploadBytes += ( double ) width * height * depth * esPixelSize ( format, type );
+   }
+}
+
+///
+// CountSyncWait()
+//
+static void CountSyncWait ( double start )
+{
+   s_frame.syncWaits++;
+   s_frame.syncWaitTime += esGetTime ( ) - start;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  GL Wrappers
+//
+//
+
+///
+// esCountDrawArrays()
+//
+void ESUTIL_API esCountDrawArrays ( GLenum mode, GLint first, GLsizei count )
+{
+   CountDraw ( mode, count, 1 );
+   glDrawArrays ( mode, first, count );
+}
+
+///
+// esCountDrawElements()
+//
+void ESUTIL_API esCountDrawElements ( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+   CountDraw ( mode, count, 1 );
+   glDrawElements ( mode, count, type, indices );
+}
+
+///
+// esCountDrawRangeElements()
+//
+void ESUTIL_API esCountDrawRangeElements ( GLenum mode, GLuint start, GLuint end, GLsizei count,
+                                           GLenum type, const void *indices )
+{
+   CountDraw ( mode, count, 1 );
+   glDrawRangeElements ( mode, start, end, count, type, indices );
+}
+
+///
+// esCountDrawArraysInstanced()
+//
+void ESUTIL_API esCountDrawArraysInstanced ( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount )
+{
+   CountDraw ( mode, count, instanceCount );
+   glDrawArraysInstanced ( mode, first, count, instanceCount );
+}
+
+///
+// esCountDrawElementsInstanced()
+//
+void ESUTIL_API esCountDrawElementsInstanced ( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                               GLsizei instanceCount )
+{
+   CountDraw ( mode, count, instanceCount );
+   glDrawElementsInstanced ( mode, count, type, indices, instanceCount );
+}
+
+///
+// esCountUseProgram()
+//
+void ESUTIL_API esCountUseProgram ( GLuint program )
+{
+   s_frame.programBinds++;
+   glUseProgram ( program );
+}
+
+///
+// esCountBindTexture()
+//
+void ESUTIL_API esCountBindTexture ( GLenum target, GLuint texture )
+{
+   s_frame.textureBinds++;
+   glBindTexture ( target, texture );
+}
+
+///
+// esCountBufferData()
+//
+void ESUTIL_API esCountBufferData ( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+   if ( data != NULL )
+   {
+      s_frame.bufferUploads++;
+      s_frame.bufferUploadBytes += ( double ) size;
+   }
+
+   glBufferData ( target, size, data, usage );
+}
+
+///
+// esCountBufferSubData()
+//
+void ESUTIL_API esCountBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const void *data )
+{
+   s_frame.bufferUploads++;
+   s_frame.bufferUploadBytes += ( double ) size;
+   glBufferSubData ( target, offset, size, data );
+}
+
+///
+// esCountMapBufferRange()
+//
+void *ESUTIL_API esCountMapBufferRange ( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+   if ( access & GL_MAP_WRITE_BIT )
+   {
+      s_frame.bufferMaps++;
+      s_frame.bufferMapBytes += ( double ) length;
+   }
+
+   return glMapBufferRange ( target, offset, length, access );
+}
+
+///
+// esCountTexImage2D()
+//
+void ESUTIL_API esCountTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                    GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels )
+{
+   CountTextureUpload ( width, height, 1, format, type, pixels );
+   glTexImage2D ( target, level, internalformat, width, height, border, format, type, pixels );
+}
+
+///
+// esCountTexImage3D()
+//
+void ESUTIL_API esCountTexImage3D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                    GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type,
+                                    const void *pixels )
+{
+   CountTextureUpload ( width, height, depth, format, type, pixels );
+   glTexImage3D ( target, level, internalformat, width, height, depth, border, format, type, pixels );
+}
+
+///
+// esCountTexSubImage2D()
+//
+void ESUTIL_API esCountTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                       GLsizei height, GLenum format, GLenum type, const void *pixels )
+{
+   CountTextureUpload ( width, height, 1, format, type, pixels );
+   glTexSubImage2D ( target, level, xoffset, yoffset, width, height, format, type, pixels );
+}
+
+///
+// esCountTexSubImage3D()
+//
+void ESUTIL_API esCountTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                       GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                       const void *pixels )
+{
+   CountTextureUpload ( width, height, depth, format, type, pixels );
+   glTexSubImage3D ( target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels );
+}
+
+///
+// esCountCompressedTexImage2D()
+//
+void ESUTIL_API esCountCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat, GLsizei width,
+                                              GLsizei height, GLint border, GLsizei imageSize, const void *data )
+{
+   if ( data != NULL )
+   {
+      s_frame.textureUploads++;
+      s_frame.textureUploadBytes += ( double ) imageSize;
+   }
+
+   glCompressedTexImage2D ( target, level, internalformat, width, height, border, imageSize, data );
+}
+
+///
+// esCountClientWaitSync()
+//
+GLenum ESUTIL_API esCountClientWaitSync ( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+   double start = esGetTime ( );
+   GLenum result = glClientWaitSync ( sync, flags, timeout );
+
+   CountSyncWait ( start );
+   return result;
+}
+
+///
+// esCountWaitSync()
+//
+void ESUTIL_API esCountWaitSync ( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+   double start = esGetTime ( );
+
+   glWaitSync ( sync, flags, timeout );
+   CountSyncWait ( start );
+}
+
+///
+// esCountFinish()
+//
+void ESUTIL_API esCountFinish ( void )
+{
+   double start = esGetTime ( );
+
+   glFinish ( );
+   CountSyncWait ( start );
+}
+
+#endif // ES_GL_ACCOUNTING
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esGLCountersFrame()
+//
+void ESUTIL_API esGLCountersFrame ( void )
+{
+   s_frame.frames = 1;
+   s_lastFrame = s_frame;
+
+   s_total.frames++;
+   s_total.drawCalls += s_frame.drawCalls;
+   s_total.primitives += s_frame.primitives;
+   s_total.programBinds += s_frame.programBinds;
+   s_total.textureBinds += s_frame.textureBinds;
+   s_total.bufferUploads += s_frame.bufferUploads;
+   s_total.bufferUploadBytes += s_frame.bufferUploadBytes;
+   s_total.bufferMaps += s_frame.bufferMaps;
+   s_total.bufferMapBytes += s_frame.bufferMapBytes;
+   s_total.textureUploads += s_frame.textureUploads;
+   s_total.textureUploadBytes += s_frame.textureUploadBytes;
+   s_total.syncWaits += s_frame.syncWaits;
+   s_total.syncWaitTime += s_frame.syncWaitTime;
+
+   memset ( &s_frame, 0, sizeof ( s_frame ) );
+}
+
+///
+// esGetGLCounters()
+//
+void ESUTIL_API esGetGLCounters ( ESGLCounters *lastFrame, ESGLCounters *total )
+{
+   if ( lastFrame != NULL )
+   {
+      *lastFrame = s_lastFrame;
+   }
+
+   if ( total != NULL )
+   {
+      *total = s_total;
+   }
+}
@@ -0,0 +1,698 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESGpuMemory.c
+//
+//    GPU memory accounting.  Allocation wrappers record an estimate of
+//    the memory behind each buffer, texture level and renderbuffer under
+//    a label, so current and peak usage can be reported per category and
+//    per label.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Types
+//
+typedef struct
+{
+   int             category;
+   GLuint          object;
+
+   // Cube map face and mip level, level -1 for immutable storage of every level
+   GLint           face;
+   GLint           level;
+
+   // Texture target the object is bound to and the dimensions of the level
+   GLenum          bindTarget;
+   GLsizei         width;
+   GLsizei         height;
+   GLsizei         depth;
+   GLuint          texelSize;
+
+   const char     *label;
+   GLuint64        bytes;
+} MemoryEntry;
+
+typedef struct
+{
+   const char     *label;
+   int             category;
+   GLuint64        current;
+   GLuint64        peak;
+} MemoryLabel;
+
+///
+//  Module state
+//
+static MemoryEntry *s_entries;
+static int          s_entryCount;
+static int          s_entryCapacity;
+static MemoryLabel *s_labels;
+static int          s_labelCount;
+static int          s_labelCapacity;
+static GLuint64     s_current[ES_MEMORY_CATEGORIES + 1];
+static GLuint64     s_peak[ES_MEMORY_CATEGORIES + 1];
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// GetLabel()
+//
+static MemoryLabel *GetLabel ( const char *label, int category )
+{
+   int i;
+
+   for ( i = 0; i < s_labelCount; i++ )
+   {
+      if ( s_labels[i].category == category && strcmp ( s_labels[i].label, label ) == 0 )
+      {
+         return &s_labels[i];
+      }
+   }
+
+   if ( s_labelCount == s_labelCapacity )
+   {
+      int capacity = s_labelCapacity != 0 ? s_labelCapacity * 2 : 16;
+      MemoryLabel *labels = realloc ( s_labels, capacity * sizeof ( MemoryLabel ) );
+
+      if ( labels == NULL )
+      {
+         return NULL;
+      }
+
+      s_labels = labels;
+      s_labelCapacity = capacity;
+   }
+
+   memset ( &s_labels[s_labelCount], 0, sizeof ( MemoryLabel ) );
+   s_labels[s_labelCount].label = label;
+   s_labels[s_labelCount].category = category;
+
+   return &s_labels[s_labelCount++];
+}
+
+///
+// Account()
+//
+//    Add bytes to a label and its category, or remove them if release is set
+//
+static void Account ( const char *label, int category, GLuint64 bytes, GLboolean release )
+{
+   MemoryLabel *memoryLabel = GetLabel ( label, category );
+   GLuint64 *totals[3];
+   GLuint64 *peaks[3];
+   int i;
+
+   totals[0] = &s_current[category];
+   totals[1] = &s_current[ES_MEMORY_CATEGORIES];
+   totals[2] = memoryLabel != NULL ? &memoryLabel->current : NULL;
+   peaks[0] = &s_peak[category];
+   peaks[1] = &s_peak[ES_MEMORY_CATEGORIES];
+   peaks[2] = memoryLabel != NULL ? &memoryLabel->peak : NULL;
+
+   for ( i = 0; i < 3 && totals[i] != NULL; i++ )
+   {
+      if ( release )
+      {
+         *totals[i] -= bytes < *totals[i] ? bytes : *totals[i];
+      }
+      else
+      {
+         *totals[i] += bytes;
+
+         if ( *totals[i] > *peaks[i] )
+         {
+            *peaks[i] = *totals[i];
+         }
+      }
+   }
+}
+
+///
+// RemoveEntry()
+//
+static void RemoveEntry ( int index )
+{
+   Account ( s_entries[index].label, s_entries[index].category, s_entries[index].bytes, GL_TRUE );
+   s_entries[index] = s_entries[--s_entryCount];
+}
+
+///
+// Record()
+//
+//    Record the memory of an object level, replacing what was recorded for
+//    the same level before.  Immutable storage replaces every level.
+//
+static void Record ( const MemoryEntry *entry )
+{
+   int i;
+
+   if ( entry->object == 0 )
+   {
+      return;
+   }
+
+   for ( i = s_entryCount - 1; i >= 0; i-- )
+   {
+      const MemoryEntry *old = &s_entries[i];
+
+      if ( old->category == entry->category && old->object == entry->object &&
+           ( entry->level < 0 || ( old->face == entry->face && old->level == entry->level ) ) )
+      {
+         RemoveEntry ( i );
+      }
+   }
+
+   if ( s_entryCount == s_entryCapacity )
+   {
+      int capacity = s_entryCapacity != 0 ? s_entryCapacity * 2 : 64;
+      MemoryEntry *entries = realloc ( s_entries, capacity * sizeof ( MemoryEntry ) );
+
+      if ( entries == NULL )
+      {
+         return;
+      }
+
+      s_entries = entries;
+      s_entryCapacity = capacity;
+   }
+
+   s_entries[s_entryCount] = *entry;
+
+   if ( s_entries[s_entryCount].label == NULL )
+   {
+      s_entries[s_entryCount].label = "(unlabeled)";
+   }
+
+   Account ( s_entries[s_entryCount].label, entry->category, entry->bytes, GL_FALSE );
+   s_entryCount++;
+}
+
+///
+// Release()
+//
+static void Release ( int category, GLsizei n, const GLuint *objects )
+{
+   GLsizei j;
+   int i;
+
+   for ( j = 0; j < n; j++ )
+   {
+      for ( i = s_entryCount - 1; i >= 0; i-- )
+      {
+         if ( s_entries[i].category == category && s_entries[i].object == objects[j] )
+         {
+            RemoveEntry ( i );
+         }
+      }
+   }
+}
+
+///
+// BoundObject()
+//
+//    Object bound to target, only queried when memory is allocated
+//
+static GLuint BoundObject ( int category, GLenum target )
+{
+   GLenum binding;
+   GLint object = 0;
+
+   if ( category == ES_MEMORY_RENDERBUFFER )
+   {
+      binding = GL_RENDERBUFFER_BINDING;
+   }
+   else if ( category == ES_MEMORY_TEXTURE )
+   {
+      switch ( target )
+      {
+         case GL_TEXTURE_3D:       binding = GL_TEXTURE_BINDING_3D;       break;
+         case GL_TEXTURE_2D_ARRAY: binding = GL_TEXTURE_BINDING_2D_ARRAY; break;
+         case GL_TEXTURE_CUBE_MAP: binding = GL_TEXTURE_BINDING_CUBE_MAP; break;
+         default:                  binding = GL_TEXTURE_BINDING_2D;       break;
+      }
+   }
+   else
+   {
+      switch ( target )
+      {
+         case GL_ELEMENT_ARRAY_BUFFER:      binding = GL_ELEMENT_ARRAY_BUFFER_BINDING;      break;
+         case GL_UNIFORM_BUFFER:            binding = GL_UNIFORM_BUFFER_BINDING;            break;
+         case GL_PIXEL_PACK_BUFFER:         binding = GL_PIXEL_PACK_BUFFER_BINDING;         break;
+         case GL_PIXEL_UNPACK_BUFFER:       binding = GL_PIXEL_UNPACK_BUFFER_BINDING;       break;
+         case GL_COPY_READ_BUFFER:          binding = GL_COPY_READ_BUFFER_BINDING;          break;
+         case GL_COPY_WRITE_BUFFER:         binding = GL_COPY_WRITE_BUFFER_BINDING;         break;
+         case GL_TRANSFORM_FEEDBACK_BUFFER: binding = GL_TRANSFORM_FEEDBACK_BUFFER_BINDING; break;
+         default:                           binding = GL_ARRAY_BUFFER_BINDING;              break;
+      }
+   }
+
+   glGetIntegerv ( binding, &object );
+
+   return ( GLuint ) object;
+}
+
+///
+// TexelSize()
+//
+//    Bytes per texel of an internal format.  RGB formats are assumed to be
+//    padded to four components, as most implementations store them.
+//    Compressed formats are not handled and count as 0.
+//
+static GLuint TexelSize ( GLenum internalformat, GLenum format, GLenum type )
+{
+   GLuint size;
+
+   switch ( internalformat )
+   {
+      case GL_R8: case GL_R8I: case GL_R8UI: case GL_R8_SNORM: case GL_STENCIL_INDEX8:
+         return 1;
+
+      case GL_RG8: case GL_RG8I: case GL_RG8UI: case GL_RG8_SNORM: case GL_R16F: case GL_R16I:
+      case GL_R16UI: case GL_RGB565: case GL_RGBA4: case GL_RGB5_A1: case GL_DEPTH_COMPONENT16:
+         return 2;
+
+      case GL_RGB8: case GL_SRGB8: case GL_RGB8_SNORM: case GL_RGB8I: case GL_RGB8UI:
+      case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RGBA8_SNORM: case GL_RGBA8I: case GL_RGBA8UI:
+      case GL_RGB10_A2: case GL_RGB10_A2UI: case GL_R11F_G11F_B10F: case GL_RGB9_E5:
+      case GL_RG16F: case GL_RG16I: case GL_RG16UI: case GL_R32F: case GL_R32I: case GL_R32UI:
+      case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8:
+         return 4;
+
+      case GL_RGB16F: case GL_RGB16I: case GL_RGB16UI: case GL_RGBA16F: case GL_RGBA16I:
+      case GL_RGBA16UI: case GL_RG32F: case GL_RG32I: case GL_RG32UI: case GL_DEPTH32F_STENCIL8:
+         return 8;
+
+      case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI: case GL_RGBA32F: case GL_RGBA32I:
+      case GL_RGBA32UI:
+         return 16;
+
+      default:
+         break;
+   }
+
+   // Unsized formats take their size from the client data
+   size = esPixelSize ( format, type );
+
+   return size == 3 ? 4 : size;
+}
+
+///
+// RecordTexture()
+//
+static void RecordTexture ( const char *label, GLenum target, GLint level, GLenum internalformat,
+                            GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type )
+{
+   MemoryEntry entry;
+
+   memset ( &entry, 0, sizeof ( entry ) );
+   entry.category = ES_MEMORY_TEXTURE;
+   entry.bindTarget = target;
+
+   if ( target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z )
+   {
+      entry.bindTarget = GL_TEXTURE_CUBE_MAP;
+      entry.face = target - GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+   }
+
+   entry.object = BoundObject ( ES_MEMORY_TEXTURE, entry.bindTarget );
+   entry.level = level;
+   entry.width = width;
+   entry.height = height;
+   entry.depth = depth;
+   entry.texelSize = TexelSize ( internalformat, format, type );
+   entry.label = label;
+   entry.bytes = ( GLuint64 ) width * height * depth * entry.texelSize;
+
+   Record ( &entry );
+}
+
+///
+// RecordTextureStorage()
+//
+//    Immutable storage of every level, and of every face of a cube map
+//
+static void RecordTextureStorage ( const char *label, GLenum target, GLsizei levels, GLenum internalformat,
+                                   GLsizei width, GLsizei height, GLsizei depth )
+{
+   MemoryEntry entry;
+   GLsizei level;
+
+   memset ( &entry, 0, sizeof ( entry ) );
+   entry.category = ES_MEMORY_TEXTURE;
+   entry.object = BoundObject ( ES_MEMORY_TEXTURE, target );
+   entry.level = -1;
+   entry.bindTarget = target;
+   entry.width = width;
+   entry.height = height;
+   entry.depth = depth;
+   entry.texelSize = TexelSize ( internalformat, GL_NONE, GL_NONE );
+   entry.label = label;
+
+   for ( level = 0; level < levels; level++ )
+   {
+      GLuint64 w = width >> level > 0 ? width >> level : 1;
+      GLuint64 h = height >> level > 0 ? height >> level : 1;
+      GLuint64 d = depth;
+
+      // Only 3D textures have mip levels in depth
+      if ( target == GL_TEXTURE_3D )
+      {
+         d = depth >> level > 0 ? depth >> level : 1;
+      }
+
+      entry.bytes += w * h * d * entry.texelSize;
+   }
+
+   if ( target == GL_TEXTURE_CUBE_MAP )
+   {
+      entry.bytes *= 6;
+   }
+
+   Record ( &entry );
+}
+
+///
+// RecordRenderbuffer()
+//
+static void RecordRenderbuffer ( const char *label, GLenum target, GLsizei samples, GLenum internalformat,
+                                 GLsizei width, GLsizei height )
+{
+   MemoryEntry entry;
+
+   memset ( &entry, 0, sizeof ( entry ) );
+   entry.category = ES_MEMORY_RENDERBUFFER;
+   entry.object = BoundObject ( ES_MEMORY_RENDERBUFFER, target );
+   entry.width = width;
+   entry.height = height;
+   entry.depth = 1;
+   entry.texelSize = TexelSize ( internalformat, GL_NONE, GL_NONE );
+   entry.label = label;
+   entry.bytes = ( GLuint64 ) width * height * entry.texelSize * ( samples > 1 ? samples : 1 );
+
+   Record ( &entry );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esMemBufferData()
+//
+void ESUTIL_API esMemBufferData ( const char *label, GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+   MemoryEntry entry;
+
+   memset ( &entry, 0, sizeof ( entry ) );
+   entry.category = ES_MEMORY_BUFFER;
+   entry.object = BoundObject ( ES_MEMORY_BUFFER, target );
+   entry.label = label;
+   entry.bytes = ( GLuint64 ) size;
+   Record ( &entry );
+
+   glBufferData ( target, size, data, usage );
+}
+
+///
+// esMemTexImage2D()
+//
+void ESUTIL_API esMemTexImage2D ( const char *label, GLenum target, GLint level, GLint internalformat,
+                                  GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type,
+                                  const void *pixels )
+{
+   RecordTexture ( label, target, level, internalformat, width, height, 1, format, type );
+   glTexImage2D ( target, level, internalformat, width, height, border, format, type, pixels );
+}
+
+///
+// esMemTexImage3D()
+//
+void ESUTIL_API esMemTexImage3D ( const char *label, GLenum target, GLint level, GLint internalformat,
+                                  GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format,
+                                  GLenum type, const void *pixels )
+{
+   RecordTexture ( label, target, level, internalformat, width, height, depth, format, type );
+   glTexImage3D ( target, level, internalformat, width, height, depth, border, format, type, pixels );
+}
+
+///
+// esMemTexStorage2D()
+//
+void ESUTIL_API esMemTexStorage2D ( const char *label, GLenum target, GLsizei levels, GLenum internalformat,
+                                    GLsizei width, GLsizei height )
+{
+   RecordTextureStorage ( label, target, levels, internalformat, width, height, 1 );
+   glTexStorage2D ( target, levels, internalformat, width, height );
+}
+
+///
+// esMemTexStorage3D()
+//
+void ESUTIL_API esMemTexStorage3D ( const char *label, GLenum target, GLsizei levels, GLenum internalformat,
+                                    GLsizei width, GLsizei height, GLsizei depth )
+{
+   RecordTextureStorage ( label, target, levels, internalformat, width, height, depth );
+   glTexStorage3D ( target, levels, internalformat, width, height, depth );
+}
+
+///
+// esMemRenderbufferStorage()
+//
+void ESUTIL_API esMemRenderbufferStorage ( const char *label, GLenum target, GLenum internalformat,
+                                           GLsizei width, GLsizei height )
+{
+   RecordRenderbuffer ( label, target, 1, internalformat, width, height );
+   glRenderbufferStorage ( target, internalformat, width, height );
+}
+
+///
+// esMemRenderbufferStorageMultisample()
+//
+void ESUTIL_API esMemRenderbufferStorageMultisample ( const char *label, GLenum target, GLsizei samples,
+                                                      GLenum internalformat, GLsizei width, GLsizei height )
+{
+   RecordRenderbuffer ( label, target, samples, internalformat, width, height );
+   glRenderbufferStorageMultisample ( target, samples, internalformat, width, height );
+}
+
+///
+// esMemGenerateMipmap()
+//
+void ESUTIL_API esMemGenerateMipmap ( GLenum target )
+{
+   GLuint object = BoundObject ( ES_MEMORY_TEXTURE, target );
+   int count = s_entryCount;
+   int i;
+
+   // Add the levels below each recorded base level, one per cube map face
+   for ( i = 0; i < count; i++ )
+   {
+      MemoryEntry entry = s_entries[i];
+      GLint level = 0;
+
+      if ( entry.category != ES_MEMORY_TEXTURE || entry.object != object || entry.level != 0 )
+      {
+         continue;
+      }
+
+      while ( entry.width > 1 || entry.height > 1 || ( target == GL_TEXTURE_3D && entry.depth > 1 ) )
+      {
+         entry.level = ++level;
+         entry.width = entry.width > 1 ? entry.width / 2 : 1;
+         entry.height = entry.height > 1 ? entry.height / 2 : 1;
+
+         if ( target == GL_TEXTURE_3D )
+         {
+            entry.depth = entry.depth > 1 ? entry.depth / 2 : 1;
+         }
+
+         entry.bytes = ( GLuint64 ) entry.width * entry.height * entry.depth * entry.texelSize;
+         Record ( &entry );
+      }
+   }
+
+   glGenerateMipmap ( target );
+}
+
+///
+// esMemDeleteBuffers()
+//
+void ESUTIL_API esMemDeleteBuffers ( GLsizei n, const GLuint *buffers )
+{
+   Release ( ES_MEMORY_BUFFER, n, buffers );
+   esStateDeleteBuffers ( n, buffers );
+   glDeleteBuffers ( n, buffers );
+}
+
+///
+// esMemDeleteTextures()
+//
+void ESUTIL_API esMemDeleteTextures ( GLsizei n, const GLuint *textures )
+{
+   Release ( ES_MEMORY_TEXTURE, n, textures );
+   esStateDeleteTextures ( n, textures );
+   glDeleteTextures ( n, textures );
+}
+
+///
+// esMemDeleteRenderbuffers()
+//
+void ESUTIL_API esMemDeleteRenderbuffers ( GLsizei n, const GLuint *renderbuffers )
+{
+   Release ( ES_MEMORY_RENDERBUFFER, n, renderbuffers );
+   glDeleteRenderbuffers ( n, renderbuffers );
+}
+
+///
+// esGetGpuMemory()
+//
+void ESUTIL_API esGetGpuMemory ( int category, GLuint64 *current, GLuint64 *peak )
+{
+   if ( category < 0 || category > ES_MEMORY_CATEGORIES )
+   {
+      category = ES_MEMORY_CATEGORIES;
+   }
+
+   if ( current != NULL )
+   {
+      *current = s_current[category];
+   }
+
+   if ( peak != NULL )
+   {
+      *peak = s_peak[category];
+   }
+}
+
+///
+// esGpuMemoryReport()
+//
+void ESUTIL_API esGpuMemoryReport ( void )
+{
+   static const char *names[ES_MEMORY_CATEGORIES] = { "buffers", "textures", "renderbuffers" };
+   int category;
+   int i;
+
+   esLogMessage ( "GPU memory: %.1f KB (peak %.1f KB)\n", s_current[ES_MEMORY_CATEGORIES] / 1024.0,
+                  s_peak[ES_MEMORY_CATEGORIES] / 1024.0 );
+
+   for ( category = 0; category < ES_MEMORY_CATEGORIES; category++ )
+   {
+      if ( s_peak[category] == 0 )
+      {
+         continue;
+      }
+
+      esLogMessage ( "  %-30s %10.1f KB (peak %.1f KB)\n", names[category], s_current[category] / 1024.0,
+                     s_peak[category] / 1024.0 );
+
+      for ( i = 0; i < s_labelCount; i++ )
+      {
+         if ( s_labels[i].category == category )
+         {
+            esLogMessage ( "    %-28s %10.1f KB (peak %.1f KB)\n", s_labels[i].label,
+                           s_labels[i].current / 1024.0, s_labels[i].peak / 1024.0 );
+         }
+      }
+   }
+}
+
+///
+// esPixelSize()
+//
+GLuint ESUTIL_API esPixelSize ( GLenum format, GLenum type )
+{
+   GLuint components;
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_SHORT_5_6_5:
+      case GL_UNSIGNED_SHORT_4_4_4_4:
+      case GL_UNSIGNED_SHORT_5_5_5_1:
+         return 2;
+      case GL_UNSIGNED_INT_2_10_10_10_REV:
+      case GL_UNSIGNED_INT_10F_11F_11F_REV:
+      case GL_UNSIGNED_INT_5_9_9_9_REV:
+      case GL_UNSIGNED_INT_24_8:
+         return 4;
+      case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+         return 8;
+      default:
+         break;
+   }
+
+   switch ( format )
+   {
+      case GL_RG:
+      case GL_RG_INTEGER:
+      case GL_LUMINANCE_ALPHA:
+         components = 2;
+         break;
+      case GL_RGB:
+      case GL_RGB_INTEGER:
+         components = 3;
+         break;
+      case GL_RGBA:
+      case GL_RGBA_INTEGER:
+         components = 4;
+         break;
+      default:
+         components = 1;
+         break;
+   }
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_SHORT:
+      case GL_SHORT:
+      case GL_HALF_FLOAT:
+         return components * 2;
+      case GL_UNSIGNED_INT:
+      case GL_INT:
+      case GL_FLOAT:
+         return components * 4;
+      default:
+         return components;
+   }
+}
@@ -0,0 +1,510 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESGpuTimer.c
+//
+//    Pass-level GPU timing.  Passes are timed with GL_EXT_disjoint_timer_query
+//    and the results are read back several frames later so the CPU never
+//    waits on the GPU.  Without the extension, each pass is bracketed by
+//    fences whose completion is polled and timestamped on the CPU.  Those
+//    times are estimates: a fence signalled at some point between the last
+//    poll that saw it pending and the first that saw it signalled, so each
+//    result is only as exact as the poll interval, which is reported with it.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef __APPLE__
+#include <GLES2/gl2ext.h>
+#endif
+
+///
+//  Macros
+//
+#define GPU_TIMER_FRAMES          4
+#define GPU_TIMER_MAX_PASSES      16
+
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT       0x88BF
+#define GL_GPU_DISJOINT_EXT       0x8FBB
+#endif
+
+///
+//  Types
+//
+typedef void ( GL_APIENTRYP ESGetQueryObjectui64vProc ) ( GLuint id, GLenum pname, GLuint64 *params );
+
+typedef struct
+{
+   const char *name;
+
+   // Timer query path
+   GLuint      query;
+
+   // Fence fallback path: fences, the CPU time they were last seen pending
+   // and the CPU time they were first seen signalled
+   GLsync      beginFence;
+   GLsync      endFence;
+   double      beginPending;
+   double      endPending;
+   double      beginSignalled;
+   double      endSignalled;
+} GpuPass;
+
+typedef struct
+{
+   GpuPass     passes[GPU_TIMER_MAX_PASSES];
+   int         numPasses;
+} GpuFrame;
+
+typedef struct
+{
+   const char *name;
+   ESHistogram histogram;
+
+   // Fence fallback path: sum of the poll windows of the results
+   double      uncertainty;
+} GpuPassStats;
+
+///
+//  Module state
+//
+static int s_initialized = 0;
+static ESGetQueryObjectui64vProc s_getQueryObjectui64v = NULL;
+static GpuFrame s_frames[GPU_TIMER_FRAMES];
+static unsigned int s_frameIndex = 0;
+static unsigned int s_oldestFrame = 0;
+static GpuPass *s_activePass = NULL;
+static GpuPassStats s_stats[GPU_TIMER_MAX_PASSES];
+static int s_numStats = 0;
+static int s_droppedFrames = 0;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Initialize()
+//
+//    Pick the timer query path if the extension is exposed
+//
+static void Initialize ( void )
+{
+   const char *extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+   int i, j;
+
+   s_initialized = 1;
+
+#ifndef __APPLE__
+   if ( extensions != NULL && strstr ( extensions, "GL_EXT_disjoint_timer_query" ) != NULL )
+   {
+      s_getQueryObjectui64v = ( ESGetQueryObjectui64vProc ) eglGetProcAddress ( "glGetQueryObjectui64vEXT" );
+   }
+#endif
+
+   if ( s_getQueryObjectui64v != NULL )
+   {
+      for ( i = 0; i < GPU_TIMER_FRAMES; i++ )
+      {
+         for ( j = 0; j < GPU_TIMER_MAX_PASSES; j++ )
+         {
+            glGenQueries ( 1, &s_frames[i].passes[j].query );
+         }
+      }
+
+      // Clear any stale disjoint state
+      glGetIntegerv ( GL_GPU_DISJOINT_EXT, &i );
+   }
+}
+
+///
+// PollFence()
+//
+//    Record the CPU time a fence is first seen signalled, or else the time it
+//    was seen pending, without waiting
+//
+static void PollFence ( GLsync fence, double *pending, double *signalled )
+{
+   if ( fence != 0 && *signalled == 0.0 )
+   {
+      if ( glClientWaitSync ( fence, 0, 0 ) != GL_TIMEOUT_EXPIRED )
+      {
+         *signalled = esGetTime();
+      }
+      else
+      {
+         *pending = esGetTime();
+      }
+   }
+}
+
+///
+// PollFences()
+//
+static void PollFences ( void )
+{
+   unsigned int frame;
+   int i;
+
+   for ( frame = s_oldestFrame; frame != s_frameIndex + 1; frame++ )
+   {
+      GpuFrame *gpuFrame = &s_frames[frame % GPU_TIMER_FRAMES];
+
+      for ( i = 0; i < gpuFrame->numPasses; i++ )
+      {
+         GpuPass *pass = &gpuFrame->passes[i];
+
+         PollFence ( pass->beginFence, &pass->beginPending, &pass->beginSignalled );
+         PollFence ( pass->endFence, &pass->endPending, &pass->endSignalled );
+      }
+   }
+}
+
+///
+// AddResult()
+//
+//    Add a pass time and, for the fence fallback, how far either end of it
+//    may be off
+//
+static void AddResult ( const char *name, double seconds, double uncertainty )
+{
+   int i;
+
+   for ( i = 0; i < s_numStats; i++ )
+   {
+      if ( s_stats[i].name == name || strcmp ( s_stats[i].name, name ) == 0 )
+      {
+         break;
+      }
+   }
+
+   if ( i == s_numStats )
+   {
+      if ( s_numStats == GPU_TIMER_MAX_PASSES )
+      {
+         return;
+      }
+
+      s_stats[s_numStats++].name = name;
+   }
+
+   esHistogramAdd ( &s_stats[i].histogram, seconds );
+   s_stats[i].uncertainty += uncertainty;
+}
+
+///
+// ResetFrame()
+//
+static void ResetFrame ( GpuFrame *gpuFrame )
+{
+   int i;
+
+   for ( i = 0; i < gpuFrame->numPasses; i++ )
+   {
+      GpuPass *pass = &gpuFrame->passes[i];
+
+      if ( pass->beginFence != 0 )
+      {
+         glDeleteSync ( pass->beginFence );
+      }
+
+      if ( pass->endFence != 0 )
+      {
+         glDeleteSync ( pass->endFence );
+      }
+
+      pass->beginFence = pass->endFence = 0;
+      pass->beginPending = pass->endPending = 0.0;
+      pass->beginSignalled = pass->endSignalled = 0.0;
+   }
+
+   gpuFrame->numPasses = 0;
+}
+
+///
+// CollectFrame()
+//
+//    Read back the results of a frame if they are all available
+//
+static GLboolean CollectFrame ( GpuFrame *gpuFrame, GLboolean disjoint )
+{
+   int i;
+
+   if ( gpuFrame->numPasses == 0 )
+   {
+      return GL_TRUE;
+   }
+
+   if ( s_getQueryObjectui64v != NULL )
+   {
+      GLuint available = GL_FALSE;
+
+      // Queries complete in order, so the last one being ready means all are
+      glGetQueryObjectuiv ( gpuFrame->passes[gpuFrame->numPasses - 1].query,
+                            GL_QUERY_RESULT_AVAILABLE, &available );
+
+      if ( !available )
+      {
+         return GL_FALSE;
+      }
+
+      for ( i = 0; i < gpuFrame->numPasses && !disjoint; i++ )
+      {
+         GLuint64 elapsed = 0;
+
+         s_getQueryObjectui64v ( gpuFrame->passes[i].query, GL_QUERY_RESULT, &elapsed );
+         AddResult ( gpuFrame->passes[i].name, ( double ) elapsed * 1e-9, 0.0 );
+      }
+   }
+   else
+   {
+      if ( gpuFrame->passes[gpuFrame->numPasses - 1].endSignalled == 0.0 )
+      {
+         return GL_FALSE;
+      }
+
+      for ( i = 0; i < gpuFrame->numPasses; i++ )
+      {
+         GpuPass *pass = &gpuFrame->passes[i];
+
+         // The true time lies within the poll window of either end
+         if ( pass->beginSignalled != 0.0 && pass->endSignalled != 0.0 )
+         {
+            AddResult ( pass->name, pass->endSignalled - pass->beginSignalled,
+                        ( pass->beginSignalled - pass->beginPending ) +
+                        ( pass->endSignalled - pass->endPending ) );
+         }
+      }
+   }
+
+   ResetFrame ( gpuFrame );
+   return GL_TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esGpuTimerBegin()
+//
+void ESUTIL_API esGpuTimerBegin ( const char *name )
+{
+   GpuFrame *gpuFrame = &s_frames[s_frameIndex % GPU_TIMER_FRAMES];
+   GpuPass *pass;
+
+   if ( !s_initialized )
+   {
+      Initialize();
+   }
+
+   if ( s_activePass != NULL || gpuFrame->numPasses == GPU_TIMER_MAX_PASSES )
+   {
+      return;
+   }
+
+   pass = &gpuFrame->passes[gpuFrame->numPasses++];
+   pass->name = name;
+   s_activePass = pass;
+
+   if ( s_getQueryObjectui64v != NULL )
+   {
+      glBeginQuery ( GL_TIME_ELAPSED_EXT, pass->query );
+   }
+   else
+   {
+      PollFences();
+      pass->beginFence = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      pass->beginPending = esGetTime();
+   }
+}
+
+///
+//  esGpuTimerEnd()
+//
+void ESUTIL_API esGpuTimerEnd ( void )
+{
+   if ( s_activePass == NULL )
+   {
+      return;
+   }
+
+   if ( s_getQueryObjectui64v != NULL )
+   {
+      glEndQuery ( GL_TIME_ELAPSED_EXT );
+   }
+   else
+   {
+      s_activePass->endFence = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      s_activePass->endPending = esGetTime();
+      PollFences();
+   }
+
+   s_activePass = NULL;
+}
+
+///
+//  esGpuTimerFrame()
+//
+//      Collect finished frames and start recording a new one.  A frame
+//      whose results are still pending when its slot is needed is dropped.
+//
+void ESUTIL_API esGpuTimerFrame ( void )
+{
+   GLboolean disjoint = GL_FALSE;
+
+   if ( !s_initialized )
+   {
+      return;
+   }
+
+   if ( s_getQueryObjectui64v != NULL )
+   {
+      GLint disjointOccurred = 0;
+
+      glGetIntegerv ( GL_GPU_DISJOINT_EXT, &disjointOccurred );
+      disjoint = disjointOccurred ? GL_TRUE : GL_FALSE;
+   }
+   else
+   {
+      PollFences();
+   }
+
+   while ( s_oldestFrame != s_frameIndex + 1 &&
+           CollectFrame ( &s_frames[s_oldestFrame % GPU_TIMER_FRAMES], disjoint ) )
+   {
+      s_oldestFrame++;
+   }
+
+   s_frameIndex++;
+
+   if ( s_frameIndex - s_oldestFrame >= GPU_TIMER_FRAMES )
+   {
+      ResetFrame ( &s_frames[s_oldestFrame % GPU_TIMER_FRAMES] );
+      s_oldestFrame++;
+      s_droppedFrames++;
+   }
+}
+
+///
+//  esGpuTimerHistogram()
+//
+const ESHistogram *ESUTIL_API esGpuTimerHistogram ( const char *name )
+{
+   int i;
+
+   for ( i = 0; i < s_numStats; i++ )
+   {
+      if ( strcmp ( s_stats[i].name, name ) == 0 )
+      {
+         return &s_stats[i].histogram;
+      }
+   }
+
+   return NULL;
+}
+
+///
+//  esGpuTimerShutdown()
+//
+//      Print the pass times and release the GL objects
+//
+void ESUTIL_API esGpuTimerShutdown ( void )
+{
+   int i, j;
+
+   if ( !s_initialized )
+   {
+      return;
+   }
+
+   if ( s_numStats > 0 )
+   {
+      if ( s_getQueryObjectui64v != NULL )
+      {
+         esLogMessage ( "GPU pass times (GL_EXT_disjoint_timer_query), ms:\n" );
+      }
+      else
+      {
+         esLogMessage ( "GPU pass times (fence fallback, CPU-bounded estimates, "
+                        "poll window is the mean possible error), ms:\n" );
+      }
+
+      for ( i = 0; i < s_numStats; i++ )
+      {
+         const ESHistogram *histogram = &s_stats[i].histogram;
+         char window[32] = "";
+
+         if ( s_getQueryObjectui64v == NULL )
+         {
+            snprintf ( window, sizeof ( window ), "  poll window %.3f",
+                       s_stats[i].uncertainty / histogram->count * 1e3 );
+         }
+
+         esLogMessage ( "  %-16s count %u  mean %.3f  p50 %.3f  p95 %.3f  max %.3f%s\n",
+                        s_stats[i].name, histogram->count,
+                        histogram->total / histogram->count * 1e3,
+                        esHistogramPercentile ( histogram, 50.0 ) * 1e3,
+                        esHistogramPercentile ( histogram, 95.0 ) * 1e3,
+                        histogram->max * 1e3, window );
+      }
+
+      if ( s_droppedFrames > 0 )
+      {
+         esLogMessage ( "  %d frames dropped waiting for results\n", s_droppedFrames );
+      }
+   }
+
+   for ( i = 0; i < GPU_TIMER_FRAMES; i++ )
+   {
+      ResetFrame ( &s_frames[i] );
+
+      for ( j = 0; j < GPU_TIMER_MAX_PASSES; j++ )
+      {
+         if ( s_frames[i].passes[j].query != 0 )
+         {
+            glDeleteQueries ( 1, &s_frames[i].passes[j].query );
+            s_frames[i].passes[j].query = 0;
+         }
+      }
+   }
+
+   s_initialized = 0;
+}
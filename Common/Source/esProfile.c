@@ -0,0 +1,268 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESProfile.c
+//
+//    Fixed-bucket CPU time histograms for the main loop phases.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+///
+//  Macros
+//
+#define BUCKETS_PER_OCTAVE   4
+
+static const char *phaseNames[ES_PHASE_COUNT] =
+{
+   "update",
+   "draw",
+   "swap",
+   "frame"
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BucketLowerBound()
+//
+//    Lower bound of a histogram bucket in seconds
+//
+static double BucketLowerBound ( int bucket )
+{
+   return pow ( 2.0, ( double ) bucket / BUCKETS_PER_OCTAVE ) * 1e-6;
+}
+
+///
+// HasSuffix()
+//
+static int HasSuffix ( const char *str, const char *suffix )
+{
+   size_t strLen = strlen ( str );
+   size_t suffixLen = strlen ( suffix );
+
+   return strLen >= suffixLen && strcmp ( str + strLen - suffixLen, suffix ) == 0;
+}
+
+///
+// WriteCSV()
+//
+static void WriteCSV ( FILE *fp, ESContext *esContext )
+{
+   int phase, bucket;
+
+   fprintf ( fp, "phase,lower_us,upper_us,count\n" );
+
+   for ( phase = 0; phase < ES_PHASE_COUNT; phase++ )
+   {
+      const ESHistogram *histogram = &esContext->phaseHistograms[phase];
+
+      for ( bucket = 0; bucket < ES_HISTOGRAM_BUCKETS; bucket++ )
+      {
+         fprintf ( fp, "%s,%.3f,%.3f,%u\n", phaseNames[phase],
+                   bucket == 0 ? 0.0 : BucketLowerBound ( bucket ) * 1e6,
+                   BucketLowerBound ( bucket + 1 ) * 1e6,
+                   histogram->buckets[bucket] );
+      }
+   }
+}
+
+///
+// WriteJSON()
+//
+static void WriteJSON ( FILE *fp, ESContext *esContext )
+{
+   int phase, bucket;
+
+   fprintf ( fp, "{\n  \"bucketUpperBoundsUs\": [" );
+
+   for ( bucket = 0; bucket < ES_HISTOGRAM_BUCKETS; bucket++ )
+   {
+      fprintf ( fp, "%s%.3f", bucket ? ", " : "", BucketLowerBound ( bucket + 1 ) * 1e6 );
+   }
+
+   fprintf ( fp, "],\n  \"phases\": {\n" );
+
+   for ( phase = 0; phase < ES_PHASE_COUNT; phase++ )
+   {
+      const ESHistogram *histogram = &esContext->phaseHistograms[phase];
+
+      fprintf ( fp, "    \"%s\": { \"count\": %u, \"meanMs\": %.4f, \"minMs\": %.4f, \"maxMs\": %.4f, "
+                "\"p50Ms\": %.4f, \"p95Ms\": %.4f, \"p99Ms\": %.4f,\n      \"buckets\": [",
+                phaseNames[phase], histogram->count,
+                histogram->count ? histogram->total / histogram->count * 1e3 : 0.0,
+                histogram->min * 1e3, histogram->max * 1e3,
+                esHistogramPercentile ( histogram, 50.0 ) * 1e3,
+                esHistogramPercentile ( histogram, 95.0 ) * 1e3,
+                esHistogramPercentile ( histogram, 99.0 ) * 1e3 );
+
+      for ( bucket = 0; bucket < ES_HISTOGRAM_BUCKETS; bucket++ )
+      {
+         fprintf ( fp, "%s%u", bucket ? ", " : "", histogram->buckets[bucket] );
+      }
+
+      fprintf ( fp, "] }%s\n", phase < ES_PHASE_COUNT - 1 ? "," : "" );
+   }
+
+   fprintf ( fp, "  }\n}\n" );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esHistogramAdd()
+//
+void ESUTIL_API esHistogramAdd ( ESHistogram *histogram, double seconds )
+{
+   int bucket = 0;
+   double us = seconds * 1e6;
+
+   if ( us > 1.0 )
+   {
+      bucket = ( int ) ( log2 ( us ) * BUCKETS_PER_OCTAVE );
+
+      if ( bucket >= ES_HISTOGRAM_BUCKETS )
+      {
+         bucket = ES_HISTOGRAM_BUCKETS - 1;
+      }
+   }
+
+   if ( histogram->count == 0 || seconds < histogram->min )
+   {
+      histogram->min = seconds;
+   }
+
+   if ( seconds > histogram->max )
+   {
+      histogram->max = seconds;
+   }
+
+   histogram->count++;
+   histogram->total += seconds;
+   histogram->buckets[bucket]++;
+}
+
+///
+//  esHistogramPercentile()
+//
+double ESUTIL_API esHistogramPercentile ( const ESHistogram *histogram, double percent )
+{
+   GLuint rank;
+   GLuint cumulative = 0;
+   int bucket;
+
+   if ( histogram->count == 0 )
+   {
+      return 0.0;
+   }
+
+   rank = ( GLuint ) ceil ( percent / 100.0 * histogram->count );
+
+   if ( rank < 1 )
+   {
+      rank = 1;
+   }
+
+   for ( bucket = 0; bucket < ES_HISTOGRAM_BUCKETS; bucket++ )
+   {
+      cumulative += histogram->buckets[bucket];
+
+      if ( cumulative >= rank )
+      {
+         double upper = BucketLowerBound ( bucket + 1 );
+         return upper < histogram->max ? upper : histogram->max;
+      }
+   }
+
+   return histogram->max;
+}
+
+///
+//  esGetPhaseHistogram()
+//
+const ESHistogram *ESUTIL_API esGetPhaseHistogram ( ESContext *esContext, int phase )
+{
+   if ( phase < 0 || phase >= ES_PHASE_COUNT )
+   {
+      return NULL;
+   }
+
+   return &esContext->phaseHistograms[phase];
+}
+
+///
+//  esProfileInit()
+//
+void ESUTIL_API esProfileInit ( ESContext *esContext, int argc, char *argv[] )
+{
+   memset ( esContext->phaseHistograms, 0, sizeof ( esContext->phaseHistograms ) );
+   esContext->phaseHistogramFile = esGetOption ( argc, argv, "--phase-histograms", "ES_PHASE_HISTOGRAMS" );
+}
+
+///
+//  esDumpPhaseHistograms()
+//
+GLboolean ESUTIL_API esDumpPhaseHistograms ( ESContext *esContext, const char *fileName )
+{
+   FILE *fp = fopen ( fileName, "w" );
+
+   if ( fp == NULL )
+   {
+      esLogMessage ( "esDumpPhaseHistograms FAILED to open : { %s }\n", fileName );
+      return GL_FALSE;
+   }
+
+   if ( HasSuffix ( fileName, ".csv" ) )
+   {
+      WriteCSV ( fp, esContext );
+   }
+   else
+   {
+      WriteJSON ( fp, esContext );
+   }
+
+   fclose ( fp );
+   return GL_TRUE;
+}
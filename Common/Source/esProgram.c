@@ -0,0 +1,347 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESProgram.c
+//
+//    Program reflection.  The active uniforms, attributes and uniform
+//    blocks of a program are enumerated once into open-addressed tables
+//    keyed by name hash, so lookups never go back to the driver.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// HashName()
+//
+//    32-bit FNV-1a hash of the first length characters of name in the low
+//    bits, and the unrelated 32-bit sdbm hash in the high bits.  The table
+//    is indexed by the first, and a hit must match both.
+//
+static GLuint64 HashName ( const char *name, size_t length )
+{
+   GLuint hash = 0x811c9dc5;
+   GLuint check = 0;
+   size_t i;
+
+   for ( i = 0; i < length; i++ )
+   {
+      hash ^= ( unsigned char ) name[i];
+      hash *= 0x01000193;
+      check = ( unsigned char ) name[i] + ( check << 6 ) + ( check << 16 ) - check;
+   }
+
+   return ( ( GLuint64 ) check << 32 ) | hash;
+}
+
+///
+// InitTable()
+//
+//    Size a table for up to count entries at a load factor of at most 1/2
+//
+static GLboolean InitTable ( ESProgramTable *table, GLint count )
+{
+   GLuint capacity = 1;
+
+   while ( capacity < ( GLuint ) count * 2 )
+   {
+      capacity *= 2;
+   }
+
+   table->entries = calloc ( capacity, sizeof ( ESProgramVariable ) );
+   table->mask = capacity - 1;
+   table->count = 0;
+
+   return table->entries != NULL ? GL_TRUE : GL_FALSE;
+}
+
+///
+// FindSlot()
+//
+//    Return the entry holding nameHash, or the empty slot it would go in.
+//    Empty slots have a size of 0, active variables a size of at least 1.
+//
+static ESProgramVariable *FindSlot ( const ESProgramTable *table, GLuint64 nameHash )
+{
+   GLuint i = ( GLuint ) nameHash & table->mask;
+
+   while ( table->entries[i].size != 0 && table->entries[i].nameHash != nameHash )
+   {
+      i = ( i + 1 ) & table->mask;
+   }
+
+   return &table->entries[i];
+}
+
+///
+// Insert()
+//
+static void Insert ( ESProgramTable *table, const char *name, size_t length,
+                     GLint location, GLenum type, GLint size )
+{
+   GLuint64 nameHash = HashName ( name, length );
+   ESProgramVariable *entry = FindSlot ( table, nameHash );
+
+   if ( entry->size != 0 )
+   {
+      esLogMessage ( "esProgramReflect: hash collision on %.*s, lookups return the first variable\n",
+                     ( int ) length, name );
+      return;
+   }
+
+   entry->nameHash = nameHash;
+   entry->location = location;
+   entry->type = type;
+   entry->size = size > 0 ? size : 1;
+   table->count++;
+}
+
+///
+// ArrayBaseLength()
+//
+//    Arrays are reported as "name[0]"; register them under "name"
+//
+static size_t ArrayBaseLength ( const char *name, size_t length )
+{
+   if ( length > 3 && strcmp ( name + length - 3, "[0]" ) == 0 )
+   {
+      return length - 3;
+   }
+
+   return length;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esHashName()
+//
+GLuint64 ESUTIL_API esHashName ( const char *name )
+{
+   return HashName ( name, strlen ( name ) );
+}
+
+///
+//  esProgramReflect()
+//
+//      Enumerate the active variables of a linked program
+//
+GLboolean ESUTIL_API esProgramReflect ( ESProgram *program, GLuint programObject )
+{
+   GLint numUniforms = 0, numAttributes = 0, numBlocks = 0;
+   GLint maxUniformLength = 0, maxAttributeLength = 0, maxBlockLength = 0;
+   GLint maxLength;
+   char *name;
+   GLint i;
+
+   memset ( program, 0, sizeof ( ESProgram ) );
+
+   if ( programObject == 0 )
+   {
+      return GL_FALSE;
+   }
+
+   glGetProgramiv ( programObject, GL_ACTIVE_UNIFORMS, &numUniforms );
+   glGetProgramiv ( programObject, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformLength );
+   glGetProgramiv ( programObject, GL_ACTIVE_ATTRIBUTES, &numAttributes );
+   glGetProgramiv ( programObject, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeLength );
+   glGetProgramiv ( programObject, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks );
+   glGetProgramiv ( programObject, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockLength );
+
+   maxLength = maxUniformLength;
+   maxLength = maxAttributeLength > maxLength ? maxAttributeLength : maxLength;
+   maxLength = maxBlockLength > maxLength ? maxBlockLength : maxLength;
+
+   name = malloc ( maxLength + 1 );
+
+   if ( name == NULL ||
+         !InitTable ( &program->uniforms, numUniforms ) ||
+         !InitTable ( &program->attributes, numAttributes ) ||
+         !InitTable ( &program->uniformBlocks, numBlocks ) )
+   {
+      free ( name );
+      esProgramFree ( program );
+      return GL_FALSE;
+   }
+
+   program->programObject = programObject;
+
+   for ( i = 0; i < numUniforms; i++ )
+   {
+      GLsizei length = 0;
+      GLint size;
+      GLenum type;
+      GLint location;
+
+      glGetActiveUniform ( programObject, i, maxLength + 1, &length, &size, &type, name );
+      location = glGetUniformLocation ( programObject, name );
+
+      // Uniforms in named blocks have no location, they are set through the block
+      if ( location >= 0 )
+      {
+         Insert ( &program->uniforms, name, ArrayBaseLength ( name, length ), location, type, size );
+      }
+   }
+
+   for ( i = 0; i < numAttributes; i++ )
+   {
+      GLsizei length = 0;
+      GLint size;
+      GLenum type;
+      GLint location;
+
+      glGetActiveAttrib ( programObject, i, maxLength + 1, &length, &size, &type, name );
+      location = glGetAttribLocation ( programObject, name );
+
+      // Built-ins such as gl_VertexID have no location
+      if ( location >= 0 )
+      {
+         Insert ( &program->attributes, name, ArrayBaseLength ( name, length ), location, type, size );
+      }
+   }
+
+   for ( i = 0; i < numBlocks; i++ )
+   {
+      GLsizei length = 0;
+      GLint dataSize = 0;
+
+      glGetActiveUniformBlockName ( programObject, i, maxLength + 1, &length, name );
+      glGetActiveUniformBlockiv ( programObject, i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize );
+      Insert ( &program->uniformBlocks, name, length, i, GL_NONE, dataSize );
+   }
+
+   free ( name );
+   return GL_TRUE;
+}
+
+///
+//  esLoadProgramReflected()
+//
+GLboolean ESUTIL_API esLoadProgramReflected ( ESProgram *program, const char *vertShaderSrc, const char *fragShaderSrc )
+{
+   GLuint programObject = esLoadProgram ( vertShaderSrc, fragShaderSrc );
+
+   if ( !esProgramReflect ( program, programObject ) )
+   {
+      if ( programObject != 0 )
+      {
+         glDeleteProgram ( programObject );
+      }
+
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+//  esProgramFree()
+//
+void ESUTIL_API esProgramFree ( ESProgram *program )
+{
+   free ( program->uniforms.entries );
+   free ( program->attributes.entries );
+   free ( program->uniformBlocks.entries );
+   memset ( program, 0, sizeof ( ESProgram ) );
+}
+
+///
+//  esDeleteProgram()
+//
+void ESUTIL_API esDeleteProgram ( ESProgram *program )
+{
+   if ( program->programObject != 0 )
+   {
+      glDeleteProgram ( program->programObject );
+   }
+
+   esProgramFree ( program );
+}
+
+///
+//  esProgramFindVariable()
+//
+const ESProgramVariable *ESUTIL_API esProgramFindVariable ( const ESProgramTable *table, GLuint64 nameHash )
+{
+   const ESProgramVariable *entry;
+
+   if ( table->entries == NULL )
+   {
+      return NULL;
+   }
+
+   entry = FindSlot ( table, nameHash );
+   return entry->size != 0 ? entry : NULL;
+}
+
+///
+//  esProgramUniformLocation()
+//
+GLint ESUTIL_API esProgramUniformLocation ( const ESProgram *program, GLuint64 nameHash )
+{
+   const ESProgramVariable *entry = esProgramFindVariable ( &program->uniforms, nameHash );
+
+   return entry != NULL ? entry->location : -1;
+}
+
+///
+//  esProgramAttribLocation()
+//
+GLint ESUTIL_API esProgramAttribLocation ( const ESProgram *program, GLuint64 nameHash )
+{
+   const ESProgramVariable *entry = esProgramFindVariable ( &program->attributes, nameHash );
+
+   return entry != NULL ? entry->location : -1;
+}
+
+///
+//  esProgramUniformBlockIndex()
+//
+GLint ESUTIL_API esProgramUniformBlockIndex ( const ESProgram *program, GLuint64 nameHash )
+{
+   const ESProgramVariable *entry = esProgramFindVariable ( &program->uniformBlocks, nameHash );
+
+   return entry != NULL ? entry->location : -1;
+}
@@ -0,0 +1,489 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESRenderThread.c
+//
+//    Optional render thread.  The main thread runs the update callback,
+//    which fills a frame packet; the render thread owns the GL context and
+//    draws and presents the packets.  Two packets alternate so the update
+//    of frame N+1 overlaps the draw and swap of frame N.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define ES_RENDER_THREAD_SUPPORTED
+#elif !defined(__APPLE__)
+#include <pthread.h>
+#define ES_RENDER_THREAD_SUPPORTED
+#endif
+
+#ifdef ES_RENDER_THREAD_SUPPORTED
+
+///
+//  Types
+//
+typedef struct
+{
+#ifdef _WIN32
+   HANDLE             thread;
+   DWORD              threadId;
+   CRITICAL_SECTION   lock;
+   CONDITION_VARIABLE cond;
+#else
+   pthread_t          thread;
+   pthread_mutex_t    lock;
+   pthread_cond_t     cond;
+#endif
+
+   ESContext         *esContext;
+
+   // Frames submitted by the main thread and frames presented by the render
+   // thread.  Frame n uses packet n % 2.
+   unsigned int       submitted;
+   unsigned int       presented;
+
+   // The update packet has not been seeded from the previous frame yet
+   GLboolean          seedPacket;
+   GLboolean          quit;
+
+   // esRequestRedraw() was called by the draw callback
+   GLboolean          redrawPending;
+} RenderThread;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+#ifdef _WIN32
+#define LOCK(rt)        EnterCriticalSection ( &( rt )->lock )
+#define UNLOCK(rt)      LeaveCriticalSection ( &( rt )->lock )
+#define WAIT(rt)        SleepConditionVariableCS ( &( rt )->cond, &( rt )->lock, INFINITE )
+#define BROADCAST(rt)   WakeAllConditionVariable ( &( rt )->cond )
+#else
+#define LOCK(rt)        pthread_mutex_lock ( &( rt )->lock )
+#define UNLOCK(rt)      pthread_mutex_unlock ( &( rt )->lock )
+#define WAIT(rt)        pthread_cond_wait ( &( rt )->cond, &( rt )->lock )
+#define BROADCAST(rt)   pthread_cond_broadcast ( &( rt )->cond )
+#endif
+
+///
+// RenderFrame()
+//
+//    Draw and present one frame on the render thread
+//
+static void RenderFrame ( ESContext *esContext )
+{
+   double drawStart = esGetTime();
+   double drawEnd;
+   double swapStart;
+   double swapEnd;
+
+   esTraceBegin ( "Draw" );
+   esContext->drawFunc ( esContext );
+   esTraceEnd ( );
+   drawEnd = esGetTime();
+
+   // The readback is traced on its own and kept out of the draw and swap phases
+   esCaptureFrame ( esContext );
+   swapStart = esGetTime();
+
+   esTraceBegin ( "eglSwapBuffers" );
+   eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+   esTraceEnd ( );
+   swapEnd = esGetTime();
+
+   esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_DRAW], drawEnd - drawStart );
+   esHistogramAdd ( &esContext->phaseHistograms[ES_PHASE_SWAP], swapEnd - swapStart );
+
+   // Per frame bookkeeping, kept out of the swap phase
+   esGpuTimerFrame ( );
+   esStateFrame ( );
+   esGLCountersFrame ( );
+   esFramePacingFrame ( esContext );
+}
+
+///
+// RenderThreadMain()
+//
+#ifdef _WIN32
+static DWORD WINAPI RenderThreadMain ( LPVOID arg )
+#else
+static void *RenderThreadMain ( void *arg )
+#endif
+{
+   RenderThread *rt = ( RenderThread * ) arg;
+   ESContext *esContext = rt->esContext;
+
+   eglMakeCurrent ( esContext->eglDisplay, esContext->eglSurface,
+                    esContext->eglSurface, esContext->eglContext );
+
+   for ( ;; )
+   {
+      unsigned int frame;
+
+      LOCK ( rt );
+
+      while ( rt->presented == rt->submitted && !rt->quit )
+      {
+         WAIT ( rt );
+      }
+
+      if ( rt->presented == rt->submitted )
+      {
+         UNLOCK ( rt );
+         break;
+      }
+
+      frame = rt->presented;
+      UNLOCK ( rt );
+
+      esTraceBegin ( "Render" );
+      esContext->drawPacket = esContext->framePackets[frame % 2];
+
+      if ( esContext->drawFunc != NULL )
+      {
+         RenderFrame ( esContext );
+      }
+
+      esTraceEnd ( );
+
+      LOCK ( rt );
+      rt->presented++;
+      BROADCAST ( rt );
+      UNLOCK ( rt );
+   }
+
+   // Hand the context back to the main thread for shutdown
+   eglMakeCurrent ( esContext->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+
+   return 0;
+}
+
+#endif // ES_RENDER_THREAD_SUPPORTED
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esRegisterFramePacket()
+//
+GLboolean ESUTIL_API esRegisterFramePacket ( ESContext *esContext, GLsizei size )
+{
+   char *packets;
+
+   if ( size <= 0 || esContext->framePackets[0] != NULL )
+   {
+      return GL_FALSE;
+   }
+
+   packets = calloc ( 2, size );
+
+   if ( packets == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   esContext->framePacketSize = size;
+   esContext->framePackets[0] = packets;
+   esContext->framePackets[1] = packets + size;
+
+   // Without a render thread update and draw share the first packet
+   esContext->updatePacket = esContext->framePackets[0];
+   esContext->drawPacket = esContext->framePackets[0];
+
+   return GL_TRUE;
+}
+
+///
+//  esGetUpdatePacket()
+//
+void *ESUTIL_API esGetUpdatePacket ( ESContext *esContext )
+{
+   return esContext->updatePacket;
+}
+
+///
+//  esGetDrawPacket()
+//
+const void *ESUTIL_API esGetDrawPacket ( ESContext *esContext )
+{
+   return esContext->drawPacket;
+}
+
+///
+//  esRenderThreadStart()
+//
+//      Move the GL context to a new render thread if the window was created
+//      with ES_WINDOW_RENDER_THREAD and the application registered a frame packet
+//
+GLboolean ESUTIL_API esRenderThreadStart ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt;
+
+   if ( !( esContext->flags & ES_WINDOW_RENDER_THREAD ) )
+   {
+      return GL_FALSE;
+   }
+
+   if ( esContext->framePacketSize == 0 )
+   {
+      esLogMessage ( "esRenderThreadStart: no frame packet registered, rendering on the main thread\n" );
+      return GL_FALSE;
+   }
+
+   rt = calloc ( 1, sizeof ( RenderThread ) );
+
+   if ( rt == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   rt->esContext = esContext;
+   rt->seedPacket = GL_FALSE;
+
+   // A context can only be current on one thread at a time
+   eglMakeCurrent ( esContext->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+
+#ifdef _WIN32
+   InitializeCriticalSection ( &rt->lock );
+   InitializeConditionVariable ( &rt->cond );
+   rt->thread = CreateThread ( NULL, 0, RenderThreadMain, rt, 0, &rt->threadId );
+
+   if ( rt->thread == NULL )
+#else
+   pthread_mutex_init ( &rt->lock, NULL );
+   pthread_cond_init ( &rt->cond, NULL );
+
+   if ( pthread_create ( &rt->thread, NULL, RenderThreadMain, rt ) != 0 )
+#endif
+   {
+      esLogMessage ( "esRenderThreadStart: could not create the render thread\n" );
+      eglMakeCurrent ( esContext->eglDisplay, esContext->eglSurface,
+                       esContext->eglSurface, esContext->eglContext );
+      free ( rt );
+      return GL_FALSE;
+   }
+
+   esContext->renderThread = rt;
+   esContext->updatePacket = esContext->framePackets[0];
+   return GL_TRUE;
+#else
+   return GL_FALSE;
+#endif
+}
+
+///
+//  esOnRenderThread()
+//
+GLboolean ESUTIL_API esOnRenderThread ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+
+   if ( rt == NULL )
+   {
+      return GL_FALSE;
+   }
+
+#ifdef _WIN32
+   return GetCurrentThreadId ( ) == rt->threadId;
+#else
+   return pthread_equal ( pthread_self ( ), rt->thread ) != 0;
+#endif
+#else
+   ( void ) esContext;
+   return GL_FALSE;
+#endif
+}
+
+///
+//  esRenderThreadBeginUpdate()
+//
+//      Wait until the update packet is no longer being drawn, then seed it
+//      with the previous frame so updates that skip a frame keep their state
+//
+void ESUTIL_API esRenderThreadBeginUpdate ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+
+   if ( rt == NULL || !rt->seedPacket )
+   {
+      return;
+   }
+
+   esTraceBegin ( "Wait for render thread" );
+   LOCK ( rt );
+
+   // Frame submitted - 2 used the same packet
+   while ( rt->submitted - rt->presented >= 2 )
+   {
+      WAIT ( rt );
+   }
+
+   UNLOCK ( rt );
+   esTraceEnd ( );
+
+   // The previous packet may still be read by the render thread, which is fine
+   memcpy ( esContext->updatePacket, esContext->framePackets[( rt->submitted + 1 ) % 2],
+            esContext->framePacketSize );
+   rt->seedPacket = GL_FALSE;
+#endif
+}
+
+///
+//  esRenderThreadSubmit()
+//
+//      Hand the update packet to the render thread and switch to the other one
+//
+void ESUTIL_API esRenderThreadSubmit ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+
+   if ( rt == NULL )
+   {
+      return;
+   }
+
+   // The render thread reads the alpha of the packet it draws, not the one the
+   // main thread goes on to update.  The lock publishes it with the packet.
+   esContext->framePacketAlpha[rt->submitted % 2] = esGetInterpolationAlpha ( esContext );
+
+   LOCK ( rt );
+   rt->submitted++;
+   BROADCAST ( rt );
+   UNLOCK ( rt );
+
+   esContext->updatePacket = esContext->framePackets[rt->submitted % 2];
+   rt->seedPacket = GL_TRUE;
+#endif
+}
+
+///
+//  esRenderThreadRequestRedraw()
+//
+void ESUTIL_API esRenderThreadRequestRedraw ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+
+   LOCK ( rt );
+   rt->redrawPending = GL_TRUE;
+   UNLOCK ( rt );
+
+   // The main loop may already be asleep waiting for events
+   WinWake ( esContext );
+#else
+   ( void ) esContext;
+#endif
+}
+
+///
+//  esRenderThreadTakeRedraw()
+//
+GLboolean ESUTIL_API esRenderThreadTakeRedraw ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+   GLboolean redrawPending;
+
+   if ( rt == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   LOCK ( rt );
+   redrawPending = rt->redrawPending;
+   rt->redrawPending = GL_FALSE;
+   UNLOCK ( rt );
+
+   return redrawPending;
+#else
+   ( void ) esContext;
+   return GL_FALSE;
+#endif
+}
+
+///
+//  esRenderThreadStop()
+//
+//      Let the render thread present the submitted frames, join it and make
+//      the context current on the calling thread again
+//
+void ESUTIL_API esRenderThreadStop ( ESContext *esContext )
+{
+#ifdef ES_RENDER_THREAD_SUPPORTED
+   RenderThread *rt = ( RenderThread * ) esContext->renderThread;
+
+   if ( rt == NULL )
+   {
+      return;
+   }
+
+   LOCK ( rt );
+   rt->quit = GL_TRUE;
+   BROADCAST ( rt );
+   UNLOCK ( rt );
+
+#ifdef _WIN32
+   WaitForSingleObject ( rt->thread, INFINITE );
+   CloseHandle ( rt->thread );
+   DeleteCriticalSection ( &rt->lock );
+#else
+   pthread_join ( rt->thread, NULL );
+   pthread_cond_destroy ( &rt->cond );
+   pthread_mutex_destroy ( &rt->lock );
+#endif
+
+   eglMakeCurrent ( esContext->eglDisplay, esContext->eglSurface,
+                    esContext->eglSurface, esContext->eglContext );
+
+   free ( rt );
+   esContext->renderThread = NULL;
+   esContext->updatePacket = esContext->framePackets[0];
+   esContext->drawPacket = esContext->framePackets[0];
+#endif
+}
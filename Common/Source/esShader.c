@@ -32,36 +32,109 @@
 // ESShader.c
 //
 //    Utility functions for loading shaders and creating program objects.
+//    Linked programs can be cached on disk as program binaries.
 //
 
 ///
 //  Includes
 //
 #include "esUtil.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-//////////////////////////////////////////////////////////////////
-//
-//  Private Functions
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir ( path )
+#else
+#include <sys/stat.h>
+#endif
+
+///
+//  Macros
 //
+#define PROGRAM_CACHE_MAGIC     0x42505345   // "ESPB"
+#define PROGRAM_CACHE_VERSION   1
+
+///
+//  Types
 //
+typedef struct
+{
+   GLuint   magic;
+   GLuint   version;
+   GLuint   keyCheck[2];
+   GLenum   binaryFormat;
+   GLint    binaryLength;
+} ProgramCacheHeader;
+
+typedef struct
+{
+   // 64-bit FNV-1a hashes of the key from two different offset bases.  The
+   // first names the cache file, the second is stored in it and checked.
+   GLuint   hash[2];
+   GLuint   check[2];
+} ProgramKey;
 
+typedef void ( GL_APIENTRY *MaxShaderCompilerThreadsProc ) ( GLuint count );
 
+///
+//  Module state
+//
+static const char *s_programCacheDir = NULL;
 
 //////////////////////////////////////////////////////////////////
 //
-//  Public Functions
+//  Private Functions
 //
 //
 
+///
+// LogShaderError()
 //
+static void LogShaderError ( GLuint shader )
+{
+   GLint infoLen = 0;
+
+   glGetShaderiv ( shader, GL_INFO_LOG_LENGTH, &infoLen );
+
+   if ( infoLen > 1 )
+   {
+      char *infoLog = malloc ( sizeof ( char ) * infoLen );
+
+      glGetShaderInfoLog ( shader, infoLen, NULL, infoLog );
+      esLogMessage ( "Error compiling shader:\n%s\n", infoLog );
+
+      free ( infoLog );
+   }
+}
+
 ///
-/// \brief Load a shader, check for compile errors, print error messages to output log
-/// \param type Type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
-/// \param shaderSrc Shader source string
-/// \return A new shader object on success, 0 on failure
+// LogProgramError()
 //
-GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
+static void LogProgramError ( GLuint programObject )
+{
+   GLint infoLen = 0;
+
+   glGetProgramiv ( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+
+   if ( infoLen > 1 )
+   {
+      char *infoLog = malloc ( sizeof ( char ) * infoLen );
+
+      glGetProgramInfoLog ( programObject, infoLen, NULL, infoLog );
+      esLogMessage ( "Error linking program:\n%s\n", infoLog );
+
+      free ( infoLog );
+   }
+}
+
+///
+// LoadShader()
+//
+//    Compile a shader, see esLoadShader()
+//
+static GLuint LoadShader ( GLenum type, const char *shaderSrc )
 {
    GLuint shader;
    GLint compiled;
@@ -85,100 +158,529 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
 
    if ( !compiled )
    {
-      GLint infoLen = 0;
+      LogShaderError ( shader );
+      glDeleteShader ( shader );
+      return 0;
+   }
 
-      glGetShaderiv ( shader, GL_INFO_LOG_LENGTH, &infoLen );
+   return shader;
 
-      if ( infoLen > 1 )
-      {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
+}
 
-         glGetShaderInfoLog ( shader, infoLen, NULL, infoLog );
-         esLogMessage ( "Error compiling shader:\n%s\n", infoLog );
+///
+// HashBytes()
+//
+//    Continue a 64-bit FNV-1a hash held in two 32-bit halves
+//
+static void HashBytes ( GLuint hash[2], const void *data, size_t size )
+{
+   const unsigned char *bytes = ( const unsigned char * ) data;
+   unsigned long long h = ( ( unsigned long long ) hash[0] << 32 ) | hash[1];
+   size_t i;
 
-         free ( infoLog );
-      }
+   for ( i = 0; i < size; i++ )
+   {
+      h ^= bytes[i];
+      h *= 0x100000001b3ULL;
+   }
 
-      glDeleteShader ( shader );
-      return 0;
+   hash[0] = ( GLuint ) ( h >> 32 );
+   hash[1] = ( GLuint ) h;
+}
+
+///
+// HashString()
+//
+//    Hash a string including its terminator so adjacent strings cannot alias
+//
+static void HashString ( GLuint hash[2], const char *str )
+{
+   if ( str == NULL )
+   {
+      str = "";
    }
 
-   return shader;
+   HashBytes ( hash, str, strlen ( str ) + 1 );
+}
 
+///
+// MakeProgramKey()
+//
+//    Key a program by its sources, its link options and the driver that built it
+//
+static void MakeProgramKey ( ProgramKey *key, const char *vertShaderSrc, const char *fragShaderSrc,
+                             GLsizei varyingCount, const char *const *varyings, GLenum bufferMode )
+{
+   GLuint *hashes[2];
+   int i, j;
+
+   key->hash[0] = 0xcbf29ce4;
+   key->hash[1] = 0x84222325;
+   key->check[0] = 0x6c62272e;
+   key->check[1] = 0x07bb0142;
+   hashes[0] = key->hash;
+   hashes[1] = key->check;
+
+   for ( i = 0; i < 2; i++ )
+   {
+      HashString ( hashes[i], ( const char * ) glGetString ( GL_RENDERER ) );
+      HashString ( hashes[i], ( const char * ) glGetString ( GL_VERSION ) );
+      HashString ( hashes[i], vertShaderSrc );
+      HashString ( hashes[i], fragShaderSrc );
+      HashBytes ( hashes[i], &bufferMode, sizeof ( bufferMode ) );
+
+      for ( j = 0; j < varyingCount; j++ )
+      {
+         HashString ( hashes[i], varyings[j] );
+      }
+   }
 }
 
+///
+// ProgramCachePath()
+//
+static void ProgramCachePath ( char *path, size_t size, const ProgramKey *key )
+{
+   snprintf ( path, size, "%s/%08x%08x.bin", s_programCacheDir, key->hash[0], key->hash[1] );
+}
 
+///
+// ProgramBinarySupported()
 //
+static GLboolean ProgramBinarySupported ( void )
+{
+   GLint numFormats = 0;
+
+   glGetIntegerv ( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+   return numFormats > 0 ? GL_TRUE : GL_FALSE;
+}
+
 ///
-/// \brief Load a vertex and fragment shader, create a program object, link program.
-//         Errors output to log.
-/// \param vertShaderSrc Vertex shader source code
-/// \param fragShaderSrc Fragment shader source code
-/// \return A new program object linked with the vertex/fragment shader pair, 0 on failure
+// LoadCachedProgram()
 //
-GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc )
+//    Create a program from a cached binary.  Returns 0 if there is no entry
+//    or the driver rejects it, in which case the entry is removed.
+//
+static GLuint LoadCachedProgram ( const ProgramKey *key )
 {
-   GLuint vertexShader;
-   GLuint fragmentShader;
-   GLuint programObject;
-   GLint linked;
+   char path[1024];
+   ProgramCacheHeader header;
+   GLuint programObject = 0;
+   GLint linked = GL_FALSE;
+   void *binary;
+   FILE *fp;
 
-   // Load the vertex/fragment shaders
-   vertexShader = esLoadShader ( GL_VERTEX_SHADER, vertShaderSrc );
+   ProgramCachePath ( path, sizeof ( path ), key );
+   fp = fopen ( path, "rb" );
 
-   if ( vertexShader == 0 )
+   if ( fp == NULL )
    {
       return 0;
    }
 
-   fragmentShader = esLoadShader ( GL_FRAGMENT_SHADER, fragShaderSrc );
-
-   if ( fragmentShader == 0 )
+   if ( fread ( &header, sizeof ( header ), 1, fp ) != 1 ||
+         header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION ||
+         header.keyCheck[0] != key->check[0] || header.keyCheck[1] != key->check[1] ||
+         header.binaryLength <= 0 )
    {
-      glDeleteShader ( vertexShader );
+      fclose ( fp );
       return 0;
    }
 
-   // Create the program object
-   programObject = glCreateProgram ( );
+   binary = malloc ( header.binaryLength );
 
+   if ( binary != NULL && fread ( binary, header.binaryLength, 1, fp ) == 1 )
+   {
+      programObject = glCreateProgram ( );
+      glProgramBinary ( programObject, header.binaryFormat, binary, header.binaryLength );
+      glGetProgramiv ( programObject, GL_LINK_STATUS, &linked );
+
+      if ( !linked )
+      {
+         glDeleteProgram ( programObject );
+         programObject = 0;
+      }
+   }
+
+   free ( binary );
+   fclose ( fp );
+
+   // Binaries do not survive driver updates, rebuild the entry from source
    if ( programObject == 0 )
    {
-      return 0;
+      remove ( path );
+   }
+
+   return programObject;
+}
+
+///
+// SaveProgramBinary()
+//
+//    Store a linked program in the cache.  The file is written under a
+//    temporary name and renamed so readers never see a partial entry.
+//
+static void SaveProgramBinary ( GLuint programObject, const ProgramKey *key )
+{
+   char path[1024];
+   char tempPath[1040];
+   ProgramCacheHeader header;
+   void *binary;
+   FILE *fp;
+
+   glGetProgramiv ( programObject, GL_PROGRAM_BINARY_LENGTH, &header.binaryLength );
+
+   if ( header.binaryLength <= 0 || ( binary = malloc ( header.binaryLength ) ) == NULL )
+   {
+      return;
+   }
+
+   glGetProgramBinary ( programObject, header.binaryLength, NULL, &header.binaryFormat, binary );
+
+   header.magic = PROGRAM_CACHE_MAGIC;
+   header.version = PROGRAM_CACHE_VERSION;
+   header.keyCheck[0] = key->check[0];
+   header.keyCheck[1] = key->check[1];
+
+   ProgramCachePath ( path, sizeof ( path ), key );
+   snprintf ( tempPath, sizeof ( tempPath ), "%s.tmp", path );
+
+   if ( ( fp = fopen ( tempPath, "wb" ) ) == NULL )
+   {
+      mkdir ( s_programCacheDir, 0755 );
+      fp = fopen ( tempPath, "wb" );
+   }
+
+   if ( fp != NULL )
+   {
+      GLboolean written = fwrite ( &header, sizeof ( header ), 1, fp ) == 1 &&
+                          fwrite ( binary, header.binaryLength, 1, fp ) == 1;
+
+      if ( fclose ( fp ) == 0 && written )
+      {
+         remove ( path );
+         rename ( tempPath, path );
+      }
+      else
+      {
+         remove ( tempPath );
+      }
+   }
+
+   free ( binary );
+}
+
+///
+// EnableParallelCompile()
+//
+//    Let the driver compile and link on its own threads if it supports
+//    GL_KHR_parallel_shader_compile
+//
+static void EnableParallelCompile ( void )
+{
+#ifndef __APPLE__
+   static GLboolean checked = GL_FALSE;
+   const char *extensions;
+
+   if ( checked )
+   {
+      return;
+   }
+
+   checked = GL_TRUE;
+   extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+
+   if ( extensions != NULL && strstr ( extensions, "GL_KHR_parallel_shader_compile" ) != NULL )
+   {
+      MaxShaderCompilerThreadsProc maxShaderCompilerThreads =
+         ( MaxShaderCompilerThreadsProc ) eglGetProcAddress ( "glMaxShaderCompilerThreadsKHR" );
+
+      if ( maxShaderCompilerThreads != NULL )
+      {
+         // Let the implementation pick the number of threads
+         maxShaderCompilerThreads ( 0xFFFFFFFF );
+      }
+   }
+#endif
+}
+
+///
+// StartCompile()
+//
+//    Create and compile a shader without waiting for the result
+//
+static GLuint StartCompile ( GLenum type, const char *shaderSrc )
+{
+   GLuint shader = glCreateShader ( type );
+
+   if ( shader != 0 )
+   {
+      glShaderSource ( shader, 1, &shaderSrc, NULL );
+      glCompileShader ( shader );
    }
 
-   glAttachShader ( programObject, vertexShader );
-   glAttachShader ( programObject, fragmentShader );
+   return shader;
+}
 
-   // Link the program
-   glLinkProgram ( programObject );
+///
+// BuildPrograms()
+//
+//    Build a set of programs, see esLoadProgramsBatch().  Every compile and
+//    link is issued before the first status query so the driver can overlap
+//    them.
+//
+static GLboolean BuildPrograms ( ESProgramDesc *programs, GLsizei count )
+{
+   GLboolean useCache = s_programCacheDir != NULL && ProgramBinarySupported ( );
+   GLboolean success = GL_TRUE;
+   ProgramKey *keys = NULL;
+   GLuint *shaders;
+   GLsizei i;
 
-   // Check the link status
-   glGetProgramiv ( programObject, GL_LINK_STATUS, &linked );
+   shaders = calloc ( 2 * count, sizeof ( GLuint ) );
 
-   if ( !linked )
+   if ( useCache )
    {
-      GLint infoLen = 0;
+      keys = malloc ( count * sizeof ( ProgramKey ) );
+   }
 
-      glGetProgramiv ( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+   if ( shaders == NULL || ( useCache && keys == NULL ) )
+   {
+      free ( shaders );
+      free ( keys );
 
-      if ( infoLen > 1 )
+      for ( i = 0; i < count; i++ )
       {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
+         programs[i].programObject = 0;
+      }
+
+      return GL_FALSE;
+   }
 
-         glGetProgramInfoLog ( programObject, infoLen, NULL, infoLog );
-         esLogMessage ( "Error linking program:\n%s\n", infoLog );
+   EnableParallelCompile ( );
 
-         free ( infoLog );
+   // Load cached programs and start compiling the others
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramDesc *desc = &programs[i];
+
+      desc->programObject = 0;
+
+      if ( useCache )
+      {
+         MakeProgramKey ( &keys[i], desc->vertShaderSrc, desc->fragShaderSrc,
+                          desc->varyingCount, desc->varyings, desc->bufferMode );
+         desc->programObject = LoadCachedProgram ( &keys[i] );
+
+         if ( desc->programObject != 0 )
+         {
+            continue;
+         }
       }
 
-      glDeleteProgram ( programObject );
-      return 0;
+      shaders[2 * i + 0] = StartCompile ( GL_VERTEX_SHADER, desc->vertShaderSrc );
+      shaders[2 * i + 1] = StartCompile ( GL_FRAGMENT_SHADER, desc->fragShaderSrc );
    }
 
-   // Free up no longer needed shader resources
-   glDeleteShader ( vertexShader );
-   glDeleteShader ( fragmentShader );
+   // Start linking
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramDesc *desc = &programs[i];
 
-   return programObject;
+      if ( shaders[2 * i + 0] == 0 || shaders[2 * i + 1] == 0 )
+      {
+         continue;
+      }
+
+      desc->programObject = glCreateProgram ( );
+
+      if ( desc->programObject == 0 )
+      {
+         continue;
+      }
+
+      glAttachShader ( desc->programObject, shaders[2 * i + 0] );
+      glAttachShader ( desc->programObject, shaders[2 * i + 1] );
+
+      if ( desc->varyingCount > 0 )
+      {
+         glTransformFeedbackVaryings ( desc->programObject, desc->varyingCount, desc->varyings, desc->bufferMode );
+      }
+
+      if ( useCache )
+      {
+         glProgramParameteri ( desc->programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+      }
+
+      glLinkProgram ( desc->programObject );
+   }
+
+   // Collect the results
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramDesc *desc = &programs[i];
+      GLint linked = GL_FALSE;
+      int j;
+
+      if ( desc->programObject != 0 && shaders[2 * i] != 0 )
+      {
+         glGetProgramiv ( desc->programObject, GL_LINK_STATUS, &linked );
+
+         if ( !linked )
+         {
+            GLint compiled[2] = { GL_FALSE, GL_FALSE };
+
+            // A shader that failed to compile explains the link failure
+            for ( j = 0; j < 2; j++ )
+            {
+               glGetShaderiv ( shaders[2 * i + j], GL_COMPILE_STATUS, &compiled[j] );
+
+               if ( !compiled[j] )
+               {
+                  LogShaderError ( shaders[2 * i + j] );
+               }
+            }
+
+            if ( compiled[0] && compiled[1] )
+            {
+               LogProgramError ( desc->programObject );
+            }
+
+            glDeleteProgram ( desc->programObject );
+            desc->programObject = 0;
+         }
+         else if ( useCache )
+         {
+            SaveProgramBinary ( desc->programObject, &keys[i] );
+         }
+      }
+
+      // Free up no longer needed shader resources
+      for ( j = 0; j < 2; j++ )
+      {
+         if ( shaders[2 * i + j] != 0 )
+         {
+            glDeleteShader ( shaders[2 * i + j] );
+         }
+      }
+
+      if ( desc->programObject == 0 )
+      {
+         success = GL_FALSE;
+      }
+   }
+
+   free ( shaders );
+   free ( keys );
+
+   return success;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Load a shader, check for compile errors, print error messages to output log
+/// \param type Type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
+/// \param shaderSrc Shader source string
+/// \return A new shader object on success, 0 on failure
+//
+GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
+{
+   GLuint shader;
+
+   esTraceBegin ( "esLoadShader" );
+   shader = LoadShader ( type, shaderSrc );
+   esTraceEnd ( );
+
+   return shader;
+}
+
+
+//
+///
+/// \brief Load a vertex and fragment shader, create a program object, link program.
+//         Errors output to log.
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \return A new program object linked with the vertex/fragment shader pair, 0 on failure
+//
+GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc )
+{
+   return esLoadProgramWithVaryings ( vertShaderSrc, fragShaderSrc, 0, NULL, GL_INTERLEAVED_ATTRIBS );
+}
+
+//
+///
+/// \brief Load a vertex and fragment shader and link them into a program whose vertex shader
+///        outputs are captured with transform feedback.  Uses the program cache when enabled.
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \param varyingCount Number of transform feedback varyings, 0 for none
+/// \param varyings Names of the varyings to capture
+/// \param bufferMode GL_INTERLEAVED_ATTRIBS or GL_SEPARATE_ATTRIBS
+/// \return A new program object on success, 0 on failure
+//
+GLuint ESUTIL_API esLoadProgramWithVaryings ( const char *vertShaderSrc, const char *fragShaderSrc,
+                                              GLsizei varyingCount, const char *const *varyings, GLenum bufferMode )
+{
+   ESProgramDesc desc;
+
+   desc.vertShaderSrc = vertShaderSrc;
+   desc.fragShaderSrc = fragShaderSrc;
+   desc.varyingCount = varyingCount;
+   desc.varyings = varyings;
+   desc.bufferMode = bufferMode;
+
+   esTraceBegin ( "esLoadProgram" );
+   BuildPrograms ( &desc, 1 );
+   esTraceEnd ( );
+
+   return desc.programObject;
+}
+
+//
+///
+/// \brief Build several programs at once.  All compiles and links are issued before any status
+///        is queried so drivers with GL_KHR_parallel_shader_compile can overlap them.
+/// \param programs Programs to build, programObject is set to the program or 0 on failure
+/// \param count Number of programs
+/// \return GL_TRUE if every program was built
+//
+GLboolean ESUTIL_API esLoadProgramsBatch ( ESProgramDesc *programs, GLsizei count )
+{
+   GLboolean success;
+
+   esTraceBegin ( "esLoadProgramsBatch" );
+   success = BuildPrograms ( programs, count );
+   esTraceEnd ( );
+
+   return success;
+}
+
+///
+//  esProgramCacheInit()
+//
+//      Enable the program cache from --program-cache DIR or ES_PROGRAM_CACHE
+//
+void ESUTIL_API esProgramCacheInit ( int argc, char *argv[] )
+{
+   const char *dir = esGetOption ( argc, argv, "--program-cache", "ES_PROGRAM_CACHE" );
+
+   if ( dir != NULL )
+   {
+      esSetProgramCacheDir ( dir );
+   }
+}
+
+///
+//  esSetProgramCacheDir()
+//
+void ESUTIL_API esSetProgramCacheDir ( const char *dir )
+{
+   s_programCacheDir = dir != NULL && dir[0] != '\0' ? dir : NULL;
 }
\ No newline at end of file
@@ -0,0 +1,415 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESShaderVariant.c
+//
+//    Shader permutations.  A variant set holds the base sources of a
+//    program; each combination of defines is compiled the first time it
+//    is asked for and cached, keyed by a hash of the defines.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// HashDefines()
+//
+//    64-bit FNV-1a hash of the define names and values, in order
+//
+static GLuint64 HashDefines ( const ESShaderDefine *defines, GLsizei defineCount )
+{
+   GLuint64 hash = 0xcbf29ce484222325ULL;
+   GLsizei i;
+
+   for ( i = 0; i < defineCount; i++ )
+   {
+      const char *str[2];
+      int j;
+
+      str[0] = defines[i].name;
+      str[1] = defines[i].value != NULL ? defines[i].value : "";
+
+      for ( j = 0; j < 2; j++ )
+      {
+         // Hash the terminator too so ("AB", "C") and ("A", "BC") differ
+         const unsigned char *c = ( const unsigned char * ) str[j];
+
+         do
+         {
+            hash ^= *c;
+            hash *= 0x100000001b3ULL;
+         }
+         while ( *c++ != '\0' );
+      }
+   }
+
+   return hash;
+}
+
+///
+// CopyString()
+//
+static char *CopyString ( const char *str )
+{
+   char *copy;
+
+   if ( str == NULL )
+   {
+      return NULL;
+   }
+
+   copy = malloc ( strlen ( str ) + 1 );
+
+   if ( copy != NULL )
+   {
+      strcpy ( copy, str );
+   }
+
+   return copy;
+}
+
+///
+// ExpandSource()
+//
+//    Insert a #define line for each define after the #version line of
+//    src, which has to stay first.  Sources without one get the defines
+//    prepended.  Returns a string to free.
+//
+static char *ExpandSource ( const char *src, const ESShaderDefine *defines, GLsizei defineCount )
+{
+   const char *body = src;
+   const char *version = strstr ( src, "#version" );
+   size_t length = strlen ( src ) + 1;
+   char *expanded;
+   char *out;
+   GLsizei i;
+
+   if ( version != NULL )
+   {
+      const char *eol = strchr ( version, '\n' );
+
+      body = eol != NULL ? eol + 1 : version + strlen ( version );
+   }
+
+   for ( i = 0; i < defineCount; i++ )
+   {
+      length += strlen ( "#define   \n" ) + strlen ( defines[i].name ) +
+                ( defines[i].value != NULL ? strlen ( defines[i].value ) : 0 );
+   }
+
+   expanded = malloc ( length + 1 );
+
+   if ( expanded == NULL )
+   {
+      return NULL;
+   }
+
+   // #version line, then the defines, then the rest of the source
+   out = expanded;
+   memcpy ( out, src, body - src );
+   out += body - src;
+
+   if ( body != src && out[-1] != '\n' )
+   {
+      *out++ = '\n';
+   }
+
+   for ( i = 0; i < defineCount; i++ )
+   {
+      out += sprintf ( out, "#define %s %s\n", defines[i].name,
+                       defines[i].value != NULL ? defines[i].value : "" );
+   }
+
+   strcpy ( out, body );
+
+   return expanded;
+}
+
+///
+// FindVariant()
+//
+static ESShaderVariant *FindVariant ( const ESShaderVariants *variants, GLuint64 key )
+{
+   GLsizei i;
+
+   for ( i = 0; i < variants->count; i++ )
+   {
+      if ( variants->variants[i].key == key )
+      {
+         return &variants->variants[i];
+      }
+   }
+
+   return NULL;
+}
+
+///
+// AddVariant()
+//
+//    Record a built variant.  Failed builds are recorded too so they are
+//    not retried on every use.
+//
+static void AddVariant ( ESShaderVariants *variants, GLuint64 key, GLuint programObject )
+{
+   if ( variants->count == variants->capacity )
+   {
+      GLsizei capacity = variants->capacity != 0 ? variants->capacity * 2 : 4;
+      ESShaderVariant *grown = realloc ( variants->variants, capacity * sizeof ( ESShaderVariant ) );
+
+      if ( grown == NULL )
+      {
+         return;
+      }
+
+      variants->variants = grown;
+      variants->capacity = capacity;
+   }
+
+   variants->variants[variants->count].key = key;
+   variants->variants[variants->count].programObject = programObject;
+   variants->count++;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esShaderVariantsInit()
+//
+GLboolean ESUTIL_API esShaderVariantsInit ( ESShaderVariants *variants, const ESProgramDesc *base )
+{
+   GLsizei i;
+
+   memset ( variants, 0, sizeof ( ESShaderVariants ) );
+
+   // Variants are compiled lazily, after the caller's sources may be gone
+   variants->base.vertShaderSrc = CopyString ( base->vertShaderSrc );
+   variants->base.fragShaderSrc = CopyString ( base->fragShaderSrc );
+   variants->base.bufferMode = base->bufferMode;
+
+   if ( base->varyingCount > 0 )
+   {
+      char **varyings = calloc ( base->varyingCount, sizeof ( char * ) );
+
+      variants->base.varyings = ( const char *const * ) varyings;
+
+      if ( varyings != NULL )
+      {
+         variants->base.varyingCount = base->varyingCount;
+
+         for ( i = 0; i < base->varyingCount; i++ )
+         {
+            varyings[i] = CopyString ( base->varyings[i] );
+         }
+      }
+   }
+
+   if ( variants->base.vertShaderSrc == NULL || variants->base.fragShaderSrc == NULL ||
+        variants->base.varyingCount != base->varyingCount )
+   {
+      esShaderVariantsFree ( variants );
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// esGetShaderVariant()
+//
+GLuint ESUTIL_API esGetShaderVariant ( ESShaderVariants *variants, const ESShaderDefine *defines, GLsizei defineCount )
+{
+   ESShaderVariantRequest request;
+
+   request.variants = variants;
+   request.defines = defines;
+   request.defineCount = defineCount;
+   request.programObject = 0;
+
+   esGetShaderVariantsBatch ( &request, 1 );
+
+   return request.programObject;
+}
+
+///
+// esGetShaderVariantsBatch()
+//
+GLboolean ESUTIL_API esGetShaderVariantsBatch ( ESShaderVariantRequest *requests, GLsizei count )
+{
+   ESProgramDesc *programs;
+   GLuint64 *keys;
+   GLsizei *builds;
+   GLsizei buildCount = 0;
+   GLboolean success = GL_TRUE;
+   GLsizei i, j;
+
+   programs = calloc ( count, sizeof ( ESProgramDesc ) );
+   keys = malloc ( count * sizeof ( GLuint64 ) );
+   builds = malloc ( count * sizeof ( GLsizei ) );
+
+   if ( programs == NULL || keys == NULL || builds == NULL )
+   {
+      free ( programs );
+      free ( keys );
+      free ( builds );
+      return GL_FALSE;
+   }
+
+   // Resolve cached variants, and expand the sources of the others
+   for ( i = 0; i < count; i++ )
+   {
+      ESShaderVariantRequest *request = &requests[i];
+      ESShaderVariant *variant;
+
+      keys[i] = HashDefines ( request->defines, request->defineCount );
+      variant = FindVariant ( request->variants, keys[i] );
+      request->programObject = 0;
+
+      if ( variant != NULL )
+      {
+         request->programObject = variant->programObject;
+         continue;
+      }
+
+      // The same uncached variant requested twice is only built once
+      for ( j = 0; j < buildCount; j++ )
+      {
+         if ( requests[builds[j]].variants == request->variants && keys[builds[j]] == keys[i] )
+         {
+            break;
+         }
+      }
+
+      if ( j < buildCount )
+      {
+         continue;
+      }
+
+      programs[buildCount] = request->variants->base;
+      programs[buildCount].vertShaderSrc = ExpandSource ( request->variants->base.vertShaderSrc,
+                                                          request->defines, request->defineCount );
+      programs[buildCount].fragShaderSrc = ExpandSource ( request->variants->base.fragShaderSrc,
+                                                          request->defines, request->defineCount );
+
+      // Out of memory fails this request without caching it, so a later call retries
+      if ( programs[buildCount].vertShaderSrc == NULL || programs[buildCount].fragShaderSrc == NULL )
+      {
+         esLogMessage ( "esGetShaderVariantsBatch: out of memory expanding the sources of variant %d\n", i );
+         free ( ( char * ) programs[buildCount].vertShaderSrc );
+         free ( ( char * ) programs[buildCount].fragShaderSrc );
+         continue;
+      }
+
+      builds[buildCount++] = i;
+   }
+
+   if ( buildCount > 0 )
+   {
+      esLoadProgramsBatch ( programs, buildCount );
+
+      for ( j = 0; j < buildCount; j++ )
+      {
+         AddVariant ( requests[builds[j]].variants, keys[builds[j]], programs[j].programObject );
+         free ( ( char * ) programs[j].vertShaderSrc );
+         free ( ( char * ) programs[j].fragShaderSrc );
+      }
+
+      // Pick up the new variants, including the duplicates
+      for ( i = 0; i < count; i++ )
+      {
+         ESShaderVariant *variant = FindVariant ( requests[i].variants, keys[i] );
+
+         if ( variant != NULL )
+         {
+            requests[i].programObject = variant->programObject;
+         }
+      }
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      if ( requests[i].programObject == 0 )
+      {
+         success = GL_FALSE;
+      }
+   }
+
+   free ( programs );
+   free ( keys );
+   free ( builds );
+
+   return success;
+}
+
+///
+// esShaderVariantsFree()
+//
+void ESUTIL_API esShaderVariantsFree ( ESShaderVariants *variants )
+{
+   GLsizei i;
+
+   for ( i = 0; i < variants->count; i++ )
+   {
+      if ( variants->variants[i].programObject != 0 )
+      {
+         esStateDeleteProgram ( variants->variants[i].programObject );
+         glDeleteProgram ( variants->variants[i].programObject );
+      }
+   }
+
+   if ( variants->base.varyings != NULL )
+   {
+      for ( i = 0; i < variants->base.varyingCount; i++ )
+      {
+         free ( ( char * ) variants->base.varyings[i] );
+      }
+   }
+
+   free ( ( char ** ) variants->base.varyings );
+   free ( ( char * ) variants->base.vertShaderSrc );
+   free ( ( char * ) variants->base.fragShaderSrc );
+   free ( variants->variants );
+   memset ( variants, 0, sizeof ( ESShaderVariants ) );
+}
@@ -0,0 +1,298 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESShaderWarmup.c
+//
+//    Shader warm-up.  Drivers often defer the real compile, state based
+//    recompiles and buffer allocation until the first draw with a
+//    program.  Drawing every registered combination once into a 1x1
+//    target at load time moves that stall out of the first frame.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+
+///
+//  Macros
+//
+#define MAX_WARMUPS          64
+#define MAX_WARMUP_TARGETS   8
+#define WARMUP_VERTICES      3
+#define MAX_WARMUP_BUFFERS   16
+
+///
+//  Types
+//
+typedef struct
+{
+   GLenum          colorFormat;
+   GLenum          depthFormat;
+   GLuint          framebuffer;
+   GLuint          renderbuffers[2];
+} WarmupTarget;
+
+///
+//  Module state
+//
+static ESShaderWarmup s_warmups[MAX_WARMUPS];
+static int            s_warmupCount;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BufferSize()
+//
+//    Bytes of vertex data the attributes read for WARMUP_VERTICES vertices,
+//    assuming at most 4 bytes per component
+//
+static GLsizeiptr BufferSize ( const ESShaderWarmup *warmup )
+{
+   GLsizeiptr size = 0;
+   GLsizei i;
+
+   for ( i = 0; i < warmup->attribCount; i++ )
+   {
+      const ESVertexAttrib *attrib = &warmup->attribs[i];
+      GLsizeiptr element = attrib->size * 4;
+      GLsizeiptr stride = attrib->stride != 0 ? attrib->stride : element;
+      GLsizeiptr end = attrib->offset + stride * ( WARMUP_VERTICES - 1 ) + element;
+
+      if ( end > size )
+      {
+         size = end;
+      }
+   }
+
+   return size;
+}
+
+///
+// GetTarget()
+//
+//    Find or create the 1x1 framebuffer with the given attachments
+//
+static GLuint GetTarget ( WarmupTarget *targets, int *targetCount, GLenum colorFormat, GLenum depthFormat )
+{
+   WarmupTarget *target;
+   GLenum drawBuffer = GL_COLOR_ATTACHMENT0;
+   int i;
+
+   for ( i = 0; i < *targetCount; i++ )
+   {
+      if ( targets[i].colorFormat == colorFormat && targets[i].depthFormat == depthFormat )
+      {
+         return targets[i].framebuffer;
+      }
+   }
+
+   if ( *targetCount == MAX_WARMUP_TARGETS )
+   {
+      return 0;
+   }
+
+   target = &targets[( *targetCount )++];
+   target->colorFormat = colorFormat;
+   target->depthFormat = depthFormat;
+
+   glGenFramebuffers ( 1, &target->framebuffer );
+   glGenRenderbuffers ( 2, target->renderbuffers );
+   glBindFramebuffer ( GL_FRAMEBUFFER, target->framebuffer );
+
+   if ( colorFormat != GL_NONE )
+   {
+      glBindRenderbuffer ( GL_RENDERBUFFER, target->renderbuffers[0] );
+      glRenderbufferStorage ( GL_RENDERBUFFER, colorFormat, 1, 1 );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->renderbuffers[0] );
+   }
+   else
+   {
+      drawBuffer = GL_NONE;
+   }
+
+   if ( depthFormat != GL_NONE )
+   {
+      glBindRenderbuffer ( GL_RENDERBUFFER, target->renderbuffers[1] );
+      glRenderbufferStorage ( GL_RENDERBUFFER, depthFormat, 1, 1 );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target->renderbuffers[1] );
+   }
+
+   glDrawBuffers ( 1, &drawBuffer );
+   glBindRenderbuffer ( GL_RENDERBUFFER, 0 );
+
+   if ( glCheckFramebufferStatus ( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+   {
+      esLogMessage ( "Warm-up target 0x%04x/0x%04x is incomplete\n", colorFormat, depthFormat );
+   }
+
+   return target->framebuffer;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esShaderWarmupRegister()
+//
+void ESUTIL_API esShaderWarmupRegister ( const ESShaderWarmup *warmup )
+{
+   GLsizei i;
+
+   if ( s_warmupCount == MAX_WARMUPS )
+   {
+      esLogMessage ( "Too many shader warm-ups, %s is skipped\n", warmup->name );
+      return;
+   }
+
+   for ( i = 0; i < warmup->attribCount; i++ )
+   {
+      if ( warmup->attribs[i].buffer >= MAX_WARMUP_BUFFERS )
+      {
+         esLogMessage ( "Shader warm-up %s uses too many buffers, it is skipped\n", warmup->name );
+         return;
+      }
+   }
+
+   s_warmups[s_warmupCount++] = *warmup;
+}
+
+///
+// esShaderWarmupRun()
+//
+double ESUTIL_API esShaderWarmupRun ( void )
+{
+   WarmupTarget targets[MAX_WARMUP_TARGETS];
+   int targetCount = 0;
+   GLint framebuffer, viewport[4], program, vertexArray, arrayBuffer;
+   GLuint warmupBuffer;
+   GLuint buffers[MAX_WARMUP_BUFFERS];
+   GLsizeiptr bufferSize = 0;
+   void *zeros;
+   double total = 0.0;
+   int i;
+
+   if ( s_warmupCount == 0 )
+   {
+      return 0.0;
+   }
+
+   esTraceBegin ( "shader warm-up" );
+
+   // Draws below change bindings the application may rely on
+   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &framebuffer );
+   glGetIntegerv ( GL_VIEWPORT, viewport );
+   glGetIntegerv ( GL_CURRENT_PROGRAM, &program );
+   glGetIntegerv ( GL_VERTEX_ARRAY_BINDING, &vertexArray );
+   glGetIntegerv ( GL_ARRAY_BUFFER_BINDING, &arrayBuffer );
+
+   // One zeroed buffer large enough for every vertex format
+   for ( i = 0; i < s_warmupCount; i++ )
+   {
+      GLsizeiptr size = BufferSize ( &s_warmups[i] );
+
+      if ( size > bufferSize )
+      {
+         bufferSize = size;
+      }
+   }
+
+   zeros = calloc ( 1, bufferSize > 0 ? bufferSize : 1 );
+   glGenBuffers ( 1, &warmupBuffer );
+   glBindBuffer ( GL_ARRAY_BUFFER, warmupBuffer );
+   glBufferData ( GL_ARRAY_BUFFER, bufferSize > 0 ? bufferSize : 1, zeros, GL_STATIC_DRAW );
+   free ( zeros );
+
+   // Every buffer slot of every format reads the zeroed buffer
+   for ( i = 0; i < MAX_WARMUP_BUFFERS; i++ )
+   {
+      buffers[i] = warmupBuffer;
+   }
+
+   glViewport ( 0, 0, 1, 1 );
+
+   for ( i = 0; i < s_warmupCount; i++ )
+   {
+      const ESShaderWarmup *warmup = &s_warmups[i];
+      double start;
+      double elapsed;
+
+      glBindFramebuffer ( GL_FRAMEBUFFER, GetTarget ( targets, &targetCount, warmup->colorFormat,
+                                                       warmup->depthFormat ) );
+
+      // Time the draw, not the creation of the target
+      glFinish ( );
+      start = esGetTime ( );
+      glUseProgram ( warmup->programObject );
+
+      esBindVertexFormat ( warmup->attribs, warmup->attribCount, buffers, 0 );
+      glDrawArrays ( warmup->mode, 0, WARMUP_VERTICES );
+      glFinish ( );
+
+      elapsed = esGetTime ( ) - start;
+      total += elapsed;
+      esLogMessage ( "Shader warm-up %-24s %8.3f ms\n", warmup->name != NULL ? warmup->name : "",
+                     elapsed * 1000.0 );
+   }
+
+   esLogMessage ( "Shader warm-up total %27.3f ms\n", total * 1000.0 );
+
+   // Restore the bindings and release the warm-up objects
+   glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+   glViewport ( viewport[0], viewport[1], viewport[2], viewport[3] );
+   glUseProgram ( program );
+   esBindVertexArray ( vertexArray );
+   glBindBuffer ( GL_ARRAY_BUFFER, arrayBuffer );
+
+   esVertexArrayCacheRemoveBuffer ( warmupBuffer );
+   esStateDeleteBuffers ( 1, &warmupBuffer );
+   glDeleteBuffers ( 1, &warmupBuffer );
+
+   for ( i = 0; i < targetCount; i++ )
+   {
+      esStateDeleteFramebuffers ( 1, &targets[i].framebuffer );
+      glDeleteFramebuffers ( 1, &targets[i].framebuffer );
+      glDeleteRenderbuffers ( 2, targets[i].renderbuffers );
+   }
+
+   s_warmupCount = 0;
+   esTraceEnd ( );
+
+   return total;
+}
@@ -82,6 +82,8 @@ int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GL
    int numIndices = numParallels * numSlices * 6;
    float angleStep = ( 2.0f * ES_PI ) / ( ( float ) numSlices );
 
+   esTraceBegin ( "esGenSphere" );
+
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
@@ -154,6 +156,7 @@ int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GL
       }
    }
 
+   esTraceEnd ( );
    return numIndices;
 }
 
@@ -259,6 +262,8 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
       1.0f, 0.0f,
    };
 
+   esTraceBegin ( "esGenCube" );
+
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
@@ -307,6 +312,7 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
       memcpy ( *indices, cubeIndices, sizeof ( cubeIndices ) );
    }
 
+   esTraceEnd ( );
    return numIndices;
 }
 
@@ -324,6 +330,8 @@ int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices
    int i, j;
    int numIndices = ( size - 1 ) * ( size - 1 ) * 2 * 3;
 
+   esTraceBegin ( "esGenSquareGrid" );
+
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
@@ -363,5 +371,6 @@ int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices
       }
    }
 
+   esTraceEnd ( );
    return numIndices;
 }
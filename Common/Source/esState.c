@@ -0,0 +1,517 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESState.c
+//
+//    GL state tracker.  A shadow copy of the bindings and capabilities
+//    the samples change every frame lets redundant calls be skipped
+//    without asking the driver what is bound.  Bindings are stored plus
+//    one so the zeroed state means unknown and the first call of each
+//    kind always reaches GL.  Deleting an object unbinds it in GL and frees
+//    its name for reuse, so the esStateDelete* hooks forget the bindings
+//    that name it.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+//  Macros
+//
+#define MAX_TEXTURE_UNITS    32
+#define TEXTURE_TARGETS      4
+#define CAP_COUNT            11
+
+///
+//  Types
+//
+typedef struct
+{
+   // Bound names plus one, 0 if unknown
+   GLuint          arrayBuffer;
+   GLuint          elementArrayBuffer;
+   GLuint          vertexArray;
+   GLuint          program;
+   GLuint          activeTexture;
+   GLuint          textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+   GLuint          drawFramebuffer;
+   GLuint          readFramebuffer;
+
+   // Capabilities, 0 if unknown, 1 disabled, 2 enabled
+   GLubyte         caps[CAP_COUNT];
+
+   // Viewport and write masks, valid if known
+   GLint           viewport[4];
+   GLboolean       viewportKnown;
+   GLboolean       colorMask[4];
+   GLboolean       colorMaskKnown;
+   GLboolean       depthMask;
+   GLboolean       depthMaskKnown;
+} TrackedState;
+
+///
+//  Module state
+//
+static TrackedState    s_state;
+static ESStateCounters s_frame;
+static ESStateCounters s_lastFrame;
+static ESStateCounters s_total;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Changed()
+//
+//    Update a tracked binding, returning GL_TRUE if the call has to be made
+//
+static GLboolean Changed ( GLuint *tracked, GLuint value )
+{
+   if ( *tracked == value + 1 )
+   {
+      s_frame.skipped++;
+      return GL_FALSE;
+   }
+
+   *tracked = value + 1;
+   s_frame.issued++;
+   return GL_TRUE;
+}
+
+///
+// Forget()
+//
+//    Mark a tracked binding unknown if it names one of the deleted objects
+//
+static void Forget ( GLuint *tracked, GLsizei n, const GLuint *names )
+{
+   GLsizei i;
+
+   for ( i = 0; i < n; i++ )
+   {
+      if ( names[i] != 0 && *tracked == names[i] + 1 )
+      {
+         *tracked = 0;
+         return;
+      }
+   }
+}
+
+///
+// CapIndex()
+//
+static int CapIndex ( GLenum cap )
+{
+   switch ( cap )
+   {
+      case GL_BLEND:                         return 0;
+      case GL_CULL_FACE:                     return 1;
+      case GL_DEPTH_TEST:                    return 2;
+      case GL_DITHER:                        return 3;
+      case GL_POLYGON_OFFSET_FILL:           return 4;
+      case GL_PRIMITIVE_RESTART_FIXED_INDEX: return 5;
+      case GL_RASTERIZER_DISCARD:            return 6;
+      case GL_SAMPLE_ALPHA_TO_COVERAGE:      return 7;
+      case GL_SAMPLE_COVERAGE:               return 8;
+      case GL_SCISSOR_TEST:                  return 9;
+      case GL_STENCIL_TEST:                  return 10;
+      default:                               return -1;
+   }
+}
+
+///
+// TextureIndex()
+//
+static int TextureIndex ( GLenum target )
+{
+   switch ( target )
+   {
+      case GL_TEXTURE_2D:       return 0;
+      case GL_TEXTURE_3D:       return 1;
+      case GL_TEXTURE_2D_ARRAY: return 2;
+      case GL_TEXTURE_CUBE_MAP: return 3;
+      default:                  return -1;
+   }
+}
+
+///
+// SetCap()
+//
+static GLboolean SetCap ( GLenum cap, GLubyte value )
+{
+   int index = CapIndex ( cap );
+
+   if ( index >= 0 && s_state.caps[index] == value )
+   {
+      s_frame.skipped++;
+      return GL_FALSE;
+   }
+
+   if ( index >= 0 )
+   {
+      s_state.caps[index] = value;
+   }
+
+   s_frame.issued++;
+   return GL_TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esBindBuffer()
+//
+//    Only the targets without indexed bindings are tracked; uniform and
+//    transform feedback buffers are also bound by glBindBufferRange()
+//
+void ESUTIL_API esBindBuffer ( GLenum target, GLuint buffer )
+{
+   GLuint *tracked = NULL;
+
+   if ( target == GL_ARRAY_BUFFER )
+   {
+      tracked = &s_state.arrayBuffer;
+   }
+   else if ( target == GL_ELEMENT_ARRAY_BUFFER )
+   {
+      tracked = &s_state.elementArrayBuffer;
+   }
+
+   if ( tracked == NULL )
+   {
+      s_frame.issued++;
+      glBindBuffer ( target, buffer );
+   }
+   else if ( Changed ( tracked, buffer ) )
+   {
+      glBindBuffer ( target, buffer );
+   }
+}
+
+///
+// esBindVertexArray()
+//
+void ESUTIL_API esBindVertexArray ( GLuint array )
+{
+   if ( Changed ( &s_state.vertexArray, array ) )
+   {
+      glBindVertexArray ( array );
+
+      // The element array binding belongs to the vertex array
+      s_state.elementArrayBuffer = 0;
+   }
+}
+
+///
+// esUseProgram()
+//
+void ESUTIL_API esUseProgram ( GLuint program )
+{
+   if ( Changed ( &s_state.program, program ) )
+   {
+      glUseProgram ( program );
+   }
+}
+
+///
+// esActiveTexture()
+//
+void ESUTIL_API esActiveTexture ( GLenum texture )
+{
+   if ( Changed ( &s_state.activeTexture, texture - GL_TEXTURE0 ) )
+   {
+      glActiveTexture ( texture );
+   }
+}
+
+///
+// esBindTexture()
+//
+void ESUTIL_API esBindTexture ( GLenum target, GLuint texture )
+{
+   GLuint unit = s_state.activeTexture - 1;
+   int index = TextureIndex ( target );
+
+   // Bindings are tracked per unit, so the active unit has to be known
+   if ( index < 0 || s_state.activeTexture == 0 || unit >= MAX_TEXTURE_UNITS )
+   {
+      s_frame.issued++;
+      glBindTexture ( target, texture );
+   }
+   else if ( Changed ( &s_state.textures[unit][index], texture ) )
+   {
+      glBindTexture ( target, texture );
+   }
+}
+
+///
+// esBindFramebuffer()
+//
+void ESUTIL_API esBindFramebuffer ( GLenum target, GLuint framebuffer )
+{
+   GLboolean issue;
+
+   if ( target == GL_READ_FRAMEBUFFER )
+   {
+      issue = Changed ( &s_state.readFramebuffer, framebuffer );
+   }
+   else if ( target == GL_DRAW_FRAMEBUFFER )
+   {
+      issue = Changed ( &s_state.drawFramebuffer, framebuffer );
+   }
+   else
+   {
+      // GL_FRAMEBUFFER binds both
+      GLuint readFramebuffer = s_state.readFramebuffer;
+
+      issue = Changed ( &s_state.drawFramebuffer, framebuffer );
+      s_state.readFramebuffer = framebuffer + 1;
+
+      if ( !issue && readFramebuffer != framebuffer + 1 )
+      {
+         s_frame.skipped--;
+         s_frame.issued++;
+         issue = GL_TRUE;
+      }
+   }
+
+   if ( issue )
+   {
+      glBindFramebuffer ( target, framebuffer );
+   }
+}
+
+///
+// esEnable()
+//
+void ESUTIL_API esEnable ( GLenum cap )
+{
+   if ( SetCap ( cap, 2 ) )
+   {
+      glEnable ( cap );
+   }
+}
+
+///
+// esDisable()
+//
+void ESUTIL_API esDisable ( GLenum cap )
+{
+   if ( SetCap ( cap, 1 ) )
+   {
+      glDisable ( cap );
+   }
+}
+
+///
+// esViewport()
+//
+void ESUTIL_API esViewport ( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   if ( s_state.viewportKnown && s_state.viewport[0] == x && s_state.viewport[1] == y &&
+        s_state.viewport[2] == width && s_state.viewport[3] == height )
+   {
+      s_frame.skipped++;
+      return;
+   }
+
+   s_state.viewport[0] = x;
+   s_state.viewport[1] = y;
+   s_state.viewport[2] = width;
+   s_state.viewport[3] = height;
+   s_state.viewportKnown = GL_TRUE;
+   s_frame.issued++;
+   glViewport ( x, y, width, height );
+}
+
+///
+// esColorMask()
+//
+void ESUTIL_API esColorMask ( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha )
+{
+   if ( s_state.colorMaskKnown && s_state.colorMask[0] == red && s_state.colorMask[1] == green &&
+        s_state.colorMask[2] == blue && s_state.colorMask[3] == alpha )
+   {
+      s_frame.skipped++;
+      return;
+   }
+
+   s_state.colorMask[0] = red;
+   s_state.colorMask[1] = green;
+   s_state.colorMask[2] = blue;
+   s_state.colorMask[3] = alpha;
+   s_state.colorMaskKnown = GL_TRUE;
+   s_frame.issued++;
+   glColorMask ( red, green, blue, alpha );
+}
+
+///
+// esDepthMask()
+//
+void ESUTIL_API esDepthMask ( GLboolean flag )
+{
+   if ( s_state.depthMaskKnown && s_state.depthMask == flag )
+   {
+      s_frame.skipped++;
+      return;
+   }
+
+   s_state.depthMask = flag;
+   s_state.depthMaskKnown = GL_TRUE;
+   s_frame.issued++;
+   glDepthMask ( flag );
+}
+
+///
+// esGetFramebufferBinding()
+//
+GLuint ESUTIL_API esGetFramebufferBinding ( void )
+{
+   if ( s_state.drawFramebuffer == 0 )
+   {
+      GLint framebuffer = 0;
+
+      glGetIntegerv ( GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer );
+      s_state.drawFramebuffer = ( GLuint ) framebuffer + 1;
+   }
+
+   return s_state.drawFramebuffer - 1;
+}
+
+///
+// esStateInvalidate()
+//
+void ESUTIL_API esStateInvalidate ( void )
+{
+   memset ( &s_state, 0, sizeof ( s_state ) );
+}
+
+///
+// esStateDeleteBuffers()
+//
+void ESUTIL_API esStateDeleteBuffers ( GLsizei n, const GLuint *buffers )
+{
+   Forget ( &s_state.arrayBuffer, n, buffers );
+   Forget ( &s_state.elementArrayBuffer, n, buffers );
+}
+
+///
+// esStateDeleteTextures()
+//
+void ESUTIL_API esStateDeleteTextures ( GLsizei n, const GLuint *textures )
+{
+   int unit, index;
+
+   for ( unit = 0; unit < MAX_TEXTURE_UNITS; unit++ )
+   {
+      for ( index = 0; index < TEXTURE_TARGETS; index++ )
+      {
+         Forget ( &s_state.textures[unit][index], n, textures );
+      }
+   }
+}
+
+///
+// esStateDeleteProgram()
+//
+//    A deleted program stays in use until another is, so forgetting it
+//    only makes sure the next esUseProgram() reaches GL
+//
+void ESUTIL_API esStateDeleteProgram ( GLuint program )
+{
+   Forget ( &s_state.program, 1, &program );
+}
+
+///
+// esStateDeleteFramebuffers()
+//
+void ESUTIL_API esStateDeleteFramebuffers ( GLsizei n, const GLuint *framebuffers )
+{
+   Forget ( &s_state.drawFramebuffer, n, framebuffers );
+   Forget ( &s_state.readFramebuffer, n, framebuffers );
+}
+
+///
+// esStateDeleteVertexArrays()
+//
+void ESUTIL_API esStateDeleteVertexArrays ( GLsizei n, const GLuint *arrays )
+{
+   GLuint vertexArray = s_state.vertexArray;
+
+   Forget ( &s_state.vertexArray, n, arrays );
+
+   // The element array binding belonged to the deleted vertex array
+   if ( s_state.vertexArray != vertexArray )
+   {
+      s_state.elementArrayBuffer = 0;
+   }
+}
+
+///
+// esStateFrame()
+//
+void ESUTIL_API esStateFrame ( void )
+{
+   s_frame.frames = 1;
+   s_lastFrame = s_frame;
+
+   s_total.frames++;
+   s_total.issued += s_frame.issued;
+   s_total.skipped += s_frame.skipped;
+
+   memset ( &s_frame, 0, sizeof ( s_frame ) );
+}
+
+///
+// esGetStateCounters()
+//
+void ESUTIL_API esGetStateCounters ( ESStateCounters *lastFrame, ESStateCounters *total )
+{
+   if ( lastFrame != NULL )
+   {
+      *lastFrame = s_lastFrame;
+   }
+
+   if ( total != NULL )
+   {
+      *total = s_total;
+   }
+}
@@ -0,0 +1,373 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESTrace.c
+//
+//    Scoped CPU tracing.  Each thread records completed scopes into its own
+//    ring buffer without locking; the buffers are written out as a
+//    chrome://tracing / Perfetto compatible JSON file.  The ring holds a
+//    fixed number of events, not frames, so how many frames a dump covers
+//    depends on how many scopes each frame records.  Nothing is allocated
+//    or recorded unless a trace file was requested.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+///
+//  Macros
+//
+// About 490 KB per thread with the startup events
+#define TRACE_RING_EVENTS       16384
+#define TRACE_STARTUP_EVENTS    4096
+#define TRACE_MAX_DEPTH         32
+#define TRACE_MAX_HITCH_DUMPS   8
+
+#ifdef _MSC_VER
+#define ES_THREAD_LOCAL                 __declspec(thread)
+#define ES_MEMORY_BARRIER()             MemoryBarrier()
+#define ES_CAS_POINTER(dst, old, new)   ( InterlockedCompareExchangePointer ( ( PVOID * ) ( dst ), ( new ), ( old ) ) == ( old ) )
+#else
+#define ES_THREAD_LOCAL                 __thread
+#define ES_MEMORY_BARRIER()             __sync_synchronize()
+#define ES_CAS_POINTER(dst, old, new)   __sync_bool_compare_and_swap ( ( dst ), ( old ), ( new ) )
+#endif
+
+///
+//  Types
+//
+typedef struct
+{
+   const char *name;
+   double      begin;
+   double      duration;
+} TraceEvent;
+
+typedef struct TraceBuffer TraceBuffer;
+
+struct TraceBuffer
+{
+   // Events recorded before the first frame, kept for the whole run
+   TraceEvent   startup[TRACE_STARTUP_EVENTS];
+   int          numStartup;
+
+   // Most recent events after the first frame, oldest overwritten first
+   TraceEvent   ring[TRACE_RING_EVENTS];
+   unsigned int ringHead;
+
+   // Open scopes of this thread
+   const char  *stackName[TRACE_MAX_DEPTH];
+   double       stackBegin[TRACE_MAX_DEPTH];
+   int          depth;
+
+   int          threadId;
+   TraceBuffer *next;
+};
+
+///
+//  Module state
+//
+static TraceBuffer *volatile s_buffers = NULL;
+static ES_THREAD_LOCAL TraceBuffer *s_threadBuffer = NULL;
+static volatile int s_frameStarted = 0;
+static int s_enabled = 0;
+static double s_timeOrigin = 0.0;
+static const char *s_traceFile = NULL;
+static double s_hitchThreshold = 0.0;
+static int s_frameNumber = 0;
+static int s_numHitchDumps = 0;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// GetThreadBuffer()
+//
+//    Return the trace buffer of the calling thread, creating and
+//    registering it on first use
+//
+static TraceBuffer *GetThreadBuffer ( void )
+{
+   TraceBuffer *buffer = s_threadBuffer;
+   TraceBuffer *head;
+
+   if ( buffer != NULL )
+   {
+      return buffer;
+   }
+
+   buffer = calloc ( 1, sizeof ( TraceBuffer ) );
+
+   if ( buffer == NULL )
+   {
+      return NULL;
+   }
+
+   do
+   {
+      head = s_buffers;
+      buffer->threadId = head != NULL ? head->threadId + 1 : 1;
+      buffer->next = head;
+   }
+   while ( !ES_CAS_POINTER ( &s_buffers, head, buffer ) );
+
+   s_threadBuffer = buffer;
+   return buffer;
+}
+
+///
+// WriteEvent()
+//
+static void WriteEvent ( FILE *fp, const TraceEvent *event, int threadId, int *first )
+{
+   const char *c;
+
+   fprintf ( fp, "%s\n{\"name\":\"", *first ? "" : "," );
+
+   for ( c = event->name; *c != '\0'; c++ )
+   {
+      if ( *c == '"' || *c == '\\' )
+      {
+         fputc ( '\\', fp );
+      }
+
+      fputc ( *c, fp );
+   }
+
+   fprintf ( fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+             threadId, ( event->begin - s_timeOrigin ) * 1e6, event->duration * 1e6 );
+   *first = 0;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esTraceInit()
+//
+//      Read --trace FILE (ES_TRACE) and --trace-hitch-ms T (ES_TRACE_HITCH_MS)
+//
+void ESUTIL_API esTraceInit ( int argc, char *argv[] )
+{
+   const char *value;
+
+   s_timeOrigin = esGetTime();
+   s_traceFile = esGetOption ( argc, argv, "--trace", "ES_TRACE" );
+   s_enabled = s_traceFile != NULL;
+
+   if ( ( value = esGetOption ( argc, argv, "--trace-hitch-ms", "ES_TRACE_HITCH_MS" ) ) != NULL )
+   {
+      s_hitchThreshold = atof ( value ) * 1e-3;
+   }
+}
+
+///
+//  esTraceBegin()
+//
+//      Open a scope on the calling thread
+//
+void ESUTIL_API esTraceBegin ( const char *name )
+{
+   TraceBuffer *buffer;
+
+   // Threads only get a buffer once tracing is on
+   if ( !s_enabled || ( buffer = GetThreadBuffer() ) == NULL )
+   {
+      return;
+   }
+
+   if ( buffer->depth < TRACE_MAX_DEPTH )
+   {
+      buffer->stackName[buffer->depth] = name;
+      buffer->stackBegin[buffer->depth] = esGetTime();
+   }
+
+   buffer->depth++;
+}
+
+///
+//  esTraceEnd()
+//
+//      Close the innermost scope of the calling thread and record it
+//
+void ESUTIL_API esTraceEnd ( void )
+{
+   TraceBuffer *buffer = s_threadBuffer;
+   TraceEvent *event;
+
+   if ( buffer == NULL || buffer->depth == 0 )
+   {
+      return;
+   }
+
+   buffer->depth--;
+
+   if ( buffer->depth >= TRACE_MAX_DEPTH )
+   {
+      return;
+   }
+
+   if ( !s_frameStarted )
+   {
+      if ( buffer->numStartup >= TRACE_STARTUP_EVENTS )
+      {
+         return;
+      }
+
+      event = &buffer->startup[buffer->numStartup];
+   }
+   else
+   {
+      event = &buffer->ring[buffer->ringHead % TRACE_RING_EVENTS];
+   }
+
+   event->name = buffer->stackName[buffer->depth];
+   event->begin = buffer->stackBegin[buffer->depth];
+   event->duration = esGetTime() - event->begin;
+
+   // Publish the event before advancing the count a dump reads
+   ES_MEMORY_BARRIER();
+
+   if ( !s_frameStarted )
+   {
+      buffer->numStartup++;
+   }
+   else
+   {
+      buffer->ringHead++;
+   }
+}
+
+///
+//  esTraceFrame()
+//
+//      Mark the end of a frame.  Startup recording stops at the first frame
+//      and a frame longer than the hitch threshold dumps the trace.
+//
+void ESUTIL_API esTraceFrame ( double frameSeconds )
+{
+   s_frameStarted = 1;
+   s_frameNumber++;
+
+   if ( s_traceFile != NULL && s_hitchThreshold > 0.0 && frameSeconds > s_hitchThreshold &&
+         s_numHitchDumps < TRACE_MAX_HITCH_DUMPS )
+   {
+      char fileName[1024];
+
+      snprintf ( fileName, sizeof ( fileName ), "%s.hitch%d.json", s_traceFile, s_frameNumber );
+      esLogMessage ( "esTrace: frame %d took %.2f ms, writing %s\n", s_frameNumber, frameSeconds * 1e3, fileName );
+      esTraceDump ( fileName );
+      s_numHitchDumps++;
+   }
+}
+
+///
+//  esTraceDump()
+//
+//      Write all recorded events as chrome://tracing JSON
+//
+GLboolean ESUTIL_API esTraceDump ( const char *fileName )
+{
+   FILE *fp;
+   TraceBuffer *buffer;
+   int first = 1;
+
+   if ( fileName == NULL )
+   {
+      fileName = s_traceFile;
+   }
+
+   if ( fileName == NULL || ( fp = fopen ( fileName, "w" ) ) == NULL )
+   {
+      esLogMessage ( "esTraceDump FAILED to open : { %s }\n", fileName ? fileName : "(null)" );
+      return GL_FALSE;
+   }
+
+   fprintf ( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+   for ( buffer = s_buffers; buffer != NULL; buffer = buffer->next )
+   {
+      int numStartup = buffer->numStartup;
+      unsigned int head = buffer->ringHead;
+      unsigned int i = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+      int j;
+
+      ES_MEMORY_BARRIER();
+
+      fprintf ( fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", buffer->threadId, buffer->threadId == 1 ? "main" : "worker" );
+      first = 0;
+
+      for ( j = 0; j < numStartup; j++ )
+      {
+         WriteEvent ( fp, &buffer->startup[j], buffer->threadId, &first );
+      }
+
+      for ( ; i < head; i++ )
+      {
+         WriteEvent ( fp, &buffer->ring[i % TRACE_RING_EVENTS], buffer->threadId, &first );
+      }
+   }
+
+   fprintf ( fp, "\n]}\n" );
+   fclose ( fp );
+
+   return GL_TRUE;
+}
+
+///
+//  esTraceShutdown()
+//
+//      Write the trace file requested with --trace, if any
+//
+void ESUTIL_API esTraceShutdown ( void )
+{
+   if ( s_traceFile != NULL )
+   {
+      esTraceDump ( s_traceFile );
+   }
+}
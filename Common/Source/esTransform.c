@@ -45,6 +45,82 @@
 
 #define PI 3.1415926535897932384626433832795f
 
+// A row of an ESMatrix is four floats, so one 128-bit register holds it.  SSE2 is
+// part of every x86-64 target and NEON is enabled per ABI, so the choice is made
+// at build time.  Define ES_NO_SIMD to use the scalar path.
+#if !defined ( ES_NO_SIMD ) && ( defined ( __SSE2__ ) || defined ( _M_X64 ) || \
+                                 ( defined ( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define ES_MATRIX_SSE
+#include <xmmintrin.h>
+#elif !defined ( ES_NO_SIMD ) && ( defined ( __ARM_NEON ) || defined ( __ARM_NEON__ ) )
+#define ES_MATRIX_NEON
+#include <arm_neon.h>
+#endif
+
+///
+// MultiplyRows()
+//
+//    result[i] = srcA[i] * srcB for count matrices.  Each row of a product is
+//    the rows of srcB weighted by the same row of srcA, summed in the same
+//    order as the scalar path so both give identical results.  srcB is read
+//    once up front and a row of srcA is read before its result row is
+//    written, so result may alias either input.
+//
+static void MultiplyRows ( GLfloat *result, const GLfloat *srcA, const GLfloat *srcB, GLsizei count )
+{
+   GLsizei rows = count * 4;
+   GLsizei i;
+
+#if defined ( ES_MATRIX_SSE )
+   __m128 b0 = _mm_loadu_ps ( srcB + 0 );
+   __m128 b1 = _mm_loadu_ps ( srcB + 4 );
+   __m128 b2 = _mm_loadu_ps ( srcB + 8 );
+   __m128 b3 = _mm_loadu_ps ( srcB + 12 );
+
+   for ( i = 0; i < rows; i++, srcA += 4, result += 4 )
+   {
+      // One load and four shuffles rather than four scalar loads and broadcasts
+      __m128 a = _mm_loadu_ps ( srcA );
+      __m128 row = _mm_mul_ps ( _mm_shuffle_ps ( a, a, _MM_SHUFFLE ( 0, 0, 0, 0 ) ), b0 );
+
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_shuffle_ps ( a, a, _MM_SHUFFLE ( 1, 1, 1, 1 ) ), b1 ) );
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_shuffle_ps ( a, a, _MM_SHUFFLE ( 2, 2, 2, 2 ) ), b2 ) );
+      row = _mm_add_ps ( row, _mm_mul_ps ( _mm_shuffle_ps ( a, a, _MM_SHUFFLE ( 3, 3, 3, 3 ) ), b3 ) );
+      _mm_storeu_ps ( result, row );
+   }
+#elif defined ( ES_MATRIX_NEON )
+   float32x4_t b0 = vld1q_f32 ( srcB + 0 );
+   float32x4_t b1 = vld1q_f32 ( srcB + 4 );
+   float32x4_t b2 = vld1q_f32 ( srcB + 8 );
+   float32x4_t b3 = vld1q_f32 ( srcB + 12 );
+
+   for ( i = 0; i < rows; i++, srcA += 4, result += 4 )
+   {
+      // Separate multiply and add, a fused multiply-add would round differently
+      float32x4_t row = vmulq_n_f32 ( b0, srcA[0] );
+
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b1, srcA[1] ) );
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b2, srcA[2] ) );
+      row = vaddq_f32 ( row, vmulq_n_f32 ( b3, srcA[3] ) );
+      vst1q_f32 ( result, row );
+   }
+#else
+   GLfloat b[16];
+
+   memcpy ( b, srcB, sizeof ( b ) );
+
+   for ( i = 0; i < rows; i++, srcA += 4, result += 4 )
+   {
+      GLfloat a0 = srcA[0], a1 = srcA[1], a2 = srcA[2], a3 = srcA[3];
+
+      result[0] = ( a0 * b[0] ) + ( a1 * b[4] ) + ( a2 * b[8] )  + ( a3 * b[12] );
+      result[1] = ( a0 * b[1] ) + ( a1 * b[5] ) + ( a2 * b[9] )  + ( a3 * b[13] );
+      result[2] = ( a0 * b[2] ) + ( a1 * b[6] ) + ( a2 * b[10] ) + ( a3 * b[14] );
+      result[3] = ( a0 * b[3] ) + ( a1 * b[7] ) + ( a2 * b[11] ) + ( a3 * b[15] );
+   }
+#endif
+}
+
 void ESUTIL_API
 esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
 {
@@ -73,58 +149,82 @@ esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz )
    result->m[3][3] += ( result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz );
 }
 
+///
+// RotationMatrix()
+//
+//    3x3 rotation about the axis ( x, y, z ), GL_FALSE for a zero axis
+//
+static GLboolean RotationMatrix ( GLfloat rot[3][3], GLfloat sinAngle, GLfloat cosAngle,
+                                  GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat mag = sqrtf ( x * x + y * y + z * z );
+   GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
+   GLfloat oneMinusCos;
+
+   if ( mag <= 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   x /= mag;
+   y /= mag;
+   z /= mag;
+
+   xx = x * x;
+   yy = y * y;
+   zz = z * z;
+   xy = x * y;
+   yz = y * z;
+   zx = z * x;
+   xs = x * sinAngle;
+   ys = y * sinAngle;
+   zs = z * sinAngle;
+   oneMinusCos = 1.0f - cosAngle;
+
+   rot[0][0] = ( oneMinusCos * xx ) + cosAngle;
+   rot[0][1] = ( oneMinusCos * xy ) - zs;
+   rot[0][2] = ( oneMinusCos * zx ) + ys;
+
+   rot[1][0] = ( oneMinusCos * xy ) + zs;
+   rot[1][1] = ( oneMinusCos * yy ) + cosAngle;
+   rot[1][2] = ( oneMinusCos * yz ) - xs;
+
+   rot[2][0] = ( oneMinusCos * zx ) - ys;
+   rot[2][1] = ( oneMinusCos * yz ) + xs;
+   rot[2][2] = ( oneMinusCos * zz ) + cosAngle;
+
+   return GL_TRUE;
+}
+
 void ESUTIL_API
 esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
 {
-   GLfloat sinAngle, cosAngle;
-   GLfloat mag = sqrtf ( x * x + y * y + z * z );
+   esRotateSinCos ( result, sinf ( angle * PI / 180.0f ), cosf ( angle * PI / 180.0f ), x, y, z );
+}
 
-   sinAngle = sinf ( angle * PI / 180.0f );
-   cosAngle = cosf ( angle * PI / 180.0f );
+void ESUTIL_API
+esRotateSinCos ( ESMatrix *result, GLfloat sinAngle, GLfloat cosAngle, GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat rot[3][3];
+   GLfloat tmp[3][4];
+   int     i;
 
-   if ( mag > 0.0f )
+   if ( !RotationMatrix ( rot, sinAngle, cosAngle, x, y, z ) )
    {
-      GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
-      GLfloat oneMinusCos;
-      ESMatrix rotMat;
-
-      x /= mag;
-      y /= mag;
-      z /= mag;
-
-      xx = x * x;
-      yy = y * y;
-      zz = z * z;
-      xy = x * y;
-      yz = y * z;
-      zx = z * x;
-      xs = x * sinAngle;
-      ys = y * sinAngle;
-      zs = z * sinAngle;
-      oneMinusCos = 1.0f - cosAngle;
-
-      rotMat.m[0][0] = ( oneMinusCos * xx ) + cosAngle;
-      rotMat.m[0][1] = ( oneMinusCos * xy ) - zs;
-      rotMat.m[0][2] = ( oneMinusCos * zx ) + ys;
-      rotMat.m[0][3] = 0.0F;
-
-      rotMat.m[1][0] = ( oneMinusCos * xy ) + zs;
-      rotMat.m[1][1] = ( oneMinusCos * yy ) + cosAngle;
-      rotMat.m[1][2] = ( oneMinusCos * yz ) - xs;
-      rotMat.m[1][3] = 0.0F;
-
-      rotMat.m[2][0] = ( oneMinusCos * zx ) - ys;
-      rotMat.m[2][1] = ( oneMinusCos * yz ) + xs;
-      rotMat.m[2][2] = ( oneMinusCos * zz ) + cosAngle;
-      rotMat.m[2][3] = 0.0F;
-
-      rotMat.m[3][0] = 0.0F;
-      rotMat.m[3][1] = 0.0F;
-      rotMat.m[3][2] = 0.0F;
-      rotMat.m[3][3] = 1.0F;
-
-      esMatrixMultiply ( result, &rotMat, result );
+      return;
    }
+
+   // The rotation is affine, so only the first three rows of result change and
+   // each is a sum of three rows rather than four
+   for ( i = 0; i < 3; i++ )
+   {
+      tmp[i][0] = ( rot[i][0] * result->m[0][0] ) + ( rot[i][1] * result->m[1][0] ) + ( rot[i][2] * result->m[2][0] );
+      tmp[i][1] = ( rot[i][0] * result->m[0][1] ) + ( rot[i][1] * result->m[1][1] ) + ( rot[i][2] * result->m[2][1] );
+      tmp[i][2] = ( rot[i][0] * result->m[0][2] ) + ( rot[i][1] * result->m[1][2] ) + ( rot[i][2] * result->m[2][2] );
+      tmp[i][3] = ( rot[i][0] * result->m[0][3] ) + ( rot[i][1] * result->m[1][3] ) + ( rot[i][2] * result->m[2][3] );
+   }
+
+   memcpy ( result, tmp, sizeof ( tmp ) );
 }
 
 void ESUTIL_API
@@ -198,33 +298,16 @@ esOrtho ( ESMatrix *result, float left, float right, float bottom, float top, fl
 void ESUTIL_API
 esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
 {
-   ESMatrix    tmp;
-   int         i;
+   MultiplyRows ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0], 1 );
+}
 
-   for ( i = 0; i < 4; i++ )
+void ESUTIL_API
+esMatrixMultiplyBatch ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, GLsizei count )
+{
+   if ( count > 0 )
    {
-      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
-                     ( srcA->m[i][1] * srcB->m[1][0] ) +
-                     ( srcA->m[i][2] * srcB->m[2][0] ) +
-                     ( srcA->m[i][3] * srcB->m[3][0] ) ;
-
-      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
-                     ( srcA->m[i][1] * srcB->m[1][1] ) +
-                     ( srcA->m[i][2] * srcB->m[2][1] ) +
-                     ( srcA->m[i][3] * srcB->m[3][1] ) ;
-
-      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
-                     ( srcA->m[i][1] * srcB->m[1][2] ) +
-                     ( srcA->m[i][2] * srcB->m[2][2] ) +
-                     ( srcA->m[i][3] * srcB->m[3][2] ) ;
-
-      tmp.m[i][3] =  ( srcA->m[i][0] * srcB->m[0][3] ) +
-                     ( srcA->m[i][1] * srcB->m[1][3] ) +
-                     ( srcA->m[i][2] * srcB->m[2][3] ) +
-                     ( srcA->m[i][3] * srcB->m[3][3] ) ;
+      MultiplyRows ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0], count );
    }
-
-   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
 }
 
 
@@ -312,3 +395,356 @@ esMatrixLookAt ( ESMatrix *result,
    result->m[3][2] =  axisZ[0] * posX + axisZ[1] * posY + axisZ[2] * posZ;
    result->m[3][3] = 1.0f;
 }
+
+void ESUTIL_API
+esAffineLoadIdentity ( ESAffine *result )
+{
+   memset ( result, 0x0, sizeof ( ESAffine ) );
+   result->m[0][0] = 1.0f;
+   result->m[1][1] = 1.0f;
+   result->m[2][2] = 1.0f;
+}
+
+void ESUTIL_API
+esAffineScale ( ESAffine *result, GLfloat sx, GLfloat sy, GLfloat sz )
+{
+   result->m[0][0] *= sx;
+   result->m[0][1] *= sx;
+   result->m[0][2] *= sx;
+
+   result->m[1][0] *= sy;
+   result->m[1][1] *= sy;
+   result->m[1][2] *= sy;
+
+   result->m[2][0] *= sz;
+   result->m[2][1] *= sz;
+   result->m[2][2] *= sz;
+}
+
+void ESUTIL_API
+esAffineTranslate ( ESAffine *result, GLfloat tx, GLfloat ty, GLfloat tz )
+{
+   result->m[3][0] += ( result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz );
+   result->m[3][1] += ( result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz );
+   result->m[3][2] += ( result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz );
+}
+
+void ESUTIL_API
+esAffineRotate ( ESAffine *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+   esAffineRotateSinCos ( result, sinf ( angle * PI / 180.0f ), cosf ( angle * PI / 180.0f ), x, y, z );
+}
+
+void ESUTIL_API
+esAffineRotateSinCos ( ESAffine *result, GLfloat sinAngle, GLfloat cosAngle, GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat rot[3][3];
+   GLfloat src[3][3];
+   int     i;
+
+   if ( !RotationMatrix ( rot, sinAngle, cosAngle, x, y, z ) )
+   {
+      return;
+   }
+
+   memcpy ( src, result->m, sizeof ( src ) );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      result->m[i][0] = ( rot[i][0] * src[0][0] ) + ( rot[i][1] * src[1][0] ) + ( rot[i][2] * src[2][0] );
+      result->m[i][1] = ( rot[i][0] * src[0][1] ) + ( rot[i][1] * src[1][1] ) + ( rot[i][2] * src[2][1] );
+      result->m[i][2] = ( rot[i][0] * src[0][2] ) + ( rot[i][1] * src[1][2] ) + ( rot[i][2] * src[2][2] );
+   }
+}
+
+void ESUTIL_API
+esAffineMultiply ( ESAffine *result, const ESAffine *srcA, const ESAffine *srcB )
+{
+   ESAffine    tmp;
+   int         i;
+
+   // The implied last column of both is ( 0, 0, 0, 1 ), so the translation row
+   // of srcA picks up the translation of srcB and the other rows do not
+   for ( i = 0; i < 4; i++ )
+   {
+      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
+                     ( srcA->m[i][1] * srcB->m[1][0] ) +
+                     ( srcA->m[i][2] * srcB->m[2][0] );
+
+      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
+                     ( srcA->m[i][1] * srcB->m[1][1] ) +
+                     ( srcA->m[i][2] * srcB->m[2][1] );
+
+      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
+                     ( srcA->m[i][1] * srcB->m[1][2] ) +
+                     ( srcA->m[i][2] * srcB->m[2][2] );
+   }
+
+   tmp.m[3][0] += srcB->m[3][0];
+   tmp.m[3][1] += srcB->m[3][1];
+   tmp.m[3][2] += srcB->m[3][2];
+
+   memcpy ( result, &tmp, sizeof ( ESAffine ) );
+}
+
+GLboolean ESUTIL_API
+esAffineInverse ( ESAffine *result, const ESAffine *src )
+{
+   ESAffine    tmp;
+   GLfloat     det;
+   int         i;
+
+   // Inverse of the 3x3 part from its cofactors
+   tmp.m[0][0] = src->m[1][1] * src->m[2][2] - src->m[1][2] * src->m[2][1];
+   tmp.m[0][1] = src->m[0][2] * src->m[2][1] - src->m[0][1] * src->m[2][2];
+   tmp.m[0][2] = src->m[0][1] * src->m[1][2] - src->m[0][2] * src->m[1][1];
+
+   tmp.m[1][0] = src->m[1][2] * src->m[2][0] - src->m[1][0] * src->m[2][2];
+   tmp.m[1][1] = src->m[0][0] * src->m[2][2] - src->m[0][2] * src->m[2][0];
+   tmp.m[1][2] = src->m[0][2] * src->m[1][0] - src->m[0][0] * src->m[1][2];
+
+   tmp.m[2][0] = src->m[1][0] * src->m[2][1] - src->m[1][1] * src->m[2][0];
+   tmp.m[2][1] = src->m[0][1] * src->m[2][0] - src->m[0][0] * src->m[2][1];
+   tmp.m[2][2] = src->m[0][0] * src->m[1][1] - src->m[0][1] * src->m[1][0];
+
+   det = src->m[0][0] * tmp.m[0][0] + src->m[0][1] * tmp.m[1][0] + src->m[0][2] * tmp.m[2][0];
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < 3; i++ )
+   {
+      tmp.m[i][0] /= det;
+      tmp.m[i][1] /= det;
+      tmp.m[i][2] /= det;
+   }
+
+   // p' = p * L + t, so p = ( p' - t ) * inverse ( L )
+   tmp.m[3][0] = - ( src->m[3][0] * tmp.m[0][0] + src->m[3][1] * tmp.m[1][0] + src->m[3][2] * tmp.m[2][0] );
+   tmp.m[3][1] = - ( src->m[3][0] * tmp.m[0][1] + src->m[3][1] * tmp.m[1][1] + src->m[3][2] * tmp.m[2][1] );
+   tmp.m[3][2] = - ( src->m[3][0] * tmp.m[0][2] + src->m[3][1] * tmp.m[1][2] + src->m[3][2] * tmp.m[2][2] );
+
+   memcpy ( result, &tmp, sizeof ( ESAffine ) );
+
+   return GL_TRUE;
+}
+
+void ESUTIL_API
+esAffineToMatrix ( ESMatrix *result, const ESAffine *src )
+{
+   int         i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      result->m[i][0] = src->m[i][0];
+      result->m[i][1] = src->m[i][1];
+      result->m[i][2] = src->m[i][2];
+      result->m[i][3] = 0.0f;
+   }
+
+   result->m[3][3] = 1.0f;
+}
+
+void ESUTIL_API
+esMatrixMultiplyAffine ( ESMatrix *result, const ESAffine *srcA, const ESMatrix *srcB )
+{
+   ESMatrix    tmp;
+   int         i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
+                     ( srcA->m[i][1] * srcB->m[1][0] ) +
+                     ( srcA->m[i][2] * srcB->m[2][0] );
+
+      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
+                     ( srcA->m[i][1] * srcB->m[1][1] ) +
+                     ( srcA->m[i][2] * srcB->m[2][1] );
+
+      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
+                     ( srcA->m[i][1] * srcB->m[1][2] ) +
+                     ( srcA->m[i][2] * srcB->m[2][2] );
+
+      tmp.m[i][3] =  ( srcA->m[i][0] * srcB->m[0][3] ) +
+                     ( srcA->m[i][1] * srcB->m[1][3] ) +
+                     ( srcA->m[i][2] * srcB->m[2][3] );
+   }
+
+   // Only the translation row of srcA has the implied 1 in the last column
+   tmp.m[3][0] += srcB->m[3][0];
+   tmp.m[3][1] += srcB->m[3][1];
+   tmp.m[3][2] += srcB->m[3][2];
+   tmp.m[3][3] += srcB->m[3][3];
+
+   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+}
+
+GLboolean ESUTIL_API
+esMatrixInverse ( ESMatrix *result, const ESMatrix *src )
+{
+   const GLfloat ( *m )[4] = src->m;
+   GLfloat     s[6], c[6];
+   GLfloat     det;
+   ESMatrix    tmp;
+   int         i;
+
+   // 2x2 determinants of the top two and bottom two rows.  Every cofactor is a
+   // sum of three products of these, which keeps the expansion short and in a
+   // form that vectorizes.
+   s[0] = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+   s[1] = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+   s[2] = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+   s[3] = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+   s[4] = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+   s[5] = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+   c[0] = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+   c[1] = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+   c[2] = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+   c[3] = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+   c[4] = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+   c[5] = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+   det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   tmp.m[0][0] =   m[1][1] * c[5] - m[1][2] * c[4] + m[1][3] * c[3];
+   tmp.m[0][1] = - m[0][1] * c[5] + m[0][2] * c[4] - m[0][3] * c[3];
+   tmp.m[0][2] =   m[3][1] * s[5] - m[3][2] * s[4] + m[3][3] * s[3];
+   tmp.m[0][3] = - m[2][1] * s[5] + m[2][2] * s[4] - m[2][3] * s[3];
+
+   tmp.m[1][0] = - m[1][0] * c[5] + m[1][2] * c[2] - m[1][3] * c[1];
+   tmp.m[1][1] =   m[0][0] * c[5] - m[0][2] * c[2] + m[0][3] * c[1];
+   tmp.m[1][2] = - m[3][0] * s[5] + m[3][2] * s[2] - m[3][3] * s[1];
+   tmp.m[1][3] =   m[2][0] * s[5] - m[2][2] * s[2] + m[2][3] * s[1];
+
+   tmp.m[2][0] =   m[1][0] * c[4] - m[1][1] * c[2] + m[1][3] * c[0];
+   tmp.m[2][1] = - m[0][0] * c[4] + m[0][1] * c[2] - m[0][3] * c[0];
+   tmp.m[2][2] =   m[3][0] * s[4] - m[3][1] * s[2] + m[3][3] * s[0];
+   tmp.m[2][3] = - m[2][0] * s[4] + m[2][1] * s[2] - m[2][3] * s[0];
+
+   tmp.m[3][0] = - m[1][0] * c[3] + m[1][1] * c[1] - m[1][2] * c[0];
+   tmp.m[3][1] =   m[0][0] * c[3] - m[0][1] * c[1] + m[0][2] * c[0];
+   tmp.m[3][2] = - m[3][0] * s[3] + m[3][1] * s[1] - m[3][2] * s[0];
+   tmp.m[3][3] =   m[2][0] * s[3] - m[2][1] * s[1] + m[2][2] * s[0];
+
+   det = 1.0f / det;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      tmp.m[i][0] *= det;
+      tmp.m[i][1] *= det;
+      tmp.m[i][2] *= det;
+      tmp.m[i][3] *= det;
+   }
+
+   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+
+   return GL_TRUE;
+}
+
+GLboolean ESUTIL_API
+esMatrixInverseAffine ( ESMatrix *result, const ESMatrix *src )
+{
+   ESAffine    affine;
+   int         i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      affine.m[i][0] = src->m[i][0];
+      affine.m[i][1] = src->m[i][1];
+      affine.m[i][2] = src->m[i][2];
+   }
+
+   if ( !esAffineInverse ( &affine, &affine ) )
+   {
+      return GL_FALSE;
+   }
+
+   esAffineToMatrix ( result, &affine );
+
+   return GL_TRUE;
+}
+
+GLboolean ESUTIL_API
+esMatrixNormal3x3 ( GLfloat result[3][3], const ESMatrix *src )
+{
+   const GLfloat ( *m )[4] = src->m;
+   GLfloat     cof[3][3];
+   GLfloat     det;
+   int         i;
+
+   // The inverse transpose is the cofactor matrix over the determinant
+   cof[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+   cof[0][1] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+   cof[0][2] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+   cof[1][0] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+   cof[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+   cof[1][2] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+
+   cof[2][0] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+   cof[2][1] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+   cof[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+   det = m[0][0] * cof[0][0] + m[0][1] * cof[0][1] + m[0][2] * cof[0][2];
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   det = 1.0f / det;
+
+   for ( i = 0; i < 3; i++ )
+   {
+      result[i][0] = cof[i][0] * det;
+      result[i][1] = cof[i][1] * det;
+      result[i][2] = cof[i][2] * det;
+   }
+
+   return GL_TRUE;
+}
+
+void ESUTIL_API
+esFrustumPlanesFromMatrix ( GLfloat planes[ES_PLANE_COUNT][4], const ESMatrix *src )
+{
+   int         i;
+
+   // A point is transformed as a row vector, so clip x, y, z and w are the dot
+   // products with the columns of src.  Inside means -w <= x, y, z <= w.
+   for ( i = 0; i < 4; i++ )
+   {
+      GLfloat x = src->m[i][0];
+      GLfloat y = src->m[i][1];
+      GLfloat z = src->m[i][2];
+      GLfloat w = src->m[i][3];
+
+      planes[ES_PLANE_LEFT][i]   = w + x;
+      planes[ES_PLANE_RIGHT][i]  = w - x;
+      planes[ES_PLANE_BOTTOM][i] = w + y;
+      planes[ES_PLANE_TOP][i]    = w - y;
+      planes[ES_PLANE_NEAR][i]   = w + z;
+      planes[ES_PLANE_FAR][i]    = w - z;
+   }
+
+   for ( i = 0; i < ES_PLANE_COUNT; i++ )
+   {
+      GLfloat length = sqrtf ( planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+                               planes[i][2] * planes[i][2] );
+
+      if ( length > 0.0f )
+      {
+         planes[i][0] /= length;
+         planes[i][1] /= length;
+         planes[i][2] /= length;
+         planes[i][3] /= length;
+      }
+   }
+}
@@ -0,0 +1,332 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESUniformRing.c
+//
+//    Uniform buffer ring.  One buffer is split into per-frame regions;
+//    each frame maps its region unsynchronized, sub-allocates uniform
+//    blocks at the offset alignment the implementation requires and binds
+//    them with glBindBufferRange().  A fence per region keeps the CPU from
+//    overwriting data the GPU has not read yet.  std140 helpers lay out
+//    the block members.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+//  Macros
+//
+#define ALIGN(x, a)   ( ( ( x ) + ( a ) - 1 ) / ( a ) * ( a ) )
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Std140Write()
+//
+//    Place a member of the given alignment and size, copying data if the
+//    block has a destination.  A NULL value only advances the layout.
+//
+static GLsizeiptr Std140Write ( ESStd140 *block, GLsizeiptr alignment, const void *data, GLsizeiptr size )
+{
+   GLsizeiptr offset = ALIGN ( block->offset, alignment );
+
+   if ( block->data != NULL && data != NULL )
+   {
+      memcpy ( block->data + offset, data, size );
+   }
+
+   block->offset = offset + size;
+
+   return offset;
+}
+
+///
+// Std140WriteArray()
+//
+//    Place count elements of components floats each at a stride of 16 bytes
+//
+static GLsizeiptr Std140WriteArray ( ESStd140 *block, const GLfloat *values, GLsizei count, int components )
+{
+   GLsizeiptr offset = ALIGN ( block->offset, 16 );
+   GLsizei i;
+
+   for ( i = 0; i < count; i++ )
+   {
+      block->offset = offset + i * 16;
+      Std140Write ( block, 16, values != NULL ? values + i * components : NULL,
+                    components * sizeof ( GLfloat ) );
+   }
+
+   // The last element is padded to the full stride as well
+   block->offset = offset + count * 16;
+
+   return offset;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esUniformRingInit()
+//
+GLboolean ESUTIL_API esUniformRingInit ( ESUniformRing *ring, GLsizeiptr frameSize, GLuint frameCount )
+{
+   memset ( ring, 0, sizeof ( ESUniformRing ) );
+
+   if ( frameCount == 0 || frameCount > ES_MAX_FRAMES_IN_FLIGHT )
+   {
+      esLogMessage ( "Uniform ring needs 1 to %d frames\n", ES_MAX_FRAMES_IN_FLIGHT );
+      return GL_FALSE;
+   }
+
+   glGetIntegerv ( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ring->alignment );
+
+   if ( ring->alignment <= 0 )
+   {
+      ring->alignment = 256;
+   }
+
+   ring->frameSize = ALIGN ( frameSize, ring->alignment );
+   ring->frameCount = frameCount;
+
+   glGenBuffers ( 1, &ring->bufferId );
+   glBindBuffer ( GL_UNIFORM_BUFFER, ring->bufferId );
+   esMemBufferData ( "uniform ring", GL_UNIFORM_BUFFER, ring->frameSize * frameCount, NULL, GL_DYNAMIC_DRAW );
+   glBindBuffer ( GL_UNIFORM_BUFFER, 0 );
+
+   return ring->bufferId != 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// esUniformRingBegin()
+//
+void ESUTIL_API esUniformRingBegin ( ESUniformRing *ring )
+{
+   GLsync fence;
+
+   // Commands using the previous region have been issued by now
+   if ( ring->started )
+   {
+      ring->fences[ring->frame] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      ring->frame = ( ring->frame + 1 ) % ring->frameCount;
+   }
+
+   ring->started = GL_TRUE;
+   fence = ring->fences[ring->frame];
+
+   if ( fence != NULL )
+   {
+      esTraceBegin ( "uniform ring wait" );
+
+      while ( glClientWaitSync ( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL ) == GL_TIMEOUT_EXPIRED )
+      {
+      }
+
+      esTraceEnd ( );
+      glDeleteSync ( fence );
+      ring->fences[ring->frame] = NULL;
+   }
+
+   // The fence makes synchronization by the driver unnecessary
+   glBindBuffer ( GL_UNIFORM_BUFFER, ring->bufferId );
+   ring->mapped = glMapBufferRange ( GL_UNIFORM_BUFFER, ring->frame * ring->frameSize, ring->frameSize,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                     GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT );
+   glBindBuffer ( GL_UNIFORM_BUFFER, 0 );
+   ring->used = 0;
+}
+
+///
+// esUniformRingAlloc()
+//
+void *ESUTIL_API esUniformRingAlloc ( ESUniformRing *ring, GLsizeiptr size, GLintptr *offset )
+{
+   GLsizeiptr start = ALIGN ( ring->used, ring->alignment );
+
+   if ( ring->mapped == NULL || start + size > ring->frameSize )
+   {
+      esLogMessage ( "Uniform ring region of %ld bytes is full\n", ( long ) ring->frameSize );
+      return NULL;
+   }
+
+   ring->used = start + size;
+   *offset = ring->frame * ring->frameSize + start;
+
+   return ring->mapped + start;
+}
+
+///
+// esUniformRingEnd()
+//
+void ESUTIL_API esUniformRingEnd ( ESUniformRing *ring )
+{
+   if ( ring->mapped == NULL )
+   {
+      return;
+   }
+
+   glBindBuffer ( GL_UNIFORM_BUFFER, ring->bufferId );
+
+   if ( ring->used > 0 )
+   {
+      glFlushMappedBufferRange ( GL_UNIFORM_BUFFER, 0, ring->used );
+   }
+
+   glUnmapBuffer ( GL_UNIFORM_BUFFER );
+   glBindBuffer ( GL_UNIFORM_BUFFER, 0 );
+   ring->mapped = NULL;
+}
+
+///
+// esUniformRingBind()
+//
+void ESUTIL_API esUniformRingBind ( const ESUniformRing *ring, GLuint bindingPoint, GLintptr offset, GLsizeiptr size )
+{
+   glBindBufferRange ( GL_UNIFORM_BUFFER, bindingPoint, ring->bufferId, offset, size );
+}
+
+///
+// esUniformRingFree()
+//
+void ESUTIL_API esUniformRingFree ( ESUniformRing *ring )
+{
+   GLuint i;
+
+   esUniformRingEnd ( ring );
+
+   for ( i = 0; i < ES_MAX_FRAMES_IN_FLIGHT; i++ )
+   {
+      if ( ring->fences[i] != NULL )
+      {
+         glDeleteSync ( ring->fences[i] );
+      }
+   }
+
+   esMemDeleteBuffers ( 1, &ring->bufferId );
+   memset ( ring, 0, sizeof ( ESUniformRing ) );
+}
+
+///
+// esStd140Float()
+//
+GLsizeiptr ESUTIL_API esStd140Float ( ESStd140 *block, GLfloat value )
+{
+   return Std140Write ( block, 4, &value, sizeof ( GLfloat ) );
+}
+
+///
+// esStd140Int()
+//
+GLsizeiptr ESUTIL_API esStd140Int ( ESStd140 *block, GLint value )
+{
+   return Std140Write ( block, 4, &value, sizeof ( GLint ) );
+}
+
+///
+// esStd140Vec2()
+//
+GLsizeiptr ESUTIL_API esStd140Vec2 ( ESStd140 *block, const GLfloat *value )
+{
+   return Std140Write ( block, 8, value, 2 * sizeof ( GLfloat ) );
+}
+
+///
+// esStd140Vec3()
+//
+//    A vec3 is aligned like a vec4, a following scalar can use the fourth component
+//
+GLsizeiptr ESUTIL_API esStd140Vec3 ( ESStd140 *block, const GLfloat *value )
+{
+   return Std140Write ( block, 16, value, 3 * sizeof ( GLfloat ) );
+}
+
+///
+// esStd140Vec4()
+//
+GLsizeiptr ESUTIL_API esStd140Vec4 ( ESStd140 *block, const GLfloat *value )
+{
+   return Std140Write ( block, 16, value, 4 * sizeof ( GLfloat ) );
+}
+
+///
+// esStd140FloatArray()
+//
+GLsizeiptr ESUTIL_API esStd140FloatArray ( ESStd140 *block, const GLfloat *values, GLsizei count )
+{
+   return Std140WriteArray ( block, values, count, 1 );
+}
+
+///
+// esStd140Vec4Array()
+//
+GLsizeiptr ESUTIL_API esStd140Vec4Array ( ESStd140 *block, const GLfloat *values, GLsizei count )
+{
+   return Std140WriteArray ( block, values, count, 4 );
+}
+
+///
+// esStd140Mat3()
+//
+//    Column-major 3x3 matrix, each column padded to a vec4
+//
+GLsizeiptr ESUTIL_API esStd140Mat3 ( ESStd140 *block, const GLfloat *value )
+{
+   return Std140WriteArray ( block, value, 3, 3 );
+}
+
+///
+// esStd140Mat4()
+//
+GLsizeiptr ESUTIL_API esStd140Mat4 ( ESStd140 *block, const ESMatrix *value )
+{
+   return Std140Write ( block, 16, value != NULL ? &value->m[0][0] : NULL, sizeof ( ESMatrix ) );
+}
+
+///
+// esStd140End()
+//
+GLsizeiptr ESUTIL_API esStd140End ( ESStd140 *block )
+{
+   block->offset = ALIGN ( block->offset, 16 );
+
+   return block->offset;
+}
@@ -57,6 +57,12 @@ typedef FILE esFile;
 
 #ifdef __APPLE__
 #include "FileWrapper.h"
+#include <mach/mach_time.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
 #endif
 
 ///
@@ -119,6 +125,61 @@ EGLint GetContextRenderableType ( EGLDisplay eglDisplay )
    // extension is not supported
    return EGL_OPENGL_ES2_BIT;
 }
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA     0x31DD
+#endif
+
+#ifndef EGL_PLATFORM_DEVICE_EXT
+#define EGL_PLATFORM_DEVICE_EXT           0x313F
+#endif
+
+typedef void *ESDeviceEXT;
+typedef EGLBoolean ( EGLAPIENTRYP ESQueryDevicesEXTProc ) ( EGLint maxDevices, ESDeviceEXT *devices, EGLint *numDevices );
+typedef EGLDisplay ( EGLAPIENTRYP ESGetPlatformDisplayEXTProc ) ( EGLenum platform, void *nativeDisplay, const EGLint *attribList );
+
+///
+// GetOffscreenDisplay()
+//
+//    Get an EGL display that does not need a window system.  Prefer the
+//    Mesa surfaceless platform, then the first EGL device, and finally
+//    fall back to the default display.
+//
+static EGLDisplay GetOffscreenDisplay ( void )
+{
+   EGLDisplay display = EGL_NO_DISPLAY;
+   const char *clientExtensions = eglQueryString ( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+   ESGetPlatformDisplayEXTProc getPlatformDisplay =
+      ( ESGetPlatformDisplayEXTProc ) eglGetProcAddress ( "eglGetPlatformDisplayEXT" );
+
+   if ( clientExtensions != NULL && getPlatformDisplay != NULL )
+   {
+      if ( strstr ( clientExtensions, "EGL_MESA_platform_surfaceless" ) )
+      {
+         display = getPlatformDisplay ( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+      }
+
+      if ( display == EGL_NO_DISPLAY && strstr ( clientExtensions, "EGL_EXT_platform_device" ) )
+      {
+         ESQueryDevicesEXTProc queryDevices =
+            ( ESQueryDevicesEXTProc ) eglGetProcAddress ( "eglQueryDevicesEXT" );
+         ESDeviceEXT device;
+         EGLint numDevices = 0;
+
+         if ( queryDevices != NULL && queryDevices ( 1, &device, &numDevices ) && numDevices > 0 )
+         {
+            display = getPlatformDisplay ( EGL_PLATFORM_DEVICE_EXT, device, NULL );
+         }
+      }
+   }
+
+   if ( display == EGL_NO_DISPLAY )
+   {
+      display = eglGetDisplay ( EGL_DEFAULT_DISPLAY );
+   }
+
+   return display;
+}
 #endif
 
 //////////////////////////////////////////////////////////////////
@@ -138,6 +199,9 @@ EGLint GetContextRenderableType ( EGLDisplay eglDisplay )
 //          ES_WINDOW_DEPTH       - specifies that a depth buffer should be created
 //          ES_WINDOW_STENCIL     - specifies that a stencil buffer should be created
 //          ES_WINDOW_MULTISAMPLE - specifies that a multi-sample buffer should be created
+//          ES_WINDOW_OFFSCREEN   - specifies that rendering goes to a pbuffer with no native window
+//          ES_WINDOW_ON_DEMAND   - specifies that frames are only drawn on request, expose or input
+//          ES_WINDOW_RENDER_THREAD - specifies that drawing and swapping run on a render thread
 //
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, GLint width, GLint height, GLuint flags )
 {
@@ -162,12 +226,38 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
    esContext->height = height;
 #endif
 
-   if ( !WinCreate ( esContext, title ) )
+   // Allow headless runs of any sample without changing its code
+   if ( getenv ( "ES_WINDOW_OFFSCREEN" ) != NULL && atoi ( getenv ( "ES_WINDOW_OFFSCREEN" ) ) != 0 )
    {
-      return GL_FALSE;
+      flags |= ES_WINDOW_OFFSCREEN;
+   }
+
+   if ( getenv ( "ES_WINDOW_ON_DEMAND" ) != NULL && atoi ( getenv ( "ES_WINDOW_ON_DEMAND" ) ) != 0 )
+   {
+      flags |= ES_WINDOW_ON_DEMAND;
+   }
+
+   if ( getenv ( "ES_WINDOW_RENDER_THREAD" ) != NULL && atoi ( getenv ( "ES_WINDOW_RENDER_THREAD" ) ) != 0 )
+   {
+      flags |= ES_WINDOW_RENDER_THREAD;
+   }
+
+   esContext->flags = flags;
+
+   if ( flags & ES_WINDOW_OFFSCREEN )
+   {
+      esContext->eglDisplay = GetOffscreenDisplay ( );
+   }
+   else
+   {
+      if ( !WinCreate ( esContext, title ) )
+      {
+         return GL_FALSE;
+      }
+
+      esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
    }
 
-   esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
    if ( esContext->eglDisplay == EGL_NO_DISPLAY )
    {
       return GL_FALSE;
@@ -190,6 +280,7 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
          EGL_DEPTH_SIZE,     ( flags & ES_WINDOW_DEPTH ) ? 8 : EGL_DONT_CARE,
          EGL_STENCIL_SIZE,   ( flags & ES_WINDOW_STENCIL ) ? 8 : EGL_DONT_CARE,
          EGL_SAMPLE_BUFFERS, ( flags & ES_WINDOW_MULTISAMPLE ) ? 1 : 0,
+         EGL_SURFACE_TYPE,   ( flags & ES_WINDOW_OFFSCREEN ) ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
          // if EGL_KHR_create_context extension is supported, then we will use
          // EGL_OPENGL_ES3_BIT_KHR instead of EGL_OPENGL_ES2_BIT in the attribute list
          EGL_RENDERABLE_TYPE, GetContextRenderableType ( esContext->eglDisplay ),
@@ -211,6 +302,7 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
 
 #ifdef ANDROID
    // For Android, need to get the EGL_NATIVE_VISUAL_ID and set it using ANativeWindow_setBuffersGeometry
+   if ( !( flags & ES_WINDOW_OFFSCREEN ) )
    {
       EGLint format = 0;
       eglGetConfigAttrib ( esContext->eglDisplay, config, EGL_NATIVE_VISUAL_ID, &format );
@@ -219,8 +311,22 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
 #endif // ANDROID
 
    // Create a surface
-   esContext->eglSurface = eglCreateWindowSurface ( esContext->eglDisplay, config, 
-                                                    esContext->eglNativeWindow, NULL );
+   if ( flags & ES_WINDOW_OFFSCREEN )
+   {
+      EGLint pbufferAttribs[] =
+      {
+         EGL_WIDTH,  esContext->width,
+         EGL_HEIGHT, esContext->height,
+         EGL_NONE
+      };
+
+      esContext->eglSurface = eglCreatePbufferSurface ( esContext->eglDisplay, config, pbufferAttribs );
+   }
+   else
+   {
+      esContext->eglSurface = eglCreateWindowSurface ( esContext->eglDisplay, config, 
+                                                       esContext->eglNativeWindow, NULL );
+   }
 
    if ( esContext->eglSurface == EGL_NO_SURFACE )
    {
@@ -243,6 +349,12 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
       return GL_FALSE;
    }
 
+   // Apply a swap interval requested before the window existed
+   if ( esContext->framePacing.swapIntervalSet )
+   {
+      esSetSwapInterval ( esContext, esContext->framePacing.swapInterval );
+   }
+
 #endif // #ifndef __APPLE__
 
    return GL_TRUE;
@@ -282,6 +394,22 @@ void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
    esContext->keyFunc = keyFunc;
 }
 
+///
+//  esRequestRedraw()
+//
+void ESUTIL_API esRequestRedraw ( ESContext *esContext )
+{
+   // The main loop owns redrawPending, a draw callback on the render thread
+   // hands its request over under the render thread lock
+   if ( esOnRenderThread ( esContext ) )
+   {
+      esRenderThreadRequestRedraw ( esContext );
+      return;
+   }
+
+   esContext->redrawPending = GL_TRUE;
+}
+
 
 ///
 // esLogMessage()
@@ -305,6 +433,63 @@ void ESUTIL_API esLogMessage ( const char *formatStr, ... )
    va_end ( params );
 }
 
+///
+// esGetTime()
+//
+//    Return a monotonic time in seconds.  Only differences between two
+//    values are meaningful.
+//
+double ESUTIL_API esGetTime ( void )
+{
+#ifdef __APPLE__
+   static mach_timebase_info_data_t timebase;
+
+   if ( timebase.denom == 0 )
+   {
+      mach_timebase_info ( &timebase );
+   }
+
+   return ( double ) mach_absolute_time() * timebase.numer / timebase.denom * 1e-9;
+#elif defined(_WIN32)
+   static LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+
+   if ( frequency.QuadPart == 0 )
+   {
+      QueryPerformanceFrequency ( &frequency );
+   }
+
+   QueryPerformanceCounter ( &counter );
+   return ( double ) counter.QuadPart / ( double ) frequency.QuadPart;
+#else
+   struct timespec now;
+
+   clock_gettime ( CLOCK_MONOTONIC, &now );
+   return ( double ) now.tv_sec + ( double ) now.tv_nsec * 1e-9;
+#endif
+}
+
+///
+// esGetOption()
+//
+//    Return the value following a command line option, or the value of
+//    an environment variable if the option is not given
+//
+const char *ESUTIL_API esGetOption ( int argc, char *argv[], const char *option, const char *envName )
+{
+   int i;
+
+   for ( i = 1; i < argc - 1; i++ )
+   {
+      if ( strcmp ( argv[i], option ) == 0 )
+      {
+         return argv[i + 1];
+      }
+   }
+
+   return envName != NULL ? getenv ( envName ) : NULL;
+}
+
 ///
 // esFileRead()
 //
@@ -376,11 +561,11 @@ static int esFileRead ( esFile *pFile, int bytesToRead, void *buffer )
 }
 
 ///
-// esLoadTGA()
+// LoadTGA()
 //
 //    Loads a 8-bit, 24-bit or 32-bit TGA image from a file
 //
-char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
+static char *LoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
 {
    char        *buffer;
    esFile      *fp;
@@ -421,3 +606,19 @@ char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width,
 
    return ( NULL );
 }
+
+///
+// esLoadTGA()
+//
+//    Loads a 8-bit, 24-bit or 32-bit TGA image from a file
+//
+char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
+{
+   char *buffer;
+
+   esTraceBegin ( "esLoadTGA" );
+   buffer = LoadTGA ( ioContext, fileName, width, height );
+   esTraceEnd ( );
+
+   return buffer;
+}
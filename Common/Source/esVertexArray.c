@@ -0,0 +1,330 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESVertexArray.c
+//
+//    Vertex array object cache.  A vertex format and the buffers it reads
+//    from map to a VAO that is built once, so drawing only needs a single
+//    glBindVertexArray() instead of re-specifying every attribute.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Types
+//
+typedef struct
+{
+   GLuint64        hash;
+   ESVertexAttrib *attribs;
+   GLsizei         attribCount;
+   GLuint         *buffers;
+   GLsizei         bufferCount;
+   GLuint          indexBuffer;
+   GLuint          vertexArray;
+} VertexArrayEntry;
+
+///
+//  Module state
+//
+static VertexArrayEntry *s_entries;
+static int               s_entryCount;
+static int               s_entryCapacity;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// HashValue()
+//
+//    Continue a 64-bit FNV-1a hash with a 32-bit value
+//
+static GLuint64 HashValue ( GLuint64 hash, GLuint value )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      hash ^= ( value >> ( i * 8 ) ) & 0xff;
+      hash *= 0x100000001b3ULL;
+   }
+
+   return hash;
+}
+
+///
+// BufferCount()
+//
+//    Number of buffer slots the attributes read from
+//
+static GLsizei BufferCount ( const ESVertexAttrib *attribs, GLsizei attribCount )
+{
+   GLsizei count = 0;
+   GLsizei i;
+
+   for ( i = 0; i < attribCount; i++ )
+   {
+      if ( ( GLsizei ) attribs[i].buffer + 1 > count )
+      {
+         count = attribs[i].buffer + 1;
+      }
+   }
+
+   return count;
+}
+
+///
+// HashKey()
+//
+//    Hash the attributes field by field, their padding is not initialized
+//
+static GLuint64 HashKey ( const ESVertexAttrib *attribs, GLsizei attribCount,
+                          const GLuint *buffers, GLsizei bufferCount, GLuint indexBuffer )
+{
+   GLuint64 hash = 0xcbf29ce484222325ULL;
+   GLsizei i;
+
+   for ( i = 0; i < attribCount; i++ )
+   {
+      hash = HashValue ( hash, attribs[i].index );
+      hash = HashValue ( hash, attribs[i].size );
+      hash = HashValue ( hash, attribs[i].type );
+      hash = HashValue ( hash, attribs[i].normalized );
+      hash = HashValue ( hash, attribs[i].stride );
+      hash = HashValue ( hash, attribs[i].offset );
+      hash = HashValue ( hash, attribs[i].buffer );
+      hash = HashValue ( hash, attribs[i].integer );
+   }
+
+   for ( i = 0; i < bufferCount; i++ )
+   {
+      hash = HashValue ( hash, buffers[i] );
+   }
+
+   return HashValue ( hash, indexBuffer );
+}
+
+///
+// Matches()
+//
+static GLboolean Matches ( const VertexArrayEntry *entry, const ESVertexAttrib *attribs, GLsizei attribCount,
+                           const GLuint *buffers, GLsizei bufferCount, GLuint indexBuffer )
+{
+   GLsizei i;
+
+   if ( entry->attribCount != attribCount || entry->bufferCount != bufferCount ||
+        entry->indexBuffer != indexBuffer )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < attribCount; i++ )
+   {
+      const ESVertexAttrib *a = &entry->attribs[i];
+      const ESVertexAttrib *b = &attribs[i];
+
+      if ( a->index != b->index || a->size != b->size || a->type != b->type ||
+           a->normalized != b->normalized || a->stride != b->stride || a->offset != b->offset ||
+           a->buffer != b->buffer || a->integer != b->integer )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return memcmp ( entry->buffers, buffers, bufferCount * sizeof ( GLuint ) ) == 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// BuildVertexArray()
+//
+//    Create a VAO and specify the attributes.  The array buffer binding is
+//    not VAO state, so it is restored afterwards.
+//
+static GLuint BuildVertexArray ( const ESVertexAttrib *attribs, GLsizei attribCount,
+                                 const GLuint *buffers, GLuint indexBuffer )
+{
+   GLuint vertexArray;
+   GLint arrayBuffer = 0;
+   GLsizei i;
+
+   glGetIntegerv ( GL_ARRAY_BUFFER_BINDING, &arrayBuffer );
+   glGenVertexArrays ( 1, &vertexArray );
+   esBindVertexArray ( vertexArray );
+
+   for ( i = 0; i < attribCount; i++ )
+   {
+      const ESVertexAttrib *attrib = &attribs[i];
+
+      glBindBuffer ( GL_ARRAY_BUFFER, buffers[attrib->buffer] );
+
+      if ( attrib->integer )
+      {
+         glVertexAttribIPointer ( attrib->index, attrib->size, attrib->type, attrib->stride,
+                                  ( const void * ) ( size_t ) attrib->offset );
+      }
+      else
+      {
+         glVertexAttribPointer ( attrib->index, attrib->size, attrib->type, attrib->normalized,
+                                 attrib->stride, ( const void * ) ( size_t ) attrib->offset );
+      }
+
+      glEnableVertexAttribArray ( attrib->index );
+   }
+
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+   glBindBuffer ( GL_ARRAY_BUFFER, arrayBuffer );
+
+   return vertexArray;
+}
+
+///
+// RemoveEntry()
+//
+static void RemoveEntry ( int index )
+{
+   VertexArrayEntry *entry = &s_entries[index];
+
+   esStateDeleteVertexArrays ( 1, &entry->vertexArray );
+   glDeleteVertexArrays ( 1, &entry->vertexArray );
+   free ( entry->attribs );
+   free ( entry->buffers );
+   s_entries[index] = s_entries[--s_entryCount];
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esBindVertexFormat()
+//
+GLuint ESUTIL_API esBindVertexFormat ( const ESVertexAttrib *attribs, GLsizei attribCount,
+                                       const GLuint *buffers, GLuint indexBuffer )
+{
+   GLsizei bufferCount = BufferCount ( attribs, attribCount );
+   GLuint64 hash = HashKey ( attribs, attribCount, buffers, bufferCount, indexBuffer );
+   VertexArrayEntry *entry;
+   int i;
+
+   for ( i = 0; i < s_entryCount; i++ )
+   {
+      if ( s_entries[i].hash == hash &&
+           Matches ( &s_entries[i], attribs, attribCount, buffers, bufferCount, indexBuffer ) )
+      {
+         esBindVertexArray ( s_entries[i].vertexArray );
+         return s_entries[i].vertexArray;
+      }
+   }
+
+   if ( s_entryCount == s_entryCapacity )
+   {
+      int capacity = s_entryCapacity != 0 ? s_entryCapacity * 2 : 16;
+      VertexArrayEntry *entries = realloc ( s_entries, capacity * sizeof ( VertexArrayEntry ) );
+
+      if ( entries == NULL )
+      {
+         return 0;
+      }
+
+      s_entries = entries;
+      s_entryCapacity = capacity;
+   }
+
+   entry = &s_entries[s_entryCount];
+   entry->hash = hash;
+   entry->attribs = malloc ( attribCount * sizeof ( ESVertexAttrib ) + 1 );
+   entry->attribCount = attribCount;
+   entry->buffers = malloc ( bufferCount * sizeof ( GLuint ) + 1 );
+   entry->bufferCount = bufferCount;
+   entry->indexBuffer = indexBuffer;
+
+   if ( entry->attribs == NULL || entry->buffers == NULL )
+   {
+      free ( entry->attribs );
+      free ( entry->buffers );
+      return 0;
+   }
+
+   memcpy ( entry->attribs, attribs, attribCount * sizeof ( ESVertexAttrib ) );
+   memcpy ( entry->buffers, buffers, bufferCount * sizeof ( GLuint ) );
+   entry->vertexArray = BuildVertexArray ( attribs, attribCount, buffers, indexBuffer );
+   s_entryCount++;
+
+   return entry->vertexArray;
+}
+
+///
+// esVertexArrayCacheRemoveBuffer()
+//
+void ESUTIL_API esVertexArrayCacheRemoveBuffer ( GLuint buffer )
+{
+   int i;
+   GLsizei j;
+
+   for ( i = s_entryCount - 1; i >= 0; i-- )
+   {
+      GLboolean uses = s_entries[i].indexBuffer == buffer ? GL_TRUE : GL_FALSE;
+
+      for ( j = 0; j < s_entries[i].bufferCount; j++ )
+      {
+         if ( s_entries[i].buffers[j] == buffer )
+         {
+            uses = GL_TRUE;
+         }
+      }
+
+      if ( uses )
+      {
+         RemoveEntry ( i );
+      }
+   }
+}
+
+///
+// esVertexArrayCacheClear()
+//
+void ESUTIL_API esVertexArrayCacheClear ( void )
+{
+   while ( s_entryCount > 0 )
+   {
+      RemoveEntry ( s_entryCount - 1 );
+   }
+}
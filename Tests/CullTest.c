@@ -0,0 +1,331 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// CullTest.c
+//
+//    esCullSpheres() and esCullBoxes() against a scalar reference, one
+//    object at a time, over random bounds and frusta, then a timing of
+//    both.  The SSE2 and NEON paths use the same arithmetic in the same
+//    order, so the visible lists must be identical.  Exits with a non-zero
+//    status if any check fails.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "esUtil.h"
+
+#define MAX_OBJECTS     4099
+#define RANDOM_FRUSTA   500
+#define BENCH_OBJECTS   100000
+#define BENCH_RUNS      10
+
+static int failures;
+
+///
+// Random()
+//
+//    Uniform value in [-1, 1]
+//
+static GLfloat Random ( void )
+{
+   return ( GLfloat ) rand () / RAND_MAX * 2.0f - 1.0f;
+}
+
+///
+// ReferenceSpheres()
+//
+//    A sphere is outside when its center is further than its radius behind
+//    any plane
+//
+static GLsizei ReferenceSpheres ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingSphere *spheres,
+                                  GLsizei count, GLuint *visible )
+{
+   GLsizei visibleCount = 0;
+   GLsizei i;
+   int p;
+
+   for ( i = 0; i < count; i++ )
+   {
+      const ESBoundingSphere *sphere = &spheres[i];
+      GLboolean inside = GL_TRUE;
+
+      for ( p = 0; p < ES_PLANE_COUNT && inside; p++ )
+      {
+         GLfloat d = planes[p][0] * sphere->center[0] + planes[p][1] * sphere->center[1] +
+                     planes[p][2] * sphere->center[2] + planes[p][3];
+
+         inside = !( d < -sphere->radius );
+      }
+
+      if ( inside )
+      {
+         visible[visibleCount++] = i;
+      }
+   }
+
+   return visibleCount;
+}
+
+///
+// ReferenceBoxes()
+//
+//    A box is outside when its center distance plus its half extent
+//    projected on the plane normal is negative for any plane
+//
+static GLsizei ReferenceBoxes ( const GLfloat planes[ES_PLANE_COUNT][4], const ESBoundingBox *boxes,
+                                GLsizei count, GLuint *visible )
+{
+   GLsizei visibleCount = 0;
+   GLsizei i;
+   int p;
+
+   for ( i = 0; i < count; i++ )
+   {
+      const ESBoundingBox *box = &boxes[i];
+      GLfloat cx = ( box->min[0] + box->max[0] ) * 0.5f;
+      GLfloat cy = ( box->min[1] + box->max[1] ) * 0.5f;
+      GLfloat cz = ( box->min[2] + box->max[2] ) * 0.5f;
+      GLfloat ex = ( box->max[0] - box->min[0] ) * 0.5f;
+      GLfloat ey = ( box->max[1] - box->min[1] ) * 0.5f;
+      GLfloat ez = ( box->max[2] - box->min[2] ) * 0.5f;
+      GLboolean inside = GL_TRUE;
+
+      for ( p = 0; p < ES_PLANE_COUNT && inside; p++ )
+      {
+         GLfloat d = planes[p][0] * cx + planes[p][1] * cy + planes[p][2] * cz + planes[p][3];
+         GLfloat r = fabsf ( planes[p][0] ) * ex + fabsf ( planes[p][1] ) * ey + fabsf ( planes[p][2] ) * ez;
+
+         inside = !( d < -r );
+      }
+
+      if ( inside )
+      {
+         visible[visibleCount++] = i;
+      }
+   }
+
+   return visibleCount;
+}
+
+///
+// RandomBounds()
+//
+//    Spheres and boxes spread around the frustum so that every case, inside,
+//    outside and crossing a plane, is common
+//
+static void RandomBounds ( ESBoundingSphere *spheres, ESBoundingBox *boxes, GLsizei count, GLfloat extent )
+{
+   GLsizei i;
+   int c;
+
+   for ( i = 0; i < count; i++ )
+   {
+      spheres[i].radius = ( Random () + 1.0f ) * extent * 0.05f;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         spheres[i].center[c] = Random () * extent;
+         boxes[i].min[c] = Random () * extent;
+         boxes[i].max[c] = boxes[i].min[c] + ( Random () + 1.0f ) * extent * 0.05f;
+      }
+   }
+}
+
+///
+// RandomFrustum()
+//
+static void RandomFrustum ( GLfloat planes[ES_PLANE_COUNT][4] )
+{
+   ESMatrix proj, view, viewProj;
+
+   esMatrixLoadIdentity ( &proj );
+   esPerspective ( &proj, 30.0f + ( Random () + 1.0f ) * 40.0f, 1.0f + Random () * 0.5f,
+                   0.1f + ( Random () + 1.0f ), 20.0f + ( Random () + 1.0f ) * 20.0f );
+   esMatrixLookAt ( &view, Random () * 10.0f, Random () * 10.0f, Random () * 10.0f,
+                    Random (), Random (), Random (), 0.0f, 1.0f, 0.0f );
+   esMatrixMultiply ( &viewProj, &view, &proj );
+   esFrustumPlanesFromMatrix ( planes, &viewProj );
+}
+
+///
+// CheckVisible()
+//
+//    Record and report a visible list that differs from the reference
+//
+static void CheckVisible ( const char *what, const GLuint *visible, GLsizei visibleCount,
+                           const GLuint *expected, GLsizei expectedCount )
+{
+   if ( visibleCount != expectedCount ||
+        memcmp ( visible, expected, visibleCount * sizeof ( GLuint ) ) != 0 )
+   {
+      if ( failures < 10 )
+      {
+         printf ( "FAIL %s: %d visible, %d expected\n", what, visibleCount, expectedCount );
+      }
+
+      failures++;
+   }
+}
+
+///
+// TestCull()
+//
+static void TestCull ( void )
+{
+   static ESBoundingSphere spheres[MAX_OBJECTS];
+   static ESBoundingBox boxes[MAX_OBJECTS], gathered[MAX_OBJECTS];
+   static GLuint visible[MAX_OBJECTS], expected[MAX_OBJECTS];
+   GLfloat planes[ES_PLANE_COUNT][4];
+   double sphereFraction = 0.0, boxFraction = 0.0;
+   GLsizei i;
+   int n;
+
+   for ( n = 0; n < RANDOM_FRUSTA; n++ )
+   {
+      // Every count modulo 4, so the scalar tail is covered too
+      GLsizei count = MAX_OBJECTS - n % 8;
+      GLsizei visibleCount, expectedCount;
+
+      RandomFrustum ( planes );
+      RandomBounds ( spheres, boxes, count, 30.0f );
+
+      expectedCount = ReferenceSpheres ( planes, spheres, count, expected );
+      visibleCount = esCullSpheres ( planes, spheres, count, visible );
+      CheckVisible ( "esCullSpheres", visible, visibleCount, expected, expectedCount );
+      sphereFraction += ( double ) expectedCount / count;
+
+      expectedCount = ReferenceBoxes ( planes, boxes, count, expected );
+      visibleCount = esCullBoxes ( planes, boxes, count, visible );
+      CheckVisible ( "esCullBoxes", visible, visibleCount, expected, expectedCount );
+      boxFraction += ( double ) expectedCount / count;
+
+      // Compacting in place keeps the visible boxes, in order
+      memcpy ( gathered, boxes, count * sizeof ( ESBoundingBox ) );
+      esCullGather ( gathered, gathered, sizeof ( ESBoundingBox ), visible, visibleCount );
+
+      for ( i = 0; i < visibleCount; i++ )
+      {
+         if ( memcmp ( &gathered[i], &boxes[visible[i]], sizeof ( ESBoundingBox ) ) != 0 )
+         {
+            printf ( "FAIL esCullGather: element %d\n", i );
+            failures++;
+            break;
+         }
+      }
+   }
+
+   printf ( "visible: %.1f%% of spheres, %.1f%% of boxes\n",
+            sphereFraction * 100.0 / RANDOM_FRUSTA, boxFraction * 100.0 / RANDOM_FRUSTA );
+}
+
+///
+// Benchmark()
+//
+//    Best of BENCH_RUNS, in nanoseconds per object
+//
+static void Benchmark ( void )
+{
+   ESBoundingSphere *spheres = malloc ( BENCH_OBJECTS * sizeof ( ESBoundingSphere ) );
+   ESBoundingBox *boxes = malloc ( BENCH_OBJECTS * sizeof ( ESBoundingBox ) );
+   GLuint *visible = malloc ( BENCH_OBJECTS * sizeof ( GLuint ) );
+   GLfloat planes[ES_PLANE_COUNT][4];
+   double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+   volatile GLsizei sink = 0;
+   int run;
+
+   if ( spheres == NULL || boxes == NULL || visible == NULL )
+   {
+      printf ( "FAIL out of memory\n" );
+      failures++;
+      free ( spheres );
+      free ( boxes );
+      free ( visible );
+      return;
+   }
+
+   RandomFrustum ( planes );
+   RandomBounds ( spheres, boxes, BENCH_OBJECTS, 30.0f );
+
+   for ( run = 0; run < BENCH_RUNS; run++ )
+   {
+      clock_t start = clock ();
+      double elapsed;
+
+      sink = sink + ReferenceSpheres ( planes, spheres, BENCH_OBJECTS, visible );
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[0] = elapsed < best[0] ? elapsed : best[0];
+      start = clock ();
+
+      sink = sink + esCullSpheres ( planes, spheres, BENCH_OBJECTS, visible );
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[1] = elapsed < best[1] ? elapsed : best[1];
+      start = clock ();
+
+      sink = sink + ReferenceBoxes ( planes, boxes, BENCH_OBJECTS, visible );
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[2] = elapsed < best[2] ? elapsed : best[2];
+      start = clock ();
+
+      sink = sink + esCullBoxes ( planes, boxes, BENCH_OBJECTS, visible );
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[3] = elapsed < best[3] ? elapsed : best[3];
+   }
+
+   printf ( "ns per sphere: scalar %.2f  esCullSpheres %.2f\n",
+            best[0] * 1e9 / BENCH_OBJECTS, best[1] * 1e9 / BENCH_OBJECTS );
+   printf ( "ns per box:    scalar %.2f  esCullBoxes   %.2f\n",
+            best[2] * 1e9 / BENCH_OBJECTS, best[3] * 1e9 / BENCH_OBJECTS );
+
+   free ( spheres );
+   free ( boxes );
+   free ( visible );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ( void ) argc;
+   ( void ) argv;
+
+   srand ( 1 );
+
+   TestCull ();
+   Benchmark ();
+
+   if ( failures != 0 )
+   {
+      printf ( "%d checks failed\n", failures );
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// MathTest.cpp
+//
+//    Builds esMath.hpp as C++14 and checks it against esMatrixMultiply(),
+//    esPerspective(), esMatrixLookAt() and the other esTransform functions,
+//    then times both.  Exits with a non-zero status if any check fails.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include "esMath.hpp"
+
+using namespace es;
+
+#define BENCH_MATRICES   1000
+#define BENCH_REPEATS    2000
+#define BENCH_RUNS       5
+
+// Constant matrices fold at compile time
+constexpr Mat4 kModel = scale ( translate ( identity ( ), 1.0f, 2.0f, 3.0f ), 2.0f, 2.0f, 2.0f );
+static_assert ( kModel.m[3][0] == 1.0f && kModel.m[0][0] == 2.0f, "translate and scale are constexpr" );
+constexpr Mat4 kProj = ortho ( -10.0f, 10.0f, -10.0f, 10.0f, -30.0f, 30.0f ) *
+                       frustum ( -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 20.0f );
+static_assert ( kProj.m[2][3] != 0.0f, "ortho, frustum and operator* are constexpr" );
+
+static int failures;
+
+///
+// Now()
+//
+//    Seconds on a monotonic clock.  esGetTime() lives with the platform main().
+//
+static double Now ( )
+{
+   return std::chrono::duration<double> ( std::chrono::steady_clock::now ( ).time_since_epoch ( ) ).count ( );
+}
+
+///
+// Difference()
+//
+//    Largest difference between two matrices, 0 for +0 against -0
+//
+static float Difference ( const ESMatrix &a, const ESMatrix &b )
+{
+   float error = 0.0f;
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      for ( int j = 0; j < 4; j++ )
+      {
+         error = std::fmax ( error, std::fabs ( a.m[i][j] - b.m[i][j] ) );
+      }
+   }
+
+   return error;
+}
+
+///
+// Check()
+//
+//    Record and report a difference above the limit, 0 requires equal results
+//
+static void Check ( const char *what, const ESMatrix &a, const ESMatrix &b, float limit )
+{
+   float error = Difference ( a, b );
+
+   if ( error > limit )
+   {
+      std::printf ( "FAIL %s: %g (limit %g)\n", what, error, limit );
+      failures++;
+   }
+}
+
+///
+// TestResults()
+//
+static void TestResults ( )
+{
+   ESMatrix c, view, proj, product;
+
+   // Functions that go through tan, sin, cos or sqrt may be folded at compile
+   // time in one language and not the other, so allow the last bit to differ
+   esMatrixLoadIdentity ( &proj );
+   esPerspective ( &proj, 60.0f, 1.333f, 1.0f, 20.0f );
+   Check ( "perspective", proj, perspective ( 60.0f, 1.333f, 1.0f, 20.0f ), 1e-6f );
+
+   esMatrixLoadIdentity ( &c );
+   esFrustum ( &c, -2.0f, 1.0f, -1.0f, 3.0f, 0.5f, 50.0f );
+   Check ( "frustum", c, frustum ( -2.0f, 1.0f, -1.0f, 3.0f, 0.5f, 50.0f ), 0.0f );
+
+   esMatrixLoadIdentity ( &c );
+   esOrtho ( &c, -10.0f, 10.0f, -10.0f, 10.0f, -30.0f, 30.0f );
+   Check ( "ortho", c, ortho ( -10.0f, 10.0f, -10.0f, 10.0f, -30.0f, 30.0f ), 0.0f );
+
+   esMatrixLookAt ( &view, 3.0f, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+   Check ( "lookAt", view, lookAt ( Vec3 ( 3.0f, 2.0f, 5.0f ), Vec3 ( ), Vec3 ( 0.0f, 1.0f, 0.0f ) ), 1e-6f );
+
+   // The esTranslate, esScale, esRotate sequence of the samples
+   esMatrixLoadIdentity ( &c );
+   esTranslate ( &c, 1.0f, 2.0f, 3.0f );
+   esScale ( &c, 2.0f, 3.0f, 4.0f );
+   esRotate ( &c, 33.0f, 1.0f, 2.0f, 3.0f );
+   Mat4 model = rotate ( scale ( translate ( identity ( ), 1.0f, 2.0f, 3.0f ), 2.0f, 3.0f, 4.0f ),
+                         33.0f, Vec3 ( 1.0f, 2.0f, 3.0f ) );
+   Check ( "translate, scale, rotate", c, model, 1e-6f );
+
+   // multiply() uses the same SIMD path as esMatrixMultiply(), operator* is
+   // plain arithmetic the compiler may contract differently.  A Mat4 passes
+   // to the C API as is.
+   Mat4 result;
+   esMatrixMultiply ( &product, &model, &proj );
+   multiply ( result, model, proj );
+   Check ( "multiply", product, result, 0.0f );
+   Check ( "operator*", product, model * Mat4 ( proj ), 1e-5f );
+
+   // Quaternions against the matrix rotation
+   esMatrixLoadIdentity ( &c );
+   esRotate ( &c, 33.0f, 1.0f, 2.0f, 3.0f );
+   Check ( "fromAxisAngle", c, toMat4 ( fromAxisAngle ( 33.0f, Vec3 ( 1.0f, 2.0f, 3.0f ) ) ), 1e-6f );
+
+   Quat a = fromAxisAngle ( 40.0f, Vec3 ( 0.0f, 1.0f, 0.0f ) );
+   Quat b = fromAxisAngle ( 70.0f, Vec3 ( 1.0f, 0.0f, 1.0f ) );
+   Check ( "quaternion product", toMat4 ( a * b ), toMat4 ( a ) * toMat4 ( b ), 1e-6f );
+   Check ( "conjugate", toMat4 ( a * conjugate ( a ) ), identity ( ), 1e-6f );
+
+   Vec3 p = transformPoint ( Vec3 ( 1.0f, 0.0f, 0.0f ), translate ( identity ( ), 0.0f, 5.0f, 0.0f ) );
+   Vec3 v = transformVector ( Vec3 ( 1.0f, 0.0f, 0.0f ), translate ( identity ( ), 0.0f, 5.0f, 0.0f ) );
+
+   if ( p.x != 1.0f || p.y != 5.0f || p.z != 0.0f || v.y != 0.0f )
+   {
+      std::printf ( "FAIL transformPoint: %g %g %g\n", p.x, p.y, p.z );
+      failures++;
+   }
+}
+
+///
+// Benchmark()
+//
+//    Best of BENCH_RUNS for a batch of model-view-projection products and for
+//    building a view-projection, in the C API and in esMath.hpp
+//
+static void Benchmark ( )
+{
+   static ESMatrix models[BENCH_MATRICES], results[BENCH_MATRICES];
+   static Mat4 mathModels[BENCH_MATRICES], mathResults[BENCH_MATRICES];
+   double best[5] = { 1e9, 1e9, 1e9, 1e9, 1e9 };
+   volatile float sink = 0.0f;
+   ESMatrix proj;
+
+   esMatrixLoadIdentity ( &proj );
+   esPerspective ( &proj, 60.0f, 1.333f, 1.0f, 20.0f );
+   const Mat4 mathProj = proj;
+
+   for ( int i = 0; i < BENCH_MATRICES; i++ )
+   {
+      esMatrixLoadIdentity ( &models[i] );
+      esTranslate ( &models[i], ( GLfloat ) i, 1.0f, 2.0f );
+      esRotate ( &models[i], ( GLfloat ) i, 0.0f, 1.0f, 0.0f );
+      mathModels[i] = models[i];
+   }
+
+   for ( int run = 0; run < BENCH_RUNS; run++ )
+   {
+      double start = Now ( );
+
+      for ( int r = 0; r < BENCH_REPEATS; r++ )
+      {
+         for ( int i = 0; i < BENCH_MATRICES; i++ )
+         {
+            esMatrixMultiply ( &results[i], &models[i], &proj );
+         }
+      }
+
+      best[0] = std::fmin ( best[0], Now ( ) - start );
+      sink = sink + results[7].m[1][1];
+      start = Now ( );
+
+      for ( int r = 0; r < BENCH_REPEATS; r++ )
+      {
+         for ( int i = 0; i < BENCH_MATRICES; i++ )
+         {
+            mathResults[i] = mathModels[i] * mathProj;
+         }
+      }
+
+      best[1] = std::fmin ( best[1], Now ( ) - start );
+      sink = sink + mathResults[7].m[1][1];
+      start = Now ( );
+
+      for ( int r = 0; r < BENCH_REPEATS; r++ )
+      {
+         for ( int i = 0; i < BENCH_MATRICES; i++ )
+         {
+            multiply ( mathResults[i], mathModels[i], mathProj );
+         }
+      }
+
+      best[2] = std::fmin ( best[2], Now ( ) - start );
+      sink = sink + mathResults[7].m[1][1];
+      start = Now ( );
+
+      for ( int r = 0; r < BENCH_REPEATS * 10; r++ )
+      {
+         ESMatrix p, v, vp;
+
+         esMatrixLoadIdentity ( &p );
+         esPerspective ( &p, 60.0f, 1.333f, 1.0f, 20.0f );
+         esMatrixLookAt ( &v, 3.0f, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+         esMatrixMultiply ( &vp, &v, &p );
+         sink = sink + vp.m[2][2];
+      }
+
+      best[3] = std::fmin ( best[3], Now ( ) - start );
+      start = Now ( );
+
+      for ( int r = 0; r < BENCH_REPEATS * 10; r++ )
+      {
+         Mat4 vp = lookAt ( Vec3 ( 3.0f, 2.0f, 5.0f ), Vec3 ( ), Vec3 ( 0.0f, 1.0f, 0.0f ) ) *
+                   perspective ( 60.0f, 1.333f, 1.0f, 20.0f );
+         sink = sink + vp.m[2][2];
+      }
+
+      best[4] = std::fmin ( best[4], Now ( ) - start );
+   }
+
+   std::printf ( "ns per product:         esMatrixMultiply %6.2f  operator* %6.2f  multiply %6.2f\n",
+                 best[0] * 1e9 / BENCH_MATRICES / BENCH_REPEATS,
+                 best[1] * 1e9 / BENCH_MATRICES / BENCH_REPEATS,
+                 best[2] * 1e9 / BENCH_MATRICES / BENCH_REPEATS );
+   std::printf ( "ns per view-projection: C                %6.2f  esMath.hpp %5.2f\n",
+                 best[3] * 1e9 / BENCH_REPEATS / 10, best[4] * 1e9 / BENCH_REPEATS / 10 );
+}
+
+int main ( )
+{
+   TestResults ( );
+   Benchmark ( );
+
+   if ( failures != 0 )
+   {
+      std::printf ( "%d checks failed\n", failures );
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,313 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// MatrixMultiplyTest.c
+//
+//    esMatrixMultiply() and esMatrixMultiplyBatch() against the scalar
+//    loop they replaced, including results that alias an input, then a
+//    timing of the three.  The SSE2 and NEON paths add in the same order
+//    as the loop, so the results must be identical.  Exits with a
+//    non-zero status if any check fails.
+//
+//    Compilers that vectorize the loop, GCC from -O2 and Clang, emit the
+//    same broadcast, multiply and add sequence for it, so optimized builds
+//    report parity.  The intrinsics keep that code in unoptimized builds
+//    and with compilers that leave the loop scalar.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esUtil.h"
+
+#define RANDOM_MATRICES   100000
+#define BATCH_SIZE        100
+#define BENCH_REPEATS     20000
+#define BENCH_RUNS        5
+
+static int failures;
+
+///
+// Random()
+//
+//    Uniform value in [-10, 10]
+//
+static GLfloat Random ( void )
+{
+   return ( GLfloat ) rand () / RAND_MAX * 20.0f - 10.0f;
+}
+
+///
+// RandomMatrix()
+//
+static void RandomMatrix ( ESMatrix *m )
+{
+   int i, j;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      for ( j = 0; j < 4; j++ )
+      {
+         m->m[i][j] = Random ();
+      }
+   }
+}
+
+///
+// ReferenceMultiply()
+//
+//    The scalar esMatrixMultiply() from before the SIMD paths
+//
+static void ReferenceMultiply ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+   ESMatrix    tmp;
+   int         i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
+                     ( srcA->m[i][1] * srcB->m[1][0] ) +
+                     ( srcA->m[i][2] * srcB->m[2][0] ) +
+                     ( srcA->m[i][3] * srcB->m[3][0] ) ;
+
+      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
+                     ( srcA->m[i][1] * srcB->m[1][1] ) +
+                     ( srcA->m[i][2] * srcB->m[2][1] ) +
+                     ( srcA->m[i][3] * srcB->m[3][1] ) ;
+
+      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
+                     ( srcA->m[i][1] * srcB->m[1][2] ) +
+                     ( srcA->m[i][2] * srcB->m[2][2] ) +
+                     ( srcA->m[i][3] * srcB->m[3][2] ) ;
+
+      tmp.m[i][3] =  ( srcA->m[i][0] * srcB->m[0][3] ) +
+                     ( srcA->m[i][1] * srcB->m[1][3] ) +
+                     ( srcA->m[i][2] * srcB->m[2][3] ) +
+                     ( srcA->m[i][3] * srcB->m[3][3] ) ;
+   }
+
+   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+}
+
+///
+// Check()
+//
+//    Record and report a result that differs from the reference
+//
+static void Check ( const char *what, const ESMatrix *result, const ESMatrix *expected )
+{
+   if ( memcmp ( result, expected, sizeof ( ESMatrix ) ) != 0 )
+   {
+      if ( failures < 10 )
+      {
+         printf ( "FAIL %s\n", what );
+      }
+
+      failures++;
+   }
+}
+
+///
+// TestMultiply()
+//
+static void TestMultiply ( void )
+{
+   ESMatrix a, b, expected, result;
+   int n;
+
+   for ( n = 0; n < RANDOM_MATRICES; n++ )
+   {
+      RandomMatrix ( &a );
+      RandomMatrix ( &b );
+      ReferenceMultiply ( &expected, &a, &b );
+
+      esMatrixMultiply ( &result, &a, &b );
+      Check ( "esMatrixMultiply", &result, &expected );
+
+      // The samples accumulate with esMatrixMultiply ( &m, &m, &other )
+      result = a;
+      esMatrixMultiply ( &result, &result, &b );
+      Check ( "esMatrixMultiply result == srcA", &result, &expected );
+
+      result = b;
+      esMatrixMultiply ( &result, &a, &result );
+      Check ( "esMatrixMultiply result == srcB", &result, &expected );
+
+      ReferenceMultiply ( &expected, &a, &a );
+      result = a;
+      esMatrixMultiply ( &result, &result, &result );
+      Check ( "esMatrixMultiply result == srcA == srcB", &result, &expected );
+   }
+}
+
+///
+// TestBatch()
+//
+static void TestBatch ( void )
+{
+   static ESMatrix srcA[BATCH_SIZE], result[BATCH_SIZE], expected[BATCH_SIZE];
+   ESMatrix srcB;
+   int n, i;
+
+   for ( n = 0; n < RANDOM_MATRICES / BATCH_SIZE; n++ )
+   {
+      GLsizei count = 1 + rand () % BATCH_SIZE;
+
+      RandomMatrix ( &srcB );
+
+      for ( i = 0; i < count; i++ )
+      {
+         RandomMatrix ( &srcA[i] );
+         ReferenceMultiply ( &expected[i], &srcA[i], &srcB );
+      }
+
+      // Elements past count are left alone
+      memset ( result, 0xff, sizeof ( result ) );
+      esMatrixMultiplyBatch ( result, srcA, &srcB, count );
+
+      for ( i = 0; i < count; i++ )
+      {
+         Check ( "esMatrixMultiplyBatch", &result[i], &expected[i] );
+      }
+
+      if ( count < BATCH_SIZE && result[count].m[0][0] == result[count].m[0][0] )
+      {
+         printf ( "FAIL esMatrixMultiplyBatch wrote past count\n" );
+         failures++;
+      }
+
+      // In place, result == srcA
+      esMatrixMultiplyBatch ( srcA, srcA, &srcB, count );
+
+      for ( i = 0; i < count; i++ )
+      {
+         Check ( "esMatrixMultiplyBatch result == srcA", &srcA[i], &expected[i] );
+      }
+   }
+}
+
+///
+// Benchmark()
+//
+//    Best of BENCH_RUNS, in nanoseconds per matrix, for model matrices by a
+//    projection the way Instancing builds its frame
+//
+static void Benchmark ( void )
+{
+   double speedup;
+   static ESMatrix models[BATCH_SIZE], results[BATCH_SIZE];
+   double best[3] = { 1e9, 1e9, 1e9 };
+   volatile GLfloat sink = 0.0f;
+   ESMatrix proj;
+   int run, r, i;
+
+   esMatrixLoadIdentity ( &proj );
+   esPerspective ( &proj, 60.0f, 1.333f, 1.0f, 20.0f );
+
+   for ( i = 0; i < BATCH_SIZE; i++ )
+   {
+      esMatrixLoadIdentity ( &models[i] );
+      esTranslate ( &models[i], ( GLfloat ) i, 1.0f, 2.0f );
+      esRotate ( &models[i], ( GLfloat ) i, 1.0f, 0.0f, 1.0f );
+   }
+
+   for ( run = 0; run < BENCH_RUNS; run++ )
+   {
+      clock_t start = clock ();
+      double elapsed;
+
+      for ( r = 0; r < BENCH_REPEATS; r++ )
+      {
+         for ( i = 0; i < BATCH_SIZE; i++ )
+         {
+            ReferenceMultiply ( &results[i], &models[i], &proj );
+         }
+      }
+
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[0] = elapsed < best[0] ? elapsed : best[0];
+      sink = sink + results[5].m[1][1];
+      start = clock ();
+
+      for ( r = 0; r < BENCH_REPEATS; r++ )
+      {
+         for ( i = 0; i < BATCH_SIZE; i++ )
+         {
+            esMatrixMultiply ( &results[i], &models[i], &proj );
+         }
+      }
+
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[1] = elapsed < best[1] ? elapsed : best[1];
+      sink = sink + results[5].m[1][1];
+      start = clock ();
+
+      for ( r = 0; r < BENCH_REPEATS; r++ )
+      {
+         esMatrixMultiplyBatch ( results, models, &proj, BATCH_SIZE );
+      }
+
+      elapsed = ( double ) ( clock () - start ) / CLOCKS_PER_SEC;
+      best[2] = elapsed < best[2] ? elapsed : best[2];
+      sink = sink + results[5].m[1][1];
+   }
+
+   printf ( "ns per matrix: scalar %.2f  esMatrixMultiply %.2f  esMatrixMultiplyBatch %.2f\n",
+            best[0] * 1e9 / BATCH_SIZE / BENCH_REPEATS,
+            best[1] * 1e9 / BATCH_SIZE / BENCH_REPEATS,
+            best[2] * 1e9 / BATCH_SIZE / BENCH_REPEATS );
+
+   // Within 10% of the loop is reported as parity, the runs vary more than that
+   speedup = best[0] / best[2];
+   printf ( "esMatrixMultiplyBatch vs scalar: %.2fx, %s\n", speedup,
+            speedup >= 1.1 ? "faster" :
+            speedup > 0.9 ? "parity" : "slower" );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ( void ) argc;
+   ( void ) argv;
+
+   srand ( 1 );
+
+   TestMultiply ();
+   TestBatch ();
+   Benchmark ();
+
+   if ( failures != 0 )
+   {
+      printf ( "%d checks failed\n", failures );
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
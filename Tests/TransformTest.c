@@ -0,0 +1,438 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// TransformTest.c
+//
+//    Accuracy of esMatrixInverse(), esMatrixInverseAffine(),
+//    esMatrixNormal3x3() and esFrustumPlanesFromMatrix().  Exits with a
+//    non-zero status if any check fails.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include "esUtil.h"
+
+#define RANDOM_MATRICES       100000
+#define NEAR_SINGULAR_STEPS   6
+#define FRUSTUM_POINTS        100000
+
+static int failures;
+
+///
+// Random()
+//
+//    Uniform value in [-1, 1]
+//
+static GLfloat Random ( void )
+{
+   return ( GLfloat ) rand () / RAND_MAX * 2.0f - 1.0f;
+}
+
+///
+// Check()
+//
+//    Record and report a failed check
+//
+static void Check ( int passed, const char *what, double value, double limit )
+{
+   if ( !passed )
+   {
+      printf ( "FAIL %s: %g (limit %g)\n", what, value, limit );
+      failures++;
+   }
+}
+
+///
+// Norm()
+//
+//    Infinity norm, the largest absolute row sum
+//
+static double Norm ( const ESMatrix *m )
+{
+   double norm = 0.0;
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      double sum = fabs ( m->m[i][0] ) + fabs ( m->m[i][1] ) + fabs ( m->m[i][2] ) + fabs ( m->m[i][3] );
+
+      if ( sum > norm )
+      {
+         norm = sum;
+      }
+   }
+
+   return norm;
+}
+
+///
+// IdentityError()
+//
+//    Largest difference between srcA * srcB and the identity
+//
+static double IdentityError ( ESMatrix *srcA, ESMatrix *srcB )
+{
+   ESMatrix product;
+   double error = 0.0;
+   int i, j;
+
+   esMatrixMultiply ( &product, srcA, srcB );
+
+   for ( i = 0; i < 4; i++ )
+   {
+      for ( j = 0; j < 4; j++ )
+      {
+         double e = fabs ( product.m[i][j] - ( i == j ? 1.0 : 0.0 ) );
+
+         if ( e > error )
+         {
+            error = e;
+         }
+      }
+   }
+
+   return error;
+}
+
+///
+// CheckInverse()
+//
+//    Both products of a matrix and its inverse must be the identity, to within
+//    the rounding float arithmetic allows for the condition number of the matrix.
+//    Returns the error as a fraction of that limit, or -1 if there is no inverse.
+//
+static double CheckInverse ( ESMatrix *m, const char *what )
+{
+   ESMatrix inverse;
+   double limit, error;
+
+   if ( !esMatrixInverse ( &inverse, m ) )
+   {
+      return -1.0;
+   }
+
+   limit = 64.0 * FLT_EPSILON * Norm ( m ) * Norm ( &inverse );
+   error = IdentityError ( m, &inverse );
+   Check ( error <= limit, what, error, limit );
+   error = IdentityError ( &inverse, m );
+   Check ( error <= limit, what, error, limit );
+
+   return error / limit;
+}
+
+///
+// TestInverse()
+//
+static void TestInverse ( void )
+{
+   ESMatrix m, singular;
+   double worst = 0.0;
+   int rejected = 0;
+   int n, step, i, j;
+
+   // Well conditioned random matrices
+   for ( n = 0; n < RANDOM_MATRICES; n++ )
+   {
+      double ratio;
+
+      for ( i = 0; i < 4; i++ )
+      {
+         for ( j = 0; j < 4; j++ )
+         {
+            m.m[i][j] = Random () + ( i == j ? 2.0f : 0.0f );
+         }
+      }
+
+      ratio = CheckInverse ( &m, "random inverse" );
+      Check ( ratio >= 0.0, "random inverse rejected", ratio, 0.0 );
+      worst = ratio > worst ? ratio : worst;
+   }
+
+   // Near singular, the last row approaches a combination of the others
+   for ( n = 0; n < RANDOM_MATRICES / 10; n++ )
+   {
+      for ( i = 0; i < 3; i++ )
+      {
+         for ( j = 0; j < 4; j++ )
+         {
+            m.m[i][j] = Random ();
+         }
+      }
+
+      for ( step = 1; step <= NEAR_SINGULAR_STEPS; step++ )
+      {
+         GLfloat epsilon = powf ( 10.0f, ( GLfloat ) -step );
+         double ratio;
+
+         for ( j = 0; j < 4; j++ )
+         {
+            m.m[3][j] = 0.5f * m.m[0][j] - 0.25f * m.m[1][j] + m.m[2][j] + epsilon * ( j == n % 4 ? 1.0f : 0.0f );
+         }
+
+         // Rounding may make the determinant exactly zero, which is rejected
+         ratio = CheckInverse ( &m, "near singular inverse" );
+         rejected += ratio < 0.0;
+         worst = ratio > worst ? ratio : worst;
+      }
+   }
+
+   // Exactly singular matrices are rejected and leave the result alone
+   for ( i = 0; i < 4; i++ )
+   {
+      for ( j = 0; j < 4; j++ )
+      {
+         m.m[i][j] = ( GLfloat ) ( i + j );
+      }
+   }
+
+   esMatrixLoadIdentity ( &singular );
+   Check ( !esMatrixInverse ( &singular, &m ), "singular matrix accepted", 1.0, 0.0 );
+   Check ( singular.m[0][0] == 1.0f && singular.m[0][1] == 0.0f, "singular result written", 1.0, 0.0 );
+
+   printf ( "inverse:        worst error %.3f of the limit, %d near singular rejected\n", worst, rejected );
+}
+
+///
+// RandomAffine()
+//
+//    Translate, rotate and non-uniformly scale in the order the samples do
+//
+static void RandomAffine ( ESMatrix *m )
+{
+   esMatrixLoadIdentity ( m );
+   esTranslate ( m, Random () * 10.0f, Random () * 10.0f, Random () * 10.0f );
+   esRotate ( m, Random () * 180.0f, Random (), Random (), Random () + 1.1f );
+   esScale ( m, Random () + 1.5f, Random () + 1.5f, Random () + 1.5f );
+}
+
+///
+// TestAffineInverse()
+//
+//    esMatrixInverseAffine() against the general inverse
+//
+static void TestAffineInverse ( void )
+{
+   ESMatrix m, affine, general;
+   double worst = 0.0;
+   int n, i, j;
+
+   for ( n = 0; n < RANDOM_MATRICES; n++ )
+   {
+      double limit;
+
+      RandomAffine ( &m );
+
+      if ( !esMatrixInverseAffine ( &affine, &m ) || !esMatrixInverse ( &general, &m ) )
+      {
+         Check ( 0, "affine inverse rejected", 0.0, 0.0 );
+         continue;
+      }
+
+      limit = 64.0 * FLT_EPSILON * Norm ( &general );
+
+      for ( i = 0; i < 4; i++ )
+      {
+         for ( j = 0; j < 4; j++ )
+         {
+            double error = fabs ( affine.m[i][j] - general.m[i][j] );
+
+            Check ( error <= limit, "affine inverse", error, limit );
+            worst = error / limit > worst ? error / limit : worst;
+         }
+      }
+
+      // The last column is exact, not just close
+      Check ( affine.m[0][3] == 0.0f && affine.m[1][3] == 0.0f && affine.m[2][3] == 0.0f &&
+              affine.m[3][3] == 1.0f, "affine inverse last column", affine.m[3][3], 1.0 );
+   }
+
+   printf ( "affine inverse: worst error %.3f of the limit\n", worst );
+}
+
+///
+// TestNormalMatrix()
+//
+//    esMatrixNormal3x3() against the transpose of the general inverse
+//
+static void TestNormalMatrix ( void )
+{
+   ESMatrix m, inverse;
+   GLfloat normal[3][3];
+   double worst = 0.0;
+   int n, i, j;
+
+   for ( n = 0; n < RANDOM_MATRICES; n++ )
+   {
+      double limit;
+
+      RandomAffine ( &m );
+
+      if ( !esMatrixNormal3x3 ( normal, &m ) || !esMatrixInverse ( &inverse, &m ) )
+      {
+         Check ( 0, "normal matrix rejected", 0.0, 0.0 );
+         continue;
+      }
+
+      limit = 64.0 * FLT_EPSILON * Norm ( &inverse );
+
+      for ( i = 0; i < 3; i++ )
+      {
+         for ( j = 0; j < 3; j++ )
+         {
+            double error = fabs ( normal[i][j] - inverse.m[j][i] );
+
+            Check ( error <= limit, "normal matrix", error, limit );
+            worst = error / limit > worst ? error / limit : worst;
+         }
+      }
+   }
+
+   printf ( "normal matrix:  worst error %.3f of the limit\n", worst );
+}
+
+///
+// CheckPlane()
+//
+//    Compare an extracted plane with the expected normalized plane
+//
+static void CheckPlane ( const GLfloat plane[4], GLfloat a, GLfloat b, GLfloat c, GLfloat d, const char *what )
+{
+   double error = fabs ( plane[0] - a ) + fabs ( plane[1] - b ) + fabs ( plane[2] - c ) + fabs ( plane[3] - d );
+
+   Check ( error <= 1e-5, what, error, 1e-5 );
+}
+
+///
+// TestFrustumPlanes()
+//
+static void TestFrustumPlanes ( void )
+{
+   const GLfloat h = 0.70710678f;
+   ESMatrix proj, view, viewProj;
+   GLfloat planes[ES_PLANE_COUNT][4];
+   int mismatches = 0;
+   int n, i, j;
+
+   // Box of esOrtho(), planes face inwards and pass through the faces
+   esMatrixLoadIdentity ( &proj );
+   esOrtho ( &proj, -2.0f, 4.0f, -1.0f, 3.0f, 1.0f, 10.0f );
+   esFrustumPlanesFromMatrix ( planes, &proj );
+   CheckPlane ( planes[ES_PLANE_LEFT],    1.0f,  0.0f,  0.0f,  2.0f,  "ortho left" );
+   CheckPlane ( planes[ES_PLANE_RIGHT],  -1.0f,  0.0f,  0.0f,  4.0f,  "ortho right" );
+   CheckPlane ( planes[ES_PLANE_BOTTOM],  0.0f,  1.0f,  0.0f,  1.0f,  "ortho bottom" );
+   CheckPlane ( planes[ES_PLANE_TOP],     0.0f, -1.0f,  0.0f,  3.0f,  "ortho top" );
+   CheckPlane ( planes[ES_PLANE_NEAR],    0.0f,  0.0f, -1.0f, -1.0f,  "ortho near" );
+   CheckPlane ( planes[ES_PLANE_FAR],     0.0f,  0.0f,  1.0f,  10.0f, "ortho far" );
+
+   // 90 degree esFrustum(), the side planes pass through the eye at 45 degrees
+   esMatrixLoadIdentity ( &proj );
+   esFrustum ( &proj, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 20.0f );
+   esFrustumPlanesFromMatrix ( planes, &proj );
+   CheckPlane ( planes[ES_PLANE_LEFT],    h,     0.0f, -h,     0.0f,  "frustum left" );
+   CheckPlane ( planes[ES_PLANE_RIGHT],  -h,     0.0f, -h,     0.0f,  "frustum right" );
+   CheckPlane ( planes[ES_PLANE_BOTTOM],  0.0f,  h,    -h,     0.0f,  "frustum bottom" );
+   CheckPlane ( planes[ES_PLANE_TOP],     0.0f, -h,    -h,     0.0f,  "frustum top" );
+   CheckPlane ( planes[ES_PLANE_NEAR],    0.0f,  0.0f, -1.0f, -1.0f,  "frustum near" );
+   CheckPlane ( planes[ES_PLANE_FAR],     0.0f,  0.0f,  1.0f,  20.0f, "frustum far" );
+
+   // The planes of a view-projection are in world space, a translated camera
+   // moves the near plane with it
+   esMatrixLookAt ( &view, 0.0f, 0.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+   esMatrixMultiply ( &viewProj, &view, &proj );
+   esFrustumPlanesFromMatrix ( planes, &viewProj );
+   CheckPlane ( planes[ES_PLANE_NEAR],    0.0f,  0.0f, -1.0f,  4.0f,  "view near" );
+   CheckPlane ( planes[ES_PLANE_FAR],     0.0f,  0.0f,  1.0f,  15.0f, "view far" );
+   CheckPlane ( planes[ES_PLANE_LEFT],    h,     0.0f, -h,     h * 5.0f, "view left" );
+
+   // Classifying points against the planes agrees with clipping them, away
+   // from the boundary where rounding decides
+   esMatrixLoadIdentity ( &proj );
+   esPerspective ( &proj, 60.0f, 1.5f, 1.0f, 20.0f );
+   esMatrixLookAt ( &view, 3.0f, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+   esMatrixMultiply ( &viewProj, &view, &proj );
+   esFrustumPlanesFromMatrix ( planes, &viewProj );
+
+   for ( n = 0; n < FRUSTUM_POINTS; n++ )
+   {
+      GLfloat p[3] = { Random () * 30.0f, Random () * 30.0f, Random () * 30.0f };
+      GLfloat clip[4];
+      GLfloat nearest = FLT_MAX;
+      int clipInside = 1, planeInside = 1;
+
+      for ( j = 0; j < 4; j++ )
+      {
+         clip[j] = p[0] * viewProj.m[0][j] + p[1] * viewProj.m[1][j] + p[2] * viewProj.m[2][j] + viewProj.m[3][j];
+      }
+
+      for ( j = 0; j < 3; j++ )
+      {
+         clipInside &= clip[j] >= -clip[3] && clip[j] <= clip[3];
+      }
+
+      for ( i = 0; i < ES_PLANE_COUNT; i++ )
+      {
+         GLfloat distance = planes[i][0] * p[0] + planes[i][1] * p[1] + planes[i][2] * p[2] + planes[i][3];
+
+         planeInside &= distance >= 0.0f;
+         nearest = fabsf ( distance ) < nearest ? fabsf ( distance ) : nearest;
+      }
+
+      if ( nearest > 1e-4f && clipInside != planeInside )
+      {
+         mismatches++;
+      }
+   }
+
+   Check ( mismatches == 0, "frustum point classification", mismatches, 0.0 );
+   printf ( "frustum planes: %d of %d points misclassified\n", mismatches, FRUSTUM_POINTS );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ( void ) argc;
+   ( void ) argv;
+
+   srand ( 1 );
+
+   TestInverse ();
+   TestAffineInverse ();
+   TestNormalMatrix ();
+   TestFrustumPlanes ();
+
+   if ( failures != 0 )
+   {
+      printf ( "%d checks failed\n", failures );
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}